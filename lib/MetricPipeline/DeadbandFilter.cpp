@@ -0,0 +1,155 @@
+#include "DeadbandFilter.h"
+#include <string.h>
+#include <math.h>
+
+DeadbandFilter::DeadbandFilter(const MetricNames &names)
+    : _names(names), _capacity(names.capacity()), _ruleCount(0), _rulesChanged(false),
+      _passed(0), _suppressed(0)
+{
+    portMUX_INITIALIZE(&_lock);
+    _default.absolute = 0;
+    _default.percent = 0;
+    _default.heartbeatMs = 0;
+    _entries = new Entry[_capacity];
+    _state = new uint8_t[_capacity];
+    memset(_state, 0, _capacity);
+}
+
+DeadbandFilter::~DeadbandFilter() {
+    delete[] _entries;
+    delete[] _state;
+}
+
+/**
+ * @name setDefault
+ * @brief Đặt ngưỡng cho các metric không có luật riêng
+ * 
+ * @param {const DeadbandConfig&} config - Ngưỡng lọc
+ * 
+ * @return None
+ */
+void DeadbandFilter::setDefault(const DeadbandConfig &config) {
+    portENTER_CRITICAL(&_lock);
+    _default = config;
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name setRule
+ * @brief Đặt ngưỡng cho một tên thông số hoặc một thiết bị
+ * 
+ * @param {const char*} match - Tên thông số hoặc ID thiết bị
+ * @param {const DeadbandConfig&} config - Ngưỡng lọc
+ * 
+ * @return bool - False nếu tên quá dài hoặc hết chỗ cho luật mới
+ */
+bool DeadbandFilter::setRule(const char *match, const DeadbandConfig &config) {
+    size_t length = strlen(match);
+    if (length == 0 || length >= METRIC_DEADBAND_MATCH_SIZE) {
+        return false;
+    }
+
+    bool ok = true;
+    portENTER_CRITICAL(&_lock);
+    size_t i = 0;
+    while (i < _ruleCount && strcmp(_rules[i].match, match) != 0) {
+        i++;
+    }
+    if (i == _ruleCount) {
+        if (_ruleCount < METRIC_DEADBAND_RULES) {
+            memcpy(_rules[i].match, match, length + 1);
+            _ruleCount++;
+        } else {
+            ok = false;
+        }
+    }
+    if (ok) {
+        _rules[i].config = config;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (ok) {
+        _rulesChanged.store(true, std::memory_order_release);
+    }
+    return ok;
+}
+
+/**
+ * @name resolveRule
+ * @brief Tìm luật áp dụng cho một metric
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * 
+ * @return uint8_t - Chỉ số luật + 1, hoặc kDefaultRule
+ */
+uint8_t DeadbandFilter::resolveRule(MetricHandle handle) {
+    const char *key = _names.name(handle);
+    size_t keyLength = _names.keyLength(handle);
+    const char *device = _names.device(handle);
+
+    uint8_t rule = kDefaultRule;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < _ruleCount; i++) {
+        if (strncmp(_rules[i].match, key, keyLength) == 0 && _rules[i].match[keyLength] == '\0') {
+            rule = i + 1;
+            break;
+        }
+        if (rule == kDefaultRule && strcmp(_rules[i].match, device) == 0) {
+            rule = i + 1;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return rule;
+}
+
+/**
+ * @name accept
+ * @brief Quyết định có gửi mẫu hay không, cập nhật giá trị đã gửi nếu có
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * @param {float} value - Giá trị mới
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return bool - True nếu mẫu cần được gửi
+ */
+bool DeadbandFilter::accept(MetricHandle handle, float value, unsigned long now) {
+    if (handle >= _capacity) {
+        return true;
+    }
+    if (_rulesChanged.exchange(false, std::memory_order_acquire)) {
+        for (size_t i = 0; i < _capacity; i++) {
+            _state[i] &= kHasValue;
+        }
+    }
+
+    uint8_t &state = _state[handle];
+    if ((state & kRuleMask) == kUnresolved) {
+        state |= resolveRule(handle);
+    }
+    uint8_t rule = state & kRuleMask;
+
+    portENTER_CRITICAL(&_lock);
+    DeadbandConfig config = rule == kDefaultRule ? _default : _rules[rule - 1].config;
+    portEXIT_CRITICAL(&_lock);
+
+    Entry &entry = _entries[handle];
+    bool send = true;
+    if ((state & kHasValue) && (config.absolute > 0 || config.percent > 0) &&
+        (config.heartbeatMs == 0 || now - entry.sentAt < config.heartbeatMs)) {
+        float delta = fabsf(value - entry.value);
+        bool changed = (config.absolute > 0 && delta >= config.absolute) ||
+                       (config.percent > 0 && delta > 0 && delta >= fabsf(entry.value) * config.percent / 100);
+        // NaN luôn được gửi
+        send = changed || value != value;
+    }
+
+    if (!send) {
+        _suppressed++;
+        return false;
+    }
+    entry.value = value;
+    entry.sentAt = now;
+    state |= kHasValue;
+    _passed++;
+    return true;
+}
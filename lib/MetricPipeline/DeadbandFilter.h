@@ -0,0 +1,88 @@
+#ifndef DEADBANDFILTER_H
+#define DEADBANDFILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <Arduino.h>
+#include "MetricNames.h"
+
+#ifndef METRIC_DEADBAND_RULES
+#define METRIC_DEADBAND_RULES 16
+#endif
+
+#define METRIC_DEADBAND_MATCH_SIZE 24
+
+/**
+ * Ngưỡng lọc: mẫu chỉ được gửi khi lệch khỏi giá trị đã gửi lần trước ít nhất
+ * absolute hoặc percent (%), hoặc khi đã im lặng heartbeatMs. Ngưỡng bằng 0
+ * là không dùng; cả hai ngưỡng bằng 0 thì mọi mẫu đều được gửi.
+ */
+struct DeadbandConfig {
+    float absolute;
+    float percent;
+    uint32_t heartbeatMs;
+};
+
+/**
+ * Bộ lọc report-on-change theo từng metric (handle). Mỗi metric chỉ tốn 9 byte:
+ * giá trị đã gửi, thời điểm gửi và một byte trạng thái/chỉ số luật.
+ *
+ * Luật được chọn theo thứ tự: tên thông số, ID thiết bị, rồi cấu hình mặc định.
+ *
+ * accept() chỉ gọi từ một task (task ghi vào hàng đợi metric). setDefault() và
+ * setRule() gọi được từ task khác.
+ */
+class DeadbandFilter
+{
+public:
+    explicit DeadbandFilter(const MetricNames &names);
+    ~DeadbandFilter();
+
+    void setDefault(const DeadbandConfig &config);
+    // match là tên thông số hoặc ID thiết bị
+    bool setRule(const char *match, const DeadbandConfig &config);
+
+    // True nếu mẫu cần được gửi
+    bool accept(MetricHandle handle, float value, unsigned long now);
+
+    uint32_t passed() const { return _passed; }
+    uint32_t suppressed() const { return _suppressed; }
+
+private:
+    DeadbandFilter(const DeadbandFilter &);
+    DeadbandFilter &operator=(const DeadbandFilter &);
+
+    static const uint8_t kHasValue = 0x80;
+    static const uint8_t kRuleMask = 0x7f;
+    static const uint8_t kUnresolved = 0;
+    static const uint8_t kDefaultRule = 0x7f;
+
+    struct Rule {
+        char match[METRIC_DEADBAND_MATCH_SIZE];
+        DeadbandConfig config;
+    };
+
+    struct Entry {
+        float value;
+        uint32_t sentAt;
+    };
+
+    uint8_t resolveRule(MetricHandle handle);
+
+    const MetricNames &_names;
+    Entry *_entries;
+    uint8_t *_state; // kHasValue | (chỉ số luật + 1)
+    size_t _capacity;
+
+    DeadbandConfig _default;
+    Rule _rules[METRIC_DEADBAND_RULES];
+    size_t _ruleCount;
+    std::atomic<bool> _rulesChanged;
+    portMUX_TYPE _lock;
+
+    uint32_t _passed;
+    uint32_t _suppressed;
+};
+
+#endif // DEADBANDFILTER_H
@@ -0,0 +1,186 @@
+#include "DeviceShadow.h"
+#include "Metric.h"
+
+DeviceShadow::DeviceShadow(const MetricNames &names)
+    : _names(names), _changedCount(0), _capacity(names.capacity()), _staleMs(METRIC_SHADOW_STALE_MS)
+{
+    portMUX_INITIALIZE(&_lock);
+    _values = new ShadowValue[_capacity];
+    _present = new bool[_capacity];
+    _changed = new bool[_capacity];
+    memset(_present, 0, _capacity);
+    memset(const_cast<bool *>(_changed), 0, _capacity);
+}
+
+DeviceShadow::~DeviceShadow() {
+    delete[] _values;
+    delete[] _present;
+    delete[] _changed;
+}
+
+/**
+ * @name update
+ * @brief Ghi giá trị mới nhất của một metric
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * @param {float} value - Giá trị
+ * @param {uint64_t} ts - Thời gian của mẫu (ms)
+ * @param {uint8_t} flags - Cờ của metric (METRIC_FLAG_*)
+ * @param {bool} changed - True nếu metric cần được đồng bộ lại
+ * 
+ * @return None
+ */
+void DeviceShadow::update(MetricHandle handle, float value, uint64_t ts, uint8_t flags, bool changed) {
+    if (handle >= _capacity) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    ShadowValue &entry = _values[handle];
+    entry.ts = ts;
+    entry.value = value;
+    entry.seenAt = millis();
+    entry.flags = flags;
+    _present[handle] = true;
+    if (changed && !_changed[handle]) {
+        _changed[handle] = true;
+        _changedCount = _changedCount + 1;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name get
+ * @brief Đọc giá trị mới nhất của một metric
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * @param {ShadowValue&} out - Giá trị đọc được
+ * 
+ * @return bool - False nếu metric chưa có mẫu nào
+ */
+bool DeviceShadow::get(MetricHandle handle, ShadowValue &out) const {
+    if (handle >= _capacity) {
+        return false;
+    }
+    portENTER_CRITICAL(&_lock);
+    bool present = _present[handle];
+    if (present) {
+        out = _values[handle];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return present;
+}
+
+/**
+ * @name quality
+ * @brief Đánh giá chất lượng của một giá trị
+ * 
+ * @param {const ShadowValue&} value - Giá trị
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return ShadowQuality - SHADOW_STALE nếu quá lâu không có mẫu mới,
+ *         SHADOW_UNTRUSTED_TIME nếu ts chưa đồng bộ NTP
+ */
+ShadowQuality DeviceShadow::quality(const ShadowValue &value, unsigned long now) const {
+    if (_staleMs > 0 && now - value.seenAt >= _staleMs) {
+        return SHADOW_STALE;
+    }
+    if (value.flags & METRIC_FLAG_UNTRUSTED_TIME) {
+        return SHADOW_UNTRUSTED_TIME;
+    }
+    return SHADOW_GOOD;
+}
+
+const char *DeviceShadow::qualityName(ShadowQuality quality) {
+    switch (quality) {
+    case SHADOW_GOOD:
+        return "good";
+    case SHADOW_UNTRUSTED_TIME:
+        return "untrusted_time";
+    case SHADOW_STALE:
+        return "stale";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @name markChanged
+ * @brief Đánh dấu một metric cần đồng bộ lại (vd. gửi thất bại)
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * 
+ * @return None
+ */
+void DeviceShadow::markChanged(MetricHandle handle) {
+    if (handle >= _capacity) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    if (_present[handle] && !_changed[handle]) {
+        _changed[handle] = true;
+        _changedCount = _changedCount + 1;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name takeChanged
+ * @brief Đọc giá trị của một metric đã đổi và xóa đánh dấu của nó
+ * 
+ * @param {size_t} handle - Handle của metric
+ * @param {ShadowValue&} out - Giá trị đọc được
+ * 
+ * @return bool - False nếu metric không còn được đánh dấu
+ */
+bool DeviceShadow::takeChanged(size_t handle, ShadowValue &out) {
+    portENTER_CRITICAL(&_lock);
+    bool changed = _changed[handle] && _present[handle];
+    if (changed) {
+        out = _values[handle];
+        _changed[handle] = false;
+        _changedCount = _changedCount - 1;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return changed;
+}
+
+/**
+ * @name matches
+ * @brief Kiểm tra metric có nằm trong danh sách khóa được hỏi không
+ * 
+ * @param {size_t} handle - Handle của metric
+ * @param {const char*} keys - "a,b,c": tên metric hoặc ID thiết bị, rỗng là mọi metric
+ * 
+ * @return bool - True nếu khớp
+ */
+bool DeviceShadow::matches(size_t handle, const char *keys) const {
+    if (keys == nullptr || *keys == '\0') {
+        return true;
+    }
+    MetricHandle h = static_cast<MetricHandle>(handle);
+    const char *name = _names.name(h);
+    const char *device = _names.device(h);
+    size_t nameLength = strlen(name);
+    size_t deviceLength = strlen(device);
+
+    const char *p = keys;
+    while (*p) {
+        while (*p == ' ') {
+            p++;
+        }
+        const char *end = strchr(p, ',');
+        size_t length = end != nullptr ? static_cast<size_t>(end - p) : strlen(p);
+        while (length > 0 && p[length - 1] == ' ') {
+            length--;
+        }
+        if ((length == nameLength && strncmp(p, name, length) == 0) ||
+            (length == deviceLength && strncmp(p, device, length) == 0)) {
+            return true;
+        }
+        if (end == nullptr) {
+            break;
+        }
+        p = end + 1;
+    }
+    return false;
+}
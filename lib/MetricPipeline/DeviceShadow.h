@@ -0,0 +1,120 @@
+#ifndef DEVICESHADOW_H
+#define DEVICESHADOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <Arduino.h>
+#include "MetricNames.h"
+
+#ifndef METRIC_SHADOW_STALE_MS
+#define METRIC_SHADOW_STALE_MS 600000 // Không nhận mẫu mới sau thời gian này thì giá trị bị coi là cũ
+#endif
+
+enum ShadowQuality : uint8_t {
+    SHADOW_GOOD,
+    SHADOW_UNTRUSTED_TIME, // ts là thời gian kể từ khi khởi động, chưa đồng bộ NTP
+    SHADOW_STALE
+};
+
+/**
+ * Giá trị gần nhất của một metric trong shadow.
+ */
+struct ShadowValue {
+    uint64_t ts;     // Thời gian của mẫu (ms)
+    float value;
+    uint32_t seenAt; // millis() khi nhận mẫu
+    uint8_t flags;   // METRIC_FLAG_*
+};
+
+/**
+ * Shadow của thiết bị trên gateway: giá trị, thời gian và chất lượng gần nhất
+ * của mọi (thiết bị, thông số), đánh chỉ số theo handle. Dùng để trả lời yêu
+ * cầu đọc thuộc tính từ server mà không phải hỏi lại thiết bị qua Zigbee, và
+ * để chỉ đồng bộ các metric đã đổi từ lần đồng bộ trước.
+ *
+ * update() chỉ gọi từ một task (task ghi vào hàng đợi metric). Các hàm đọc gọi
+ * được từ task khác; mỗi mục được sao chép trong một đoạn khóa ngắn.
+ */
+class DeviceShadow
+{
+public:
+    explicit DeviceShadow(const MetricNames &names);
+    ~DeviceShadow();
+
+    // changed: mẫu đủ khác giá trị đã gửi (đã qua deadband), cần đồng bộ lại
+    void update(MetricHandle handle, float value, uint64_t ts, uint8_t flags, bool changed);
+    bool get(MetricHandle handle, ShadowValue &out) const;
+    ShadowQuality quality(const ShadowValue &value, unsigned long now) const;
+    static const char *qualityName(ShadowQuality quality);
+
+    void setStaleAfter(uint32_t ms) { _staleMs = ms; }
+
+    // Đánh dấu lại một metric để lần đồng bộ sau gửi lại (vd. gửi thất bại)
+    void markChanged(MetricHandle handle);
+    size_t changedCount() const { return _changedCount; }
+
+    /**
+     * Gọi fn(handle, value) cho các metric khớp danh sách "a,b,c": mỗi phần tử là
+     * tên đầy đủ "<key>_<deviceId>" hoặc ID thiết bị. keys rỗng hoặc nullptr là mọi metric.
+     * fn trả về false để dừng. Trả về số metric đã gọi fn.
+     */
+    template <typename Fn>
+    size_t query(const char *keys, Fn fn) const {
+        size_t count = 0;
+        size_t size = _names.size();
+        for (size_t handle = 0; handle < size; handle++) {
+            ShadowValue value;
+            if (!matches(handle, keys) || !get(handle, value)) {
+                continue;
+            }
+            count++;
+            if (!fn(static_cast<MetricHandle>(handle), value)) {
+                break;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Gọi fn(handle, value) cho các metric đã đổi từ lần đồng bộ trước và xóa đánh
+     * dấu của chúng. fn trả về false để dừng; metric đó vẫn được đánh dấu.
+     */
+    template <typename Fn>
+    size_t collectChanged(Fn fn) {
+        size_t count = 0;
+        size_t size = _names.size();
+        for (size_t handle = 0; handle < size && _changedCount > 0; handle++) {
+            // Lấy giá trị và xóa đánh dấu trong cùng một đoạn khóa: update() xen vào
+            // sau đó đánh dấu lại, không bị xóa mất
+            ShadowValue value;
+            if (!_changed[handle] || !takeChanged(handle, value)) {
+                continue;
+            }
+            if (!fn(static_cast<MetricHandle>(handle), value)) {
+                markChanged(static_cast<MetricHandle>(handle));
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+private:
+    DeviceShadow(const DeviceShadow &);
+    DeviceShadow &operator=(const DeviceShadow &);
+
+    bool matches(size_t handle, const char *keys) const;
+    bool takeChanged(size_t handle, ShadowValue &out);
+
+    const MetricNames &_names;
+    ShadowValue *_values;
+    bool *_present;
+    volatile bool *_changed;
+    volatile size_t _changedCount;
+    size_t _capacity;
+    uint32_t _staleMs;
+    mutable portMUX_TYPE _lock;
+};
+
+#endif // DEVICESHADOW_H
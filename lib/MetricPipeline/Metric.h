@@ -0,0 +1,22 @@
+#ifndef METRIC_H
+#define METRIC_H
+
+#include <stdint.h>
+#include "MetricNames.h"
+
+#define METRIC_FLAG_UNTRUSTED_TIME 0x01 // ts là thời gian kể từ khi khởi động, chưa đồng bộ NTP
+
+/**
+ * Một mẫu đo trong hàng đợi: chỉ mang handle thay cho tên, gọn 16 byte.
+ */
+struct Metric {
+    uint64_t ts;         // Thời gian (ms)
+    float value;
+    MetricHandle handle; // Tra tên bằng MetricNames
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(Metric) == 16, "Metric should stay 16 bytes");
+
+#endif // METRIC_H
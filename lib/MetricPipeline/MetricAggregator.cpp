@@ -0,0 +1,199 @@
+#include "MetricAggregator.h"
+#include <string.h>
+
+MetricAggregator::MetricAggregator(const MetricNames &names)
+    : _names(names), _capacity(names.capacity()), _ruleCount(0),
+      _defaultWindowMs(0), _generation(1), _samples(0), _summaries(0)
+{
+    portMUX_INITIALIZE(&_lock);
+    _windows = new Window[_capacity];
+    memset(_windows, 0, sizeof(Window) * _capacity);
+}
+
+MetricAggregator::~MetricAggregator() {
+    delete[] _windows;
+}
+
+/**
+ * @name setDefaultWindow
+ * @brief Đặt cửa sổ cho các metric không có luật riêng
+ * 
+ * @param {uint32_t} windowMs - Độ dài cửa sổ (ms), 0 để không gom
+ * 
+ * @return None
+ */
+void MetricAggregator::setDefaultWindow(uint32_t windowMs) {
+    portENTER_CRITICAL(&_lock);
+    _defaultWindowMs = windowMs;
+    _generation = _generation + 1;
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name setWindow
+ * @brief Đặt cửa sổ cho một tên thông số hoặc một thiết bị
+ * 
+ * @param {const char*} match - Tên thông số hoặc ID thiết bị
+ * @param {uint32_t} windowMs - Độ dài cửa sổ (ms), 0 để không gom
+ * 
+ * @return bool - False nếu tên quá dài hoặc hết chỗ cho luật mới
+ */
+bool MetricAggregator::setWindow(const char *match, uint32_t windowMs) {
+    size_t length = strlen(match);
+    if (length == 0 || length >= METRIC_AGGREGATOR_MATCH_SIZE) {
+        return false;
+    }
+
+    bool ok = true;
+    portENTER_CRITICAL(&_lock);
+    size_t i = 0;
+    while (i < _ruleCount && strcmp(_rules[i].match, match) != 0) {
+        i++;
+    }
+    if (i == _ruleCount) {
+        if (_ruleCount < METRIC_AGGREGATOR_RULES) {
+            memcpy(_rules[i].match, match, length + 1);
+            _ruleCount++;
+        } else {
+            ok = false;
+        }
+    }
+    if (ok) {
+        _rules[i].windowMs = windowMs;
+        _generation = _generation + 1;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return ok;
+}
+
+/**
+ * @name resolveWindow
+ * @brief Tìm độ dài cửa sổ cho một metric theo luật hiện tại
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * 
+ * @return uint32_t - Độ dài cửa sổ (ms)
+ */
+uint32_t MetricAggregator::resolveWindow(MetricHandle handle) {
+    const char *key = _names.name(handle);
+    size_t keyLength = _names.keyLength(handle);
+    const char *device = _names.device(handle);
+
+    portENTER_CRITICAL(&_lock);
+    uint32_t windowMs = _defaultWindowMs;
+    bool keyMatched = false;
+    for (size_t i = 0; i < _ruleCount; i++) {
+        const Rule &rule = _rules[i];
+        if (strncmp(rule.match, key, keyLength) == 0 && rule.match[keyLength] == '\0') {
+            windowMs = rule.windowMs;
+            keyMatched = true;
+        } else if (!keyMatched && strcmp(rule.match, device) == 0) {
+            windowMs = rule.windowMs;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return windowMs;
+}
+
+/**
+ * @name add
+ * @brief Đưa một mẫu vào cửa sổ của metric, đóng cửa sổ nếu đã hết hạn
+ * 
+ * @param {const Metric&} metric - Mẫu đo
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return None
+ */
+void MetricAggregator::add(const Metric &metric, unsigned long now) {
+    if (metric.handle >= _capacity) {
+        return;
+    }
+    _samples++;
+
+    Window &window = _windows[metric.handle];
+    uint32_t generation = _generation;
+    if (window.generation != generation) {
+        window.windowMs = resolveWindow(metric.handle);
+        window.generation = generation;
+    }
+    if (window.count > 0 && now - window.startedAt >= window.windowMs) {
+        emit(metric.handle, window);
+    }
+
+    if (window.count == 0) {
+        window.startedAt = now;
+        window.min = metric.value;
+        window.max = metric.value;
+        window.sum = 0;
+        window.flags = 0;
+    } else {
+        if (metric.value < window.min) window.min = metric.value;
+        if (metric.value > window.max) window.max = metric.value;
+    }
+    window.sum += metric.value;
+    window.last = metric.value;
+    window.ts = metric.ts;
+    window.flags |= metric.flags;
+    if (!(metric.flags & METRIC_FLAG_UNTRUSTED_TIME)) {
+        // ts là của mẫu cuối, cờ thời gian đi theo mẫu đó
+        window.flags &= ~METRIC_FLAG_UNTRUSTED_TIME;
+    }
+    window.count++;
+
+    if (window.windowMs == 0) {
+        emit(metric.handle, window);
+    }
+}
+
+/**
+ * @name poll
+ * @brief Đóng các cửa sổ đã hết hạn dù không có mẫu mới
+ * 
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return None
+ */
+void MetricAggregator::poll(unsigned long now) {
+    size_t count = _names.size();
+    for (size_t i = 0; i < count; i++) {
+        Window &window = _windows[i];
+        if (window.count > 0 && now - window.startedAt >= window.windowMs) {
+            emit(static_cast<MetricHandle>(i), window);
+        }
+    }
+}
+
+/**
+ * @name flush
+ * @brief Đóng mọi cửa sổ đang mở
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MetricAggregator::flush() {
+    size_t count = _names.size();
+    for (size_t i = 0; i < count; i++) {
+        if (_windows[i].count > 0) {
+            emit(static_cast<MetricHandle>(i), _windows[i]);
+        }
+    }
+}
+
+void MetricAggregator::emit(MetricHandle handle, Window &window) {
+    MetricSummary summary;
+    summary.ts = window.ts;
+    summary.min = window.min;
+    summary.max = window.max;
+    summary.mean = window.sum / window.count;
+    summary.last = window.last;
+    summary.count = window.count;
+    summary.windowMs = window.windowMs;
+    summary.flags = window.flags;
+    window.count = 0;
+    _summaries++;
+
+    if (_callback) {
+        _callback(handle, summary);
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef METRICAGGREGATOR_H
+#define METRICAGGREGATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <Arduino.h>
+#include "Metric.h"
+#include "MetricNames.h"
+
+#ifndef METRIC_AGGREGATOR_RULES
+#define METRIC_AGGREGATOR_RULES 16
+#endif
+
+#define METRIC_AGGREGATOR_MATCH_SIZE 24
+
+/**
+ * Tóm tắt một cửa sổ của một metric. windowMs == 0 nghĩa là metric không được
+ * gom, mẫu được chuyển thẳng (count = 1).
+ */
+struct MetricSummary {
+    uint64_t ts;       // Thời gian của mẫu cuối cùng (ms)
+    float min;
+    float max;
+    float mean;
+    float last;
+    uint32_t count;
+    uint32_t windowMs;
+    uint8_t flags;     // OR của flags các mẫu trong cửa sổ, riêng cờ thời gian theo mẫu cuối
+};
+
+/**
+ * Gom các mẫu của từng metric (theo handle) trong một cửa sổ thời gian và chỉ
+ * trả về bản tóm tắt min/max/mean/last/count khi cửa sổ đóng.
+ *
+ * Độ dài cửa sổ được chọn theo thứ tự: luật cho tên thông số, luật cho ID
+ * thiết bị, rồi cửa sổ mặc định (0 = không gom).
+ *
+ * add()/poll()/flush() chỉ gọi từ một task (task gửi metric). setWindow(),
+ * setDefaultWindow() và aggregates() gọi được từ task khác (vd. khi nhận shared
+ * attribute, hoặc task ghi vào hàng đợi metric).
+ */
+class MetricAggregator
+{
+public:
+    typedef std::function<void(MetricHandle handle, const MetricSummary &summary)> SummaryCallback;
+
+    explicit MetricAggregator(const MetricNames &names);
+    ~MetricAggregator();
+
+    void onSummary(SummaryCallback callback) { _callback = callback; }
+
+    void setDefaultWindow(uint32_t windowMs);
+    // match là tên thông số hoặc ID thiết bị
+    bool setWindow(const char *match, uint32_t windowMs);
+    // True nếu metric được gom theo cửa sổ (luật hiện tại cho cửa sổ khác 0)
+    bool aggregates(MetricHandle handle) { return handle < _capacity && resolveWindow(handle) != 0; }
+
+    void add(const Metric &metric, unsigned long now);
+    // Đóng các cửa sổ đã hết hạn
+    void poll(unsigned long now);
+    // Đóng mọi cửa sổ đang mở
+    void flush();
+
+    uint32_t samples() const { return _samples; }
+    uint32_t summaries() const { return _summaries; }
+
+private:
+    MetricAggregator(const MetricAggregator &);
+    MetricAggregator &operator=(const MetricAggregator &);
+
+    struct Rule {
+        char match[METRIC_AGGREGATOR_MATCH_SIZE];
+        uint32_t windowMs;
+    };
+
+    struct Window {
+        unsigned long startedAt;
+        uint64_t ts;
+        float min;
+        float max;
+        float sum;
+        float last;
+        uint32_t count;
+        uint32_t windowMs;
+        uint32_t generation; // Thế hệ luật đã dùng để tính windowMs
+        uint8_t flags;
+    };
+
+    uint32_t resolveWindow(MetricHandle handle);
+    void emit(MetricHandle handle, Window &window);
+
+    const MetricNames &_names;
+    Window *_windows;
+    size_t _capacity;
+
+    Rule _rules[METRIC_AGGREGATOR_RULES];
+    size_t _ruleCount;
+    uint32_t _defaultWindowMs;
+    volatile uint32_t _generation;
+    portMUX_TYPE _lock;
+
+    SummaryCallback _callback;
+    uint32_t _samples;
+    uint32_t _summaries;
+};
+
+#endif // METRICAGGREGATOR_H
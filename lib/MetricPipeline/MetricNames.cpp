@@ -0,0 +1,117 @@
+#include "MetricNames.h"
+#include <string.h>
+
+MetricNames::MetricNames(size_t capacity)
+    : _capacity(capacity < kInvalid ? capacity : kInvalid - 1), _count(0), _overflows(0)
+{
+    size_t indexSize = 1;
+    while (indexSize < _capacity * 2) {
+        indexSize <<= 1;
+    }
+    _indexMask = indexSize - 1;
+
+    _entries = new Entry[_capacity];
+    _index = new std::atomic<uint16_t>[indexSize];
+    for (size_t i = 0; i < indexSize; i++) {
+        _index[i].store(kInvalid, std::memory_order_relaxed);
+    }
+}
+
+MetricNames::~MetricNames() {
+    delete[] _entries;
+    delete[] _index;
+}
+
+/**
+ * @name hash
+ * @brief Băm FNV-1a cho cặp (thiết bị, thông số)
+ * 
+ * @param {const char*} deviceId - ID của thiết bị
+ * @param {const char*} key - Tên thông số
+ * 
+ * @return uint32_t - Giá trị băm
+ */
+uint32_t MetricNames::hash(const char *deviceId, const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= static_cast<uint8_t>(*key++);
+        h *= 16777619u;
+    }
+    h ^= '_';
+    h *= 16777619u;
+    while (*deviceId) {
+        h ^= static_cast<uint8_t>(*deviceId++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool MetricNames::matches(const Entry &entry, const char *deviceId, const char *key, size_t keyLength) const {
+    return entry.keyLength == keyLength &&
+           memcmp(entry.name, key, keyLength) == 0 &&
+           strcmp(entry.name + keyLength + 1, deviceId) == 0;
+}
+
+/**
+ * @name find
+ * @brief Tìm handle của cặp (thiết bị, thông số)
+ * 
+ * @param {const char*} deviceId - ID của thiết bị
+ * @param {const char*} key - Tên thông số
+ * 
+ * @return MetricHandle - Handle, kInvalid nếu chưa có
+ */
+MetricHandle MetricNames::find(const char *deviceId, const char *key) const {
+    size_t keyLength = strlen(key);
+    size_t slot = hash(deviceId, key) & _indexMask;
+    for (;;) {
+        MetricHandle handle = _index[slot].load(std::memory_order_acquire);
+        if (handle == kInvalid || matches(_entries[handle], deviceId, key, keyLength)) {
+            return handle;
+        }
+        slot = (slot + 1) & _indexMask;
+    }
+}
+
+/**
+ * @name intern
+ * @brief Lấy handle của cặp (thiết bị, thông số), tạo mới ở lần gặp đầu tiên
+ * 
+ * @param {const char*} deviceId - ID của thiết bị
+ * @param {const char*} key - Tên thông số
+ * 
+ * @return MetricHandle - Handle, kInvalid nếu bảng đầy hoặc tên quá dài
+ */
+MetricHandle MetricNames::intern(const char *deviceId, const char *key) {
+    size_t keyLength = strlen(key);
+    size_t slot = hash(deviceId, key) & _indexMask;
+    for (;;) {
+        MetricHandle handle = _index[slot].load(std::memory_order_relaxed);
+        if (handle == kInvalid) {
+            break;
+        }
+        if (matches(_entries[handle], deviceId, key, keyLength)) {
+            return handle;
+        }
+        slot = (slot + 1) & _indexMask;
+    }
+
+    size_t count = _count.load(std::memory_order_relaxed);
+    size_t deviceLength = strlen(deviceId);
+    if (count >= _capacity || keyLength == 0 || keyLength > 0xff ||
+        keyLength + 1 + deviceLength >= METRIC_NAME_SIZE) {
+        _overflows++;
+        return kInvalid;
+    }
+
+    Entry &entry = _entries[count];
+    memcpy(entry.name, key, keyLength);
+    entry.name[keyLength] = '_';
+    memcpy(entry.name + keyLength + 1, deviceId, deviceLength + 1);
+    entry.keyLength = static_cast<uint8_t>(keyLength);
+
+    // Công bố mục mới sau khi đã ghi đầy đủ
+    _index[slot].store(static_cast<MetricHandle>(count), std::memory_order_release);
+    _count.store(count + 1, std::memory_order_release);
+    return static_cast<MetricHandle>(count);
+}
@@ -0,0 +1,62 @@
+#ifndef METRICNAMES_H
+#define METRICNAMES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifndef METRIC_NAMES_CAPACITY
+#define METRIC_NAMES_CAPACITY 1024
+#endif
+
+#define METRIC_NAME_SIZE 48
+
+typedef uint16_t MetricHandle;
+
+/**
+ * Bảng intern ánh xạ (thiết bị, thông số) sang một handle 16 bit ở lần gặp đầu tiên.
+ * Tên đầy đủ "<key>_<deviceId>" được lưu một lần và chỉ được đọc lại khi gửi.
+ *
+ * Chỉ một task được gọi intern(); các task khác có thể đọc name()/key()/device()
+ * của handle đã nhận được qua hàng đợi vì mục chỉ được công bố sau khi ghi xong.
+ */
+class MetricNames
+{
+public:
+    static const MetricHandle kInvalid = 0xffff;
+
+    explicit MetricNames(size_t capacity = METRIC_NAMES_CAPACITY);
+    ~MetricNames();
+
+    MetricHandle intern(const char *deviceId, const char *key);
+    MetricHandle find(const char *deviceId, const char *key) const;
+
+    const char *name(MetricHandle handle) const { return _entries[handle].name; }
+    size_t keyLength(MetricHandle handle) const { return _entries[handle].keyLength; }
+    const char *device(MetricHandle handle) const { return _entries[handle].name + _entries[handle].keyLength + 1; }
+
+    size_t size() const { return _count.load(std::memory_order_acquire); }
+    size_t capacity() const { return _capacity; }
+    uint32_t overflows() const { return _overflows; }
+
+private:
+    MetricNames(const MetricNames &);
+    MetricNames &operator=(const MetricNames &);
+
+    struct Entry {
+        char name[METRIC_NAME_SIZE]; // "<key>_<deviceId>"
+        uint8_t keyLength;
+    };
+
+    static uint32_t hash(const char *deviceId, const char *key);
+    bool matches(const Entry &entry, const char *deviceId, const char *key, size_t keyLength) const;
+
+    Entry *_entries;
+    std::atomic<uint16_t> *_index;
+    size_t _capacity;
+    size_t _indexMask;
+    std::atomic<size_t> _count;
+    uint32_t _overflows;
+};
+
+#endif // METRICNAMES_H
@@ -0,0 +1,361 @@
+#include "MetricStore.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const uint32_t kSegmentMagic = 0x4753454d; // "MSEG"
+static const uint16_t kSegmentVersion = 1;
+
+MetricStore::MetricStore(const char *directory, size_t recordsPerSegment, size_t maxSegments)
+    : _recordsPerSegment(recordsPerSegment > 0 ? recordsPerSegment : 1),
+      _maxSegments(maxSegments > 2 ? maxSegments : 2), _bootId(0),
+      _readSeq(0), _nextSeq(0),
+      _writeFile(nullptr), _writeSeq(0), _writeRecords(0),
+      _readFile(nullptr), _readOffset(0), _readCount(0),
+      _pending(0), _appended(0), _replayed(0), _evicted(0), _corrupted(0)
+{
+    snprintf(_directory, sizeof(_directory), "%s", directory);
+}
+
+MetricStore::~MetricStore() {
+    closeWriteSegment();
+    if (_readFile != nullptr) {
+        fclose(_readFile);
+    }
+}
+
+/**
+ * @name checksum
+ * @brief FNV-1a 32 bit
+ * 
+ * @param {const void*} data - Dữ liệu
+ * @param {size_t} length - Độ dài dữ liệu
+ * 
+ * @return uint32_t - Checksum
+ */
+uint32_t MetricStore::checksum(const void *data, size_t length) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint32_t h = 2166136261u;
+    while (length--) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void MetricStore::segmentPath(uint32_t seq, char *path, size_t size) const {
+    snprintf(path, size, "%s/%08lu.seg", _directory, static_cast<unsigned long>(seq));
+}
+
+/**
+ * @name begin
+ * @brief Tạo thư mục và tìm các segment còn lại từ lần chạy trước
+ * 
+ * @param None
+ * 
+ * @return bool - False nếu không thể tạo hoặc đọc thư mục
+ */
+bool MetricStore::begin() {
+    if (mkdir(_directory, 0775) != 0 && errno != EEXIST) {
+        return false;
+    }
+    DIR *dir = opendir(_directory);
+    if (dir == nullptr) {
+        return false;
+    }
+
+    bool found = false;
+    uint32_t minSeq = 0;
+    uint32_t maxSeq = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (dot == nullptr || strcmp(dot, ".seg") != 0) {
+            continue;
+        }
+        uint32_t seq = strtoul(entry->d_name, nullptr, 10);
+        if (!found || seq < minSeq) {
+            minSeq = seq;
+        }
+        if (!found || seq > maxSeq) {
+            maxSeq = seq;
+        }
+        found = true;
+    }
+    closedir(dir);
+
+    _readSeq = found ? minSeq : 0;
+    _nextSeq = found ? maxSeq + 1 : 0;
+    // Mỗi lần khởi động ghi vào segment mới, nên segment đầu tiên của lần này lớn hơn
+    // mọi segment của các lần trước: dùng làm ID của lần khởi động
+    _bootId = static_cast<uint16_t>(_nextSeq);
+    _pending = 0;
+    for (uint32_t seq = _readSeq; seq != _nextSeq; seq++) {
+        _pending += countRecords(seq);
+    }
+    return true;
+}
+
+/**
+ * @name countRecords
+ * @brief Đếm số bản ghi đầy đủ của một segment, xóa segment có header hỏng
+ * 
+ * @param {uint32_t} seq - Số thứ tự segment
+ * 
+ * @return uint32_t - Số bản ghi
+ */
+uint32_t MetricStore::countRecords(uint32_t seq) {
+    char path[96];
+    segmentPath(seq, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return 0;
+    }
+
+    SegmentHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == kSegmentMagic && header.version == kSegmentVersion &&
+                 header.recordSize == sizeof(StoredMetric) && header.seq == seq &&
+                 header.checksum == checksum(&header, offsetof(SegmentHeader, checksum));
+    long size = 0;
+    if (valid && fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    fclose(file);
+
+    if (!valid) {
+        _corrupted++;
+        remove(path);
+        return 0;
+    }
+    return (size - sizeof(SegmentHeader)) / sizeof(StoredMetric);
+}
+
+/**
+ * @name openWriteSegment
+ * @brief Tạo segment mới, header được ghi xuống flash trước mọi bản ghi
+ * 
+ * @param None
+ * 
+ * @return bool - False nếu không tạo được tệp
+ */
+bool MetricStore::openWriteSegment() {
+    if (_nextSeq - _readSeq >= _maxSegments) {
+        evictOldest();
+    }
+
+    char path[96];
+    segmentPath(_nextSeq, path, sizeof(path));
+    // Đọc và ghi: replay đọc segment này qua cùng tệp khi đuổi kịp lúc ghi
+    FILE *file = fopen(path, "w+b");
+    if (file == nullptr) {
+        return false;
+    }
+
+    SegmentHeader header;
+    header.magic = kSegmentMagic;
+    header.version = kSegmentVersion;
+    header.recordSize = sizeof(StoredMetric);
+    header.seq = _nextSeq;
+    header.checksum = checksum(&header, offsetof(SegmentHeader, checksum));
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+        fclose(file);
+        remove(path);
+        return false;
+    }
+    fsync(fileno(file));
+
+    _writeFile = file;
+    _writeSeq = _nextSeq++;
+    _writeRecords = 0;
+    return true;
+}
+
+/**
+ * @name closeWriteSegment
+ * @brief Đóng segment đang ghi khi đã đủ bản ghi
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MetricStore::closeWriteSegment() {
+    if (_writeFile == nullptr) {
+        return;
+    }
+    fflush(_writeFile);
+    fsync(fileno(_writeFile));
+    fclose(_writeFile);
+    _writeFile = nullptr;
+}
+
+/**
+ * @name evictOldest
+ * @brief Xóa segment cũ nhất khi nhật ký đầy
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MetricStore::evictOldest() {
+    uint32_t lost;
+    if (_readFile != nullptr) {
+        lost = _readCount - _readOffset;
+        closeReadSegment();
+    } else {
+        lost = countRecords(_readSeq) - _readOffset;
+        char path[96];
+        segmentPath(_readSeq, path, sizeof(path));
+        remove(path);
+        _readSeq++;
+        _readOffset = 0;
+    }
+    _evicted += lost;
+    _pending = _pending > lost ? _pending - lost : 0;
+}
+
+/**
+ * @name append
+ * @brief Ghi thêm một metric vào nhật ký
+ * 
+ * @param {uint64_t} ts - Thời gian (ms)
+ * @param {const char*} name - Tên metric
+ * @param {float} value - Giá trị
+ * @param {uint8_t} flags - Cờ của metric
+ * 
+ * @return bool - False nếu không ghi được
+ */
+bool MetricStore::append(uint64_t ts, const char *name, float value, uint8_t flags) {
+    if (_writeFile == nullptr && !openWriteSegment()) {
+        return false;
+    }
+
+    StoredMetric record;
+    memset(&record, 0, sizeof(record));
+    record.ts = ts;
+    record.value = value;
+    record.flags = flags;
+    record.boot = _bootId;
+    snprintf(record.name, sizeof(record.name), "%s", name);
+    record.checksum = checksum(&record, offsetof(StoredMetric, checksum));
+
+    // replay có thể đã đọc qua tệp này: về cuối tệp trước khi ghi
+    if (fseek(_writeFile, 0, SEEK_END) != 0 || fwrite(&record, sizeof(record), 1, _writeFile) != 1 ||
+        fflush(_writeFile) != 0) {
+        closeWriteSegment();
+        return false;
+    }
+    _appended++;
+    _pending++;
+    if (++_writeRecords >= _recordsPerSegment) {
+        closeWriteSegment();
+    }
+    return true;
+}
+
+/**
+ * @name openReadSegment
+ * @brief Mở segment đã đóng cũ nhất để đọc lại
+ * 
+ * @param None
+ * 
+ * @return bool - False nếu không còn segment đã đóng nào (chỉ còn segment đang ghi)
+ */
+bool MetricStore::openReadSegment() {
+    while (_readSeq != _nextSeq) {
+        if (_writeFile != nullptr && _readSeq == _writeSeq) {
+            // Segment đang ghi được replay đọc qua _writeFile
+            return false;
+        }
+        _readCount = countRecords(_readSeq);
+        char path[96];
+        segmentPath(_readSeq, path, sizeof(path));
+        _readFile = _readCount > _readOffset ? fopen(path, "rb") : nullptr;
+        if (_readFile != nullptr) {
+            return true;
+        }
+        remove(path);
+        _readSeq++;
+        _readOffset = 0;
+    }
+    return false;
+}
+
+/**
+ * @name closeReadSegment
+ * @brief Đóng và xóa segment đã đọc xong
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MetricStore::closeReadSegment() {
+    char path[96];
+    segmentPath(_readSeq, path, sizeof(path));
+    fclose(_readFile);
+    _readFile = nullptr;
+    remove(path);
+    _readSeq++;
+    _readOffset = 0;
+    _readCount = 0;
+}
+
+/**
+ * @name replay
+ * @brief Đọc lại các metric đã lưu theo thứ tự, tối đa maxRecords bản ghi mỗi lần gọi
+ * 
+ * @param {size_t} maxRecords - Số bản ghi tối đa
+ * @param {std::function<bool(const StoredMetric&)>} handler - Hàm xử lý, trả về false để dừng
+ * 
+ * @return size_t - Số bản ghi đã xử lý
+ */
+size_t MetricStore::replay(size_t maxRecords, std::function<bool(const StoredMetric &record)> handler) {
+    size_t count = 0;
+    while (count < maxRecords) {
+        // Đã đọc hết các segment đã đóng: đọc tiếp segment đang ghi tới bản ghi cuối đã ghi
+        bool tail = false;
+        if (_readFile == nullptr && !openReadSegment()) {
+            tail = _writeFile != nullptr && _readSeq == _writeSeq && _readOffset < _writeRecords;
+            if (!tail) {
+                break;
+            }
+        }
+        if (!tail && _readOffset >= _readCount) {
+            closeReadSegment();
+            continue;
+        }
+
+        FILE *file = tail ? _writeFile : _readFile;
+        StoredMetric record;
+        long offset = sizeof(SegmentHeader) + _readOffset * sizeof(StoredMetric);
+        if (fseek(file, offset, SEEK_SET) != 0 || fread(&record, sizeof(record), 1, file) != 1) {
+            if (tail) {
+                // Segment đang ghi vẫn được giữ, thử lại ở lần sau
+                break;
+            }
+            _corrupted++;
+            _pending -= _readCount - _readOffset;
+            closeReadSegment();
+            continue;
+        }
+        if (record.checksum != checksum(&record, offsetof(StoredMetric, checksum))) {
+            // Bản ghi ghi dở khi mất điện
+            _corrupted++;
+            _readOffset++;
+            _pending--;
+            continue;
+        }
+        record.name[sizeof(record.name) - 1] = '\0';
+        if (!handler(record)) {
+            break;
+        }
+        _readOffset++;
+        _pending--;
+        _replayed++;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,108 @@
+#ifndef METRICSTORE_H
+#define METRICSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <functional>
+#include "MetricNames.h"
+
+/**
+ * Bản ghi metric lưu trên flash. Lưu tên đầy đủ vì handle của MetricNames
+ * không còn giá trị sau khi khởi động lại.
+ */
+struct StoredMetric {
+    uint64_t ts;
+    float value;
+    uint8_t flags;
+    uint8_t reserved;
+    uint16_t boot;     // Lần khởi động ghi bản ghi (MetricStore::bootId())
+    char name[METRIC_NAME_SIZE];
+    uint32_t checksum; // FNV-1a của các trường phía trên, phát hiện bản ghi ghi dở
+};
+
+/**
+ * Nhật ký chỉ ghi thêm, chia thành các segment "<dir>/<seq>.seg", dùng để giữ metric
+ * khi mất kết nối và gửi lại theo đúng thứ tự khi kết nối lại.
+ *
+ * - Mỗi segment có header kèm checksum, được ghi và fsync trước bản ghi đầu tiên.
+ * - Bản ghi có checksum riêng; bản ghi hỏng ở cuối segment (mất điện khi đang ghi) bị bỏ qua.
+ * - Khi vượt maxSegments, segment cũ nhất bị xóa (mất dữ liệu cũ nhất trước).
+ * - Segment đang ghi được đọc lại qua chính tệp ghi, tới số bản ghi đã ghi, nên đọc
+ *   đuổi kịp lúc ghi không phải đóng segment và tạo segment mới.
+ *
+ * Dùng stdio/POSIX nên chạy được trên LittleFS của ESP32 (qua VFS, vd. "/littlefs/metrics")
+ * và trên một thư mục bất kỳ của Linux. Chỉ gọi từ một task.
+ */
+class MetricStore
+{
+public:
+    MetricStore(const char *directory, size_t recordsPerSegment = 256, size_t maxSegments = 16);
+    ~MetricStore();
+
+    bool begin();
+
+    bool append(uint64_t ts, const char *name, float value, uint8_t flags);
+    // Đọc lại tối đa maxRecords bản ghi theo thứ tự ghi. Dừng khi handler trả về false,
+    // bản ghi đó sẽ được đọc lại ở lần sau.
+    size_t replay(size_t maxRecords, std::function<bool(const StoredMetric &record)> handler);
+
+    // Khác nhau giữa các lần khởi động có ghi bản ghi: ts chưa đồng bộ NTP (tính từ
+    // lúc khởi động) chỉ đổi được sang epoch nếu bản ghi thuộc lần khởi động này
+    uint16_t bootId() const { return _bootId; }
+    bool fromThisBoot(const StoredMetric &record) const { return record.boot == _bootId; }
+
+    bool empty() const { return _pending == 0; }
+    uint32_t pending() const { return _pending; }
+    uint32_t appended() const { return _appended; }
+    uint32_t replayed() const { return _replayed; }
+    uint32_t evicted() const { return _evicted; }
+    uint32_t corrupted() const { return _corrupted; }
+
+private:
+    MetricStore(const MetricStore &);
+    MetricStore &operator=(const MetricStore &);
+
+    struct SegmentHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t seq;
+        uint32_t checksum;
+    };
+
+    void segmentPath(uint32_t seq, char *path, size_t size) const;
+    bool openWriteSegment();
+    void closeWriteSegment();
+    bool openReadSegment();
+    void closeReadSegment();
+    void evictOldest();
+    uint32_t countRecords(uint32_t seq);
+
+    static uint32_t checksum(const void *data, size_t length);
+
+    char _directory[64];
+    size_t _recordsPerSegment;
+    size_t _maxSegments;
+    uint16_t _bootId;
+
+    // Các segment nằm trong [_readSeq, _nextSeq)
+    uint32_t _readSeq;
+    uint32_t _nextSeq;
+
+    FILE *_writeFile;
+    uint32_t _writeSeq;
+    size_t _writeRecords;
+
+    FILE *_readFile;
+    size_t _readOffset; // Số bản ghi đã đọc trong segment _readSeq
+    size_t _readCount;  // Số bản ghi của segment _readSeq khi mở
+
+    uint32_t _pending;
+    uint32_t _appended;
+    uint32_t _replayed;
+    uint32_t _evicted;
+    uint32_t _corrupted;
+};
+
+#endif // METRICSTORE_H
@@ -0,0 +1,74 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifndef SPSC_CACHE_LINE_SIZE
+#define SPSC_CACHE_LINE_SIZE 32
+#endif
+
+/**
+ * Hàng đợi vòng không khóa, một luồng ghi (producer) và một luồng đọc (consumer).
+ * Chỉ số ghi và chỉ số đọc nằm trên các cache line khác nhau để hai core
+ * không tranh chấp nhau. Khi đầy, phần tử mới bị bỏ và được đếm vào dropped().
+ *
+ * T phải là kiểu POD (sao chép bằng phép gán).
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : _head(0), _pushed(0), _dropped(0), _tail(0) {}
+
+    // Chỉ gọi từ producer
+    bool push(const T &item) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) {
+            _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        _slots[head & (Capacity - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        _pushed.store(_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Chỉ gọi từ consumer
+    bool pop(T &item) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        item = _slots[tail & (Capacity - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static size_t capacity() { return Capacity; }
+
+    uint32_t pushed() const { return _pushed.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    // Phần của producer
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _pushed;
+    std::atomic<uint32_t> _dropped;
+
+    // Phần của consumer
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<uint32_t> _tail;
+
+    alignas(SPSC_CACHE_LINE_SIZE) T _slots[Capacity];
+};
+
+#endif // SPSCRING_H
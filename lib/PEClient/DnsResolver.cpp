@@ -0,0 +1,90 @@
+#include "DnsResolver.h"
+#include <string.h>
+#include <lwip/dns.h>
+#include <lwip/priv/tcpip_priv.h>
+
+// Tham số cho dns_gethostbyname_addrtype(), chạy trong task tcpip
+struct DnsCall {
+    struct tcpip_api_call_data call; // Phải đứng đầu
+    const char *host;
+    ip_addr_t address;
+    dns_found_callback found;
+    void *arg;
+};
+
+static err_t startLookup(struct tcpip_api_call_data *data) {
+    DnsCall *call = reinterpret_cast<DnsCall *>(data);
+    return dns_gethostbyname_addrtype(call->host, &call->address, call->found, call->arg, LWIP_DNS_ADDRTYPE_IPV4);
+}
+
+DnsResolver::DnsResolver() : _status(DNS_IDLE), _address(0) {}
+
+/**
+ * @name start
+ * @brief Bắt đầu tra DNS mà không chờ câu trả lời
+ *
+ * @param {const char*} host - Tên máy, phải còn hợp lệ tới khi có kết quả
+ *
+ * @return bool - False nếu lwIP từ chối yêu cầu (vd. tên không hợp lệ, hết chỗ
+ *         trong bảng DNS)
+ */
+bool DnsResolver::start(const char *host) {
+    DnsCall call;
+    memset(&call, 0, sizeof(call));
+    call.host = host;
+    call.found = onFound;
+    call.arg = this;
+
+    _status = DNS_PENDING;
+    err_t err = tcpip_api_call(startLookup, &call.call);
+    if (err == ERR_OK) {
+        // Có sẵn trong cache: callback sẽ không được gọi
+        _address = ip4_addr_get_u32(ip_2_ip4(&call.address));
+        _status = DNS_DONE;
+        return true;
+    }
+    if (err == ERR_INPROGRESS) {
+        return true;
+    }
+    _status = DNS_FAILED;
+    return false;
+}
+
+/**
+ * @name poll
+ * @brief Đọc kết quả của lần tra DNS đang chạy
+ *
+ * @param {IPAddress&} address - Nhận địa chỉ khi tra xong
+ *
+ * @return Status - DNS_PENDING khi chưa có câu trả lời
+ */
+DnsResolver::Status DnsResolver::poll(IPAddress &address) {
+    Status status = static_cast<Status>(_status.load());
+    if (status == DNS_DONE) {
+        address = IPAddress(_address.load());
+    }
+    return status;
+}
+
+/**
+ * @name onFound
+ * @brief Callback của lwIP khi có câu trả lời (chạy trong task tcpip)
+ *
+ * @param {const char*} name - Tên đã tra
+ * @param {const ip_addr_t*} address - Địa chỉ, nullptr nếu không tra được
+ * @param {void*} arg - DnsResolver đã gửi yêu cầu
+ *
+ * @return None
+ */
+void DnsResolver::onFound(const char *, const ip_addr_t *address, void *arg) {
+    DnsResolver *resolver = static_cast<DnsResolver *>(arg);
+    if (resolver->_status != DNS_PENDING) {
+        return; // Đã cancel()
+    }
+    if (address == nullptr || !IP_IS_V4(address)) {
+        resolver->_status = DNS_FAILED;
+        return;
+    }
+    resolver->_address = ip4_addr_get_u32(ip_2_ip4(address));
+    resolver->_status = DNS_DONE;
+}
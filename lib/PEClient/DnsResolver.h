@@ -0,0 +1,42 @@
+#ifndef DNSRESOLVER_H
+#define DNSRESOLVER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <Arduino.h>
+#include <lwip/ip_addr.h>
+
+/**
+ * Tra DNS không chờ cho task PEClient: start() gửi yêu cầu cho lwIP (qua task
+ * tcpip), câu trả lời đến trong callback của lwIP và được đọc bằng poll() ở các
+ * lần loop() sau. Tên đã có trong cache của lwIP được trả lời ngay trong start().
+ *
+ * Chỉ giữ một lần tra; cancel() bỏ qua câu trả lời đến muộn. Chuỗi host phải còn
+ * hợp lệ tới khi có kết quả.
+ */
+class DnsResolver
+{
+public:
+    enum Status : uint8_t {
+        DNS_IDLE,
+        DNS_PENDING,
+        DNS_DONE,
+        DNS_FAILED
+    };
+
+    DnsResolver();
+
+    // Trả về false nếu không gửi được yêu cầu (poll() trả về DNS_FAILED)
+    bool start(const char *host);
+    // Địa chỉ chỉ được ghi khi trả về DNS_DONE
+    Status poll(IPAddress &address);
+    void cancel() { _status = DNS_IDLE; }
+
+private:
+    static void onFound(const char *name, const ip_addr_t *address, void *arg);
+
+    std::atomic<uint8_t> _status;
+    std::atomic<uint32_t> _address; // Thứ tự byte mạng
+};
+
+#endif // DNSRESOLVER_H
@@ -0,0 +1,87 @@
+#ifndef JSONARENA_H
+#define JSONARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <ArduinoJson.h>
+
+/**
+ * Bộ cấp phát cho JsonDocument trên một vùng nhớ cố định N byte (tĩnh, thành
+ * viên hoặc trên stack), không dùng heap. Cấp phát tăng dần; chỉ khối cuối
+ * cùng được giải phóng hoặc đổi kích thước tại chỗ. Hết chỗ thì trả về
+ * nullptr và JsonDocument báo overflowed().
+ *
+ * Arena phải sống lâu hơn document. Chỉ gọi reset() khi document đã clear().
+ */
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator
+{
+public:
+    JsonArena() : _used(0), _last(nullptr), _overflows(0) {}
+
+    void *allocate(size_t size) override {
+        size_t need = kHeader + align(size);
+        if (need > N - _used) {
+            _overflows++;
+            return nullptr;
+        }
+        uint8_t *block = _buffer + _used;
+        *reinterpret_cast<size_t *>(block) = size;
+        _used += need;
+        _last = block + kHeader;
+        return _last;
+    }
+
+    void deallocate(void *ptr) override {
+        if (ptr != nullptr && ptr == _last) {
+            _used = _last - kHeader - _buffer;
+            _last = nullptr;
+        }
+    }
+
+    void *reallocate(void *ptr, size_t size) override {
+        if (ptr == nullptr) {
+            return allocate(size);
+        }
+        uint8_t *block = static_cast<uint8_t *>(ptr);
+        size_t oldSize = *reinterpret_cast<size_t *>(block - kHeader);
+        if (block == _last) {
+            size_t start = block - _buffer;
+            if (align(size) > N - start) {
+                _overflows++;
+                return nullptr;
+            }
+            *reinterpret_cast<size_t *>(block - kHeader) = size;
+            _used = start + align(size);
+            return block;
+        }
+        void *moved = allocate(size);
+        if (moved != nullptr) {
+            memcpy(moved, block, oldSize < size ? oldSize : size);
+        }
+        return moved;
+    }
+
+    void reset() {
+        _used = 0;
+        _last = nullptr;
+    }
+
+    size_t used() const { return _used; }
+    size_t capacity() const { return N; }
+    uint32_t overflows() const { return _overflows; }
+
+private:
+    static const size_t kAlign = 8;
+    static const size_t kHeader = kAlign; // Lưu kích thước khối, giữ căn lề 8 byte
+
+    static size_t align(size_t size) { return (size + kAlign - 1) & ~(kAlign - 1); }
+
+    alignas(8) uint8_t _buffer[N];
+    size_t _used;
+    uint8_t *_last;
+    uint32_t _overflows;
+};
+
+#endif // JSONARENA_H
@@ -0,0 +1,170 @@
+#include "MqttAckClient.h"
+#include <string.h>
+
+#define MQTT_CONNECT 1
+#define MQTT_PUBACK 4
+#define MQTT_CONNECT_MAX_SIZE 256
+
+MqttAckClient::MqttAckClient(Client &client, MqttPublisher &publisher)
+    : _client(client), _publisher(publisher), _unknownAcks(0)
+{
+    reset();
+}
+
+int MqttAckClient::connect(IPAddress ip, uint16_t port) {
+    reset();
+    return _client.connect(ip, port);
+}
+
+int MqttAckClient::connect(const char *host, uint16_t port) {
+    reset();
+    return _client.connect(host, port);
+}
+
+int MqttAckClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    reset();
+    return _client.connect(ip, port, timeout);
+}
+
+int MqttAckClient::connect(const char *host, uint16_t port, int32_t timeout) {
+    reset();
+    return _client.connect(host, port, timeout);
+}
+
+size_t MqttAckClient::write(const uint8_t *buffer, size_t size) {
+    if (_connectSent && size > 0 && (buffer[0] >> 4) == MQTT_CONNECT) {
+        _connectSent = false;
+        return size;
+    }
+    return _client.write(buffer, size);
+}
+
+static size_t appendString(uint8_t *packet, size_t position, const char *text) {
+    size_t length = strlen(text);
+    packet[position++] = length >> 8;
+    packet[position++] = length & 0xff;
+    memcpy(packet + position, text, length);
+    return position + length;
+}
+
+/**
+ * @name sendConnect
+ * @brief Gửi gói CONNECT trên kết nối TCP đã mở, không chờ CONNACK. Gói được ghi
+ *        một lần, giống hệt gói PubSubClient::connect() sẽ ghi với cùng tham số
+ * 
+ * @param {const char*} id - Client id
+ * @param {const char*} user - Tên người dùng, nullptr nếu không có
+ * @param {const char*} pass - Mật khẩu, nullptr nếu không có
+ * @param {uint16_t} keepAliveS - Keep alive (giây), phải bằng giá trị của PubSubClient
+ * 
+ * @return bool - False nếu gói quá lớn hoặc không ghi được
+ */
+bool MqttAckClient::sendConnect(const char *id, const char *user, const char *pass, uint16_t keepAliveS) {
+    reset();
+    size_t remaining = 10 + 2 + strlen(id) + (user != nullptr ? 2 + strlen(user) : 0) + (pass != nullptr ? 2 + strlen(pass) : 0);
+    if (remaining + 5 > MQTT_CONNECT_MAX_SIZE) {
+        return false;
+    }
+
+    uint8_t packet[MQTT_CONNECT_MAX_SIZE];
+    size_t position = 0;
+    packet[position++] = MQTT_CONNECT << 4;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        packet[position++] = remaining > 0 ? digit | 0x80 : digit;
+    } while (remaining > 0);
+    position = appendString(packet, position, "MQTT");
+    packet[position++] = 4; // MQTT 3.1.1
+    packet[position++] = 0x02 | (user != nullptr ? 0x80 : 0) | (pass != nullptr ? 0x40 : 0);
+    packet[position++] = keepAliveS >> 8;
+    packet[position++] = keepAliveS & 0xff;
+    position = appendString(packet, position, id);
+    if (user != nullptr) {
+        position = appendString(packet, position, user);
+    }
+    if (pass != nullptr) {
+        position = appendString(packet, position, pass);
+    }
+    if (_client.write(packet, position) != position) {
+        return false;
+    }
+    _connectSent = true;
+    return true;
+}
+
+int MqttAckClient::read() {
+    int c = _client.read();
+    if (c >= 0) {
+        feed(static_cast<uint8_t>(c));
+    }
+    return c;
+}
+
+int MqttAckClient::read(uint8_t *buffer, size_t size) {
+    int count = _client.read(buffer, size);
+    for (int i = 0; i < count; i++) {
+        feed(buffer[i]);
+    }
+    return count;
+}
+
+void MqttAckClient::stop() {
+    _client.stop();
+    reset();
+}
+
+void MqttAckClient::reset() {
+    _state = PARSE_HEADER;
+    _type = 0;
+    _remaining = 0;
+    _multiplier = 1;
+    _position = 0;
+    _packetId = 0;
+    _connectSent = false;
+}
+
+/**
+ * @name feed
+ * @brief Đưa một byte nhận được vào bộ tách gói MQTT: header cố định, độ dài
+ *        còn lại (varint) rồi phần thân; chỉ giữ lại packet id của PUBACK
+ * 
+ * @param {uint8_t} c - Byte nhận được
+ * 
+ * @return None
+ */
+void MqttAckClient::feed(uint8_t c) {
+    switch (_state) {
+    case PARSE_HEADER:
+        _type = c >> 4;
+        _remaining = 0;
+        _multiplier = 1;
+        _position = 0;
+        _packetId = 0;
+        _state = PARSE_LENGTH;
+        break;
+
+    case PARSE_LENGTH:
+        _remaining += (c & 0x7f) * _multiplier;
+        _multiplier *= 128;
+        if (c & 0x80) {
+            break;
+        }
+        _state = _remaining > 0 ? PARSE_BODY : PARSE_HEADER;
+        break;
+
+    case PARSE_BODY:
+        if (_type == MQTT_PUBACK && _position < 2) {
+            _packetId = (_packetId << 8) | c;
+        }
+        _position++;
+        if (_position < _remaining) {
+            break;
+        }
+        if (_type == MQTT_PUBACK && _position >= 2 && !_publisher.acknowledge(_packetId, millis())) {
+            _unknownAcks++;
+        }
+        _state = PARSE_HEADER;
+        break;
+    }
+}
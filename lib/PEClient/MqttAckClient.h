@@ -0,0 +1,68 @@
+#ifndef MQTTACKCLIENT_H
+#define MQTTACKCLIENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Client.h>
+#include "MqttPublisher.h"
+
+/**
+ * Client bọc kết nối tới broker, chuyển nguyên mọi byte cho PubSubClient và
+ * đọc lướt luồng gói tin nhận được để bắt PUBACK (PubSubClient bỏ qua loại
+ * gói này). Packet id của PUBACK được chuyển cho MqttPublisher.
+ *
+ * Kết nối MQTT không chờ: sendConnect() gửi CONNECT trước, task PEClient hỏi
+ * connackReady() ở các lần loop() sau, rồi mới gọi PubSubClient::connect() để
+ * đọc CONNACK đã có sẵn. CONNECT thứ hai mà PubSubClient ghi lúc đó bị bỏ.
+ */
+class MqttAckClient : public Client
+{
+public:
+    MqttAckClient(Client &client, MqttPublisher &publisher);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+    int connect(const char *host, uint16_t port, int32_t timeout) override;
+    size_t write(uint8_t c) override { return _client.write(c); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return _client.available(); }
+    int read() override;
+    int read(uint8_t *buffer, size_t size) override;
+    int peek() override { return _client.peek(); }
+    void flush() override { _client.flush(); }
+    void stop() override;
+    uint8_t connected() override { return _client.connected(); }
+    operator bool() override { return static_cast<bool>(_client); }
+
+    // Gửi CONNECT (MQTT 3.1.1, clean session) như PubSubClient::connect()
+    bool sendConnect(const char *id, const char *user, const char *pass, uint16_t keepAliveS);
+    // CONNACK (4 byte) đã nhận đủ: PubSubClient::connect() sẽ không phải chờ
+    bool connackReady() { return _client.available() >= 4; }
+
+    uint32_t unknownAcks() const { return _unknownAcks; }
+
+private:
+    enum ParseState : uint8_t {
+        PARSE_HEADER,
+        PARSE_LENGTH,
+        PARSE_BODY
+    };
+
+    void reset();
+    void feed(uint8_t c);
+
+    Client &_client;
+    MqttPublisher &_publisher;
+
+    ParseState _state;
+    uint8_t _type;
+    uint32_t _remaining;
+    uint32_t _multiplier;
+    uint32_t _position;
+    uint16_t _packetId;
+    bool _connectSent; // CONNECT kế tiếp từ PubSubClient là bản trùng
+    uint32_t _unknownAcks;
+};
+
+#endif // MQTTACKCLIENT_H
@@ -0,0 +1,277 @@
+#include "MqttPublisher.h"
+#include "Telemetry.h"
+#include <string.h>
+
+#define MQTT_PUBLISH_QOS1 0x32
+#define MQTT_PUBLISH_DUP 0x08
+
+MqttPublisher::MqttPublisher(size_t slots, size_t packetSize)
+    : _slotCount(slots > 0 ? slots : 1), _packetSize(packetSize), _window(PECLIENT_PUBLISH_WINDOW),
+      _ackTimeoutMs(PECLIENT_PUBACK_TIMEOUT_MS), _reserved(nullptr), _nextSequence(0), _nextPacketId(1),
+      _acked(0), _resent(0), _latencyAvgMs(0), _latencyMaxMs(0)
+{
+    portMUX_INITIALIZE(&_lock);
+    _slots = new Slot[_slotCount];
+    for (size_t i = 0; i < _slotCount; i++) {
+        memset(&_slots[i], 0, sizeof(Slot));
+        _slots[i].packet = new uint8_t[_packetSize];
+    }
+    setWindow(_window);
+}
+
+MqttPublisher::~MqttPublisher() {
+    for (size_t i = 0; i < _slotCount; i++) {
+        delete[] _slots[i].packet;
+    }
+    delete[] _slots;
+}
+
+/**
+ * @name setWindow
+ * @brief Đặt số gói tối đa đang chờ PUBACK
+ * 
+ * @param {size_t} window - Số gói, từ 1 tới số slot
+ * 
+ * @return None
+ */
+void MqttPublisher::setWindow(size_t window) {
+    _window = window < 1 ? 1 : window > _slotCount ? _slotCount : window;
+}
+
+/**
+ * @name maxPayload
+ * @brief Payload lớn nhất vừa một slot
+ * 
+ * @param {size_t} topicLength - Độ dài topic
+ * 
+ * @return size_t - Số byte
+ */
+size_t MqttPublisher::maxPayload(size_t topicLength) const {
+    // Header cố định (tối đa 5 byte), độ dài topic, topic, packet id, '\0' của serializeJson
+    size_t overhead = 5 + 2 + topicLength + 2 + 1;
+    return _packetSize > overhead ? _packetSize - overhead : 0;
+}
+
+/**
+ * @name begin
+ * @brief Giữ một slot và ghi sẵn header PUBLISH QoS1
+ * 
+ * @param {const char*} topic - Topic
+ * @param {size_t} length - Độ dài payload
+ * 
+ * @return uint8_t* - Vùng ghi payload (length + 1 byte), nullptr nếu hết slot
+ *         hoặc payload vượt maxPayload()
+ */
+uint8_t *MqttPublisher::begin(const char *topic, size_t length) {
+    size_t topicLength = strlen(topic);
+    if (_reserved != nullptr || length > maxPayload(topicLength)) {
+        return nullptr;
+    }
+
+    Slot *slot = nullptr;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < _slotCount; i++) {
+        if (_slots[i].state == SLOT_FREE) {
+            slot = &_slots[i];
+            slot->state = SLOT_RESERVED;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    if (slot == nullptr) {
+        return nullptr;
+    }
+
+    uint8_t *p = slot->packet;
+    *p++ = MQTT_PUBLISH_QOS1;
+    size_t remaining = 2 + topicLength + 2 + length;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        *p++ = remaining > 0 ? digit | 0x80 : digit;
+    } while (remaining > 0);
+    *p++ = topicLength >> 8;
+    *p++ = topicLength & 0xff;
+    memcpy(p, topic, topicLength);
+    p += topicLength;
+    slot->idOffset = p - slot->packet;
+    p += 2;
+    slot->length = p - slot->packet + length;
+    slot->dup = false;
+    _reserved = slot;
+    return p;
+}
+
+/**
+ * @name commit
+ * @brief Gán packet id và đưa gói vừa ghi vào hàng chờ gửi
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MqttPublisher::commit() {
+    Slot *slot = _reserved;
+    if (slot == nullptr) {
+        return;
+    }
+    _reserved = nullptr;
+
+    portENTER_CRITICAL(&_lock);
+    slot->packetId = _nextPacketId;
+    _nextPacketId = _nextPacketId == 0xffff ? 1 : _nextPacketId + 1;
+    slot->packet[slot->idOffset] = slot->packetId >> 8;
+    slot->packet[slot->idOffset + 1] = slot->packetId & 0xff;
+    slot->sequence = _nextSequence++;
+    slot->state = SLOT_QUEUED;
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name abort
+ * @brief Trả lại slot đã giữ bằng begin() mà không gửi
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MqttPublisher::abort() {
+    if (_reserved == nullptr) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    _reserved->state = SLOT_FREE;
+    portEXIT_CRITICAL(&_lock);
+    _reserved = nullptr;
+}
+
+/**
+ * @name poll
+ * @brief Gửi lại gói quá hạn PUBACK và gửi các gói đang chờ theo thứ tự khi cửa sổ còn chỗ
+ * 
+ * @param {Client&} client - Kết nối tới broker
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return None
+ */
+void MqttPublisher::poll(Client &client, unsigned long now) {
+    size_t inFlightCount = 0;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < _slotCount; i++) {
+        Slot &slot = _slots[i];
+        if (slot.state == SLOT_IN_FLIGHT && now - slot.sentAt >= _ackTimeoutMs) {
+            slot.state = SLOT_QUEUED;
+            slot.dup = true;
+        }
+        inFlightCount += slot.state == SLOT_IN_FLIGHT;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    while (inFlightCount < _window) {
+        // Slot QUEUED chỉ do task này xử lý, task gửi chỉ dùng slot FREE
+        Slot *next = nullptr;
+        portENTER_CRITICAL(&_lock);
+        for (size_t i = 0; i < _slotCount; i++) {
+            Slot &slot = _slots[i];
+            if (slot.state == SLOT_QUEUED && (next == nullptr || (int32_t)(slot.sequence - next->sequence) < 0)) {
+                next = &slot;
+            }
+        }
+        portEXIT_CRITICAL(&_lock);
+        if (next == nullptr) {
+            break;
+        }
+
+        if (next->dup) {
+            next->packet[0] |= MQTT_PUBLISH_DUP;
+            _resent++;
+            Telemetry::count(TELEMETRY_PUBLISH_RESENDS);
+        }
+        if (client.write(next->packet, next->length) != next->length) {
+            // Có thể đã gửi một phần: lần sau gửi lại với cờ DUP
+            next->dup = true;
+            Telemetry::count(TELEMETRY_PUBLISH_FAILURES);
+            break;
+        }
+        portENTER_CRITICAL(&_lock);
+        next->sentAt = now;
+        next->dup = false;
+        next->state = SLOT_IN_FLIGHT;
+        portEXIT_CRITICAL(&_lock);
+        inFlightCount++;
+    }
+    Telemetry::set(TELEMETRY_PUBLISH_IN_FLIGHT, inFlightCount);
+}
+
+/**
+ * @name acknowledge
+ * @brief Giải phóng gói đã có PUBACK và cập nhật độ trễ
+ * 
+ * @param {uint16_t} packetId - Packet id trong PUBACK
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return bool - False nếu không có gói nào đang chờ packet id này
+ */
+bool MqttPublisher::acknowledge(uint16_t packetId, unsigned long now) {
+    bool found = false;
+    uint32_t latency = 0;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < _slotCount; i++) {
+        Slot &slot = _slots[i];
+        if (slot.state == SLOT_IN_FLIGHT && slot.packetId == packetId) {
+            latency = now - slot.sentAt;
+            slot.state = SLOT_FREE;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    if (!found) {
+        return false;
+    }
+
+    _acked++;
+    // Trung bình trượt, trọng số 1/8 cho mẫu mới
+    _latencyAvgMs = _acked == 1 ? latency : _latencyAvgMs - _latencyAvgMs / 8 + latency / 8;
+    if (latency > _latencyMaxMs) {
+        _latencyMaxMs = latency;
+    }
+    Telemetry::set(TELEMETRY_PUBACK_LATENCY, _latencyAvgMs);
+    Telemetry::max(TELEMETRY_PUBACK_LATENCY_MAX, latency);
+    return true;
+}
+
+/**
+ * @name resendAll
+ * @brief Sau khi kết nối lại: đưa mọi gói chưa có PUBACK về hàng chờ để gửi lại với cờ DUP
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void MqttPublisher::resendAll() {
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < _slotCount; i++) {
+        if (_slots[i].state == SLOT_IN_FLIGHT) {
+            _slots[i].state = SLOT_QUEUED;
+            _slots[i].dup = true;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+size_t MqttPublisher::freeSlots() const {
+    size_t count = 0;
+    for (size_t i = 0; i < _slotCount; i++) {
+        count += _slots[i].state == SLOT_FREE;
+    }
+    return count;
+}
+
+size_t MqttPublisher::inFlight() const {
+    size_t count = 0;
+    for (size_t i = 0; i < _slotCount; i++) {
+        count += _slots[i].state == SLOT_IN_FLIGHT;
+    }
+    return count;
+}
@@ -0,0 +1,102 @@
+#ifndef MQTTPUBLISHER_H
+#define MQTTPUBLISHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <Client.h>
+
+#ifndef PECLIENT_PUBLISH_SLOTS
+#define PECLIENT_PUBLISH_SLOTS 8 // Số gói tin QoS1 được giữ (đang chờ gửi + đang chờ PUBACK)
+#endif
+
+#ifndef PECLIENT_PUBLISH_PACKET_SIZE
+#define PECLIENT_PUBLISH_PACKET_SIZE 1280 // Kích thước tối đa một gói PUBLISH (header + topic + payload)
+#endif
+
+#define PECLIENT_PUBLISH_WINDOW 4        // Số gói tối đa đang chờ PUBACK, mặc định
+#define PECLIENT_PUBACK_TIMEOUT_MS 20000 // Gửi lại (DUP) nếu không có PUBACK sau thời gian này
+
+/**
+ * Gửi PUBLISH QoS1 không chờ: task gửi ghi payload thẳng vào một slot cố định
+ * (begin()/commit()), task PEClient đẩy slot ra socket trong poll() khi cửa sổ
+ * còn chỗ và giải phóng slot khi nhận PUBACK (MqttAckClient gọi acknowledge()).
+ *
+ * - Hết slot thì begin() trả về nullptr: người gọi giữ lại dữ liệu (backpressure),
+ *   không có gì bị bỏ âm thầm.
+ * - Khi kết nối lại, các gói chưa có PUBACK được gửi lại với cờ DUP.
+ * - Độ trễ PUBLISH -> PUBACK được đo cho từng gói.
+ *
+ * Chỉ phụ thuộc Client của Arduino nên có thể chạy với broker thật hoặc một
+ * Client giả. begin()/commit()/abort() chỉ gọi từ một task; poll()/acknowledge()/
+ * resendAll() chỉ gọi từ task PEClient.
+ */
+class MqttPublisher
+{
+public:
+    explicit MqttPublisher(size_t slots = PECLIENT_PUBLISH_SLOTS, size_t packetSize = PECLIENT_PUBLISH_PACKET_SIZE);
+    ~MqttPublisher();
+
+    void setWindow(size_t window);
+    size_t window() const { return _window; }
+    void setAckTimeout(uint32_t ms) { _ackTimeoutMs = ms; }
+    // Payload lớn nhất gửi được trên topic có độ dài topicLength
+    size_t maxPayload(size_t topicLength) const;
+
+    // Trả về vùng ghi payload (length + 1 byte), nullptr nếu hết slot hoặc payload quá lớn
+    uint8_t *begin(const char *topic, size_t length);
+    void commit();
+    void abort();
+
+    void poll(Client &client, unsigned long now);
+    bool acknowledge(uint16_t packetId, unsigned long now);
+    void resendAll();
+
+    size_t freeSlots() const;
+    size_t inFlight() const;
+    size_t slots() const { return _slotCount; }
+
+    uint32_t acked() const { return _acked; }
+    uint32_t resent() const { return _resent; }
+    uint32_t latencyAvgMs() const { return _latencyAvgMs; }
+    uint32_t latencyMaxMs() const { return _latencyMaxMs; }
+
+private:
+    MqttPublisher(const MqttPublisher &);
+    MqttPublisher &operator=(const MqttPublisher &);
+
+    enum SlotState : uint8_t {
+        SLOT_FREE = 0,
+        SLOT_RESERVED,  // Task gửi đang ghi payload
+        SLOT_QUEUED,    // Chờ tới lượt gửi
+        SLOT_IN_FLIGHT  // Đã gửi, chờ PUBACK
+    };
+
+    struct Slot {
+        uint8_t *packet;
+        uint32_t sequence;
+        unsigned long sentAt;
+        uint16_t length;
+        uint16_t idOffset; // Vị trí packet id trong gói
+        uint16_t packetId;
+        uint8_t state;
+        bool dup;
+    };
+
+    Slot *_slots;
+    size_t _slotCount;
+    size_t _packetSize;
+    size_t _window;
+    uint32_t _ackTimeoutMs;
+    Slot *_reserved;
+    uint32_t _nextSequence;
+    uint16_t _nextPacketId;
+    portMUX_TYPE _lock;
+
+    uint32_t _acked;
+    uint32_t _resent;
+    uint32_t _latencyAvgMs;
+    uint32_t _latencyMaxMs;
+};
+
+#endif // MQTTPUBLISHER_H
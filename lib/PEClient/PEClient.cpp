@@ -1,4 +1,6 @@
 #include "PEClient.h"
+#include "Telemetry.h"
+#include <new>
 
 PEClient *PEClient::_instance = nullptr;
 
@@ -17,18 +19,43 @@ PEClient *PEClient::_instance = nullptr;
  * @return None
  */
 PEClient::PEClient(const char *wifiSSID, const char *wifiPassword, const char *mqttServer, int mqttPort, const char *clientId, const char *username, const char *password)
-    : _ssid(wifiSSID), _password(wifiPassword), _mqttServer(mqttServer), _mqttPort(mqttPort), _clientId(clientId), _username(username), _passwordMqtt(password), _client(_espClient)
+    : _ssid(wifiSSID), _password(wifiPassword), _mqttServer(mqttServer), _mqttPort(mqttPort), _clientId(clientId), _username(username), _passwordMqtt(password),
+      _mqttResolved(false), _mqttStep(MQTT_STEP_IDLE), _mqttStepSince(0),
+      _ackClient(_espClient, _publisher), _client(_ackClient), _socketLock(xSemaphoreCreateRecursiveMutex()),
+      _state(STATE_WIFI_CONNECTING), _stateSince(0), _nextAttemptAt(0), _backoffMs(PECLIENT_BACKOFF_MIN_MS), _reconnects(0),
+      _batchDoc(&_batchArena), _batchGroupTs(0), _batchCount(0), _batchBytes(0), _batchStartedAt(0),
+      _codec(CODEC_JSON)
 {
     _client.setServer(_mqttServer, _mqttPort);
     _client.setCallback(callback);
+    // connectMqtt() tự mở kết nối TCP và gửi CONNECT với cùng keep alive
+    _client.setKeepAlive(PECLIENT_KEEPALIVE_S);
+    _client.setSocketTimeout(PECLIENT_SOCKET_TIMEOUT_S);
+    memset(_transitions, 0, sizeof(_transitions));
 
-    _sendMetricTopic = "v1/devices/";
-    _sendMetricTopic += _clientId;
-    _sendMetricTopic += "/metrics";
+    updateTopics();
+    setBatchLimits(20, 1024, 1000);
 
-    _sendAttributeTopic = "v1/devices/";
-    _sendAttributeTopic += _clientId;
-    _sendAttributeTopic += "/attributes";
+    RpcDispatcher::Handler keys = [this](const RpcValue &value)
+    {
+        if (value.type == RpcValue::RPC_STRING)
+        {
+            _request.keys = value.str;
+        }
+    };
+    _requestFields.on("keys", keys);
+    _requestFields.on("clientKeys", keys);
+    _requestFields.on("method", [this](const RpcValue &value)
+    {
+        if (value.type == RpcValue::RPC_STRING)
+        {
+            _request.method = value.str;
+        }
+    });
+    _requestFields.on("params", [this](const RpcValue &value)
+    {
+        _requestParams = value;
+    });
 
     _instance = this;
 }
@@ -66,7 +93,7 @@ void PEClient::begin()
 
 /**
  * @name loop
- * @brief Vòng lặp chính của PEClient
+ * @brief Vòng lặp chính của PEClient, điều khiển máy trạng thái kết nối mà không chờ
  * 
  * @param None
  * 
@@ -74,11 +101,73 @@ void PEClient::begin()
  */
 void PEClient::loop()
 {
-    if (!_client.connected())
+    unsigned long now = millis();
+    switch (_state)
     {
-        reconnect();
+    case STATE_WIFI_CONNECTING:
+        if (WiFi.status() == WL_CONNECTED)
+        {
+            ESP_LOGI("PEClient", "Connected to the WiFi network");
+            ESP_LOGI("PEClient", "IP address: %s", WiFi.localIP().toString().c_str());
+            _nextAttemptAt = now;
+            setState(STATE_MQTT_CONNECTING);
+        }
+        else if (now - _stateSince >= PECLIENT_WIFI_CONNECT_TIMEOUT_MS)
+        {
+            ESP_LOGE("PEClient", "WiFi connection timed out, status: %d", WiFi.status());
+            WiFi.disconnect();
+            scheduleRetry();
+            setState(STATE_WIFI_BACKOFF);
+        }
+        break;
+
+    case STATE_WIFI_BACKOFF:
+        if ((long)(now - _nextAttemptAt) >= 0)
+        {
+            initWiFi();
+        }
+        break;
+
+    case STATE_MQTT_CONNECTING:
+        if (WiFi.status() != WL_CONNECTED)
+        {
+            abortMqtt();
+            initWiFi();
+        }
+        else if (_mqttStep != MQTT_STEP_IDLE || (long)(now - _nextAttemptAt) >= 0)
+        {
+            connectMqtt(now);
+        }
+        break;
+
+    case STATE_CONNECTED:
+        xSemaphoreTakeRecursive(_socketLock, portMAX_DELAY);
+        if (!_client.connected())
+        {
+            ESP_LOGE("PEClient", "MQTT connection lost, rc=%d", _client.state());
+            _reconnects++;
+            Telemetry::count(TELEMETRY_RECONNECTS);
+            _nextAttemptAt = now;
+            if (WiFi.status() == WL_CONNECTED)
+            {
+                setState(STATE_MQTT_CONNECTING);
+            }
+            else
+            {
+                initWiFi();
+            }
+            xSemaphoreGiveRecursive(_socketLock);
+            break;
+        }
+        // Callback của yêu cầu RPC/thuộc tính có thể trả lời ngay trong loop()
+        _client.loop();
+        _publisher.poll(_ackClient, now);
+        xSemaphoreGiveRecursive(_socketLock);
+        break;
+
+    default:
+        break;
     }
-    _client.loop();
 }
 
 /**
@@ -91,13 +180,93 @@ void PEClient::loop()
  */
 boolean PEClient::connected()
 {
-    return _client.connected();
+    if (_state != STATE_CONNECTED || xSemaphoreTakeRecursive(_socketLock, pdMS_TO_TICKS(PECLIENT_SOCKET_LOCK_MS)) != pdTRUE)
+    {
+        return false;
+    }
+    boolean connected = _client.connected();
+    xSemaphoreGiveRecursive(_socketLock);
+    return connected;
+}
+
+/**
+ * @name onConnect
+ * @brief Đăng ký hàm callback mỗi khi kết nối MQTT thành công (chạy trong task PEClient)
+ * 
+ * @param {std::function<void()>} callback - Hàm callback
+ * 
+ * @return None
+ */
+void PEClient::onConnect(std::function<void()> callback)
+{
+    _onConnect = callback;
 }
 
+/**
+ * @name stateName
+ * @brief Tên trạng thái kết nối để ghi log hoặc gửi lên server
+ * 
+ * @param {ConnectionState} state - Trạng thái
+ * 
+ * @return const char* - Tên trạng thái
+ */
+const char *PEClient::stateName(ConnectionState state)
+{
+    switch (state)
+    {
+    case STATE_WIFI_CONNECTING:
+        return "wifi_connecting";
+    case STATE_WIFI_BACKOFF:
+        return "wifi_backoff";
+    case STATE_MQTT_CONNECTING:
+        return "mqtt_connecting";
+    case STATE_CONNECTED:
+        return "connected";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @name setState
+ * @brief Chuyển trạng thái kết nối và đếm số lần chuyển
+ * 
+ * @param {ConnectionState} state - Trạng thái mới
+ * 
+ * @return None
+ */
+void PEClient::setState(ConnectionState state)
+{
+    if (state == _state)
+    {
+        return;
+    }
+    ESP_LOGI("PEClient", "State %s -> %s", stateName(_state), stateName(state));
+    _state = state;
+    _stateSince = millis();
+    _transitions[state]++;
+}
+
+/**
+ * @name scheduleRetry
+ * @brief Hẹn lần thử lại tiếp theo với backoff lũy thừa và jitter ±25%
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::scheduleRetry()
+{
+    uint32_t jitter = _backoffMs / 2;
+    uint32_t delayMs = _backoffMs - jitter / 2 + (jitter > 0 ? esp_random() % jitter : 0);
+    _nextAttemptAt = millis() + delayMs;
+    ESP_LOGI("PEClient", "Retry in %u ms", delayMs);
+    _backoffMs = std::min<uint32_t>(_backoffMs * 2, PECLIENT_BACKOFF_MAX_MS);
+}
 
 /**
  * @name initWiFi
- * @brief Khởi tạo kết nối WiFi
+ * @brief Bắt đầu kết nối WiFi, kết quả được kiểm tra trong loop()
  * 
  * @param None
  * 
@@ -108,51 +277,191 @@ void PEClient::initWiFi()
     WiFi.mode(WIFI_STA);
     WiFi.begin(_ssid, _password);
     ESP_LOGI("PEClient", "Connecting to the WiFi network");
-    while (WiFi.status() != WL_CONNECTED)
-    {
-        Serial.print('.');
-        delay(1000);
-        ESP_LOGI("PEClient", "WiFi status: %d", WiFi.status());
-        if(WiFi.status() == WL_DISCONNECTED || WiFi.status() == WL_CONNECTION_LOST || WiFi.status() == WL_CONNECT_FAILED) {
-            ESP_LOGE("PEClient", "WiFi disconnected");
-            ESP.restart();
-        }
-    }
-    ESP_LOGI("PEClient", "Connected to the WiFi network");
-    ESP_LOGI("PEClient", "IP address: %s", WiFi.localIP().toString().c_str());
+    setState(STATE_WIFI_CONNECTING);
+    _stateSince = millis();
 }
 
 /**
- * @name reconnect
- * @brief Kết nối lại với MQTT
+ * @name connectMqtt
+ * @brief Đưa lần kết nối MQTT đang chạy đi tiếp tới đâu được mà không chờ mạng:
+ *        tra DNS (chỉ lần đầu và sau khi kết nối TCP thất bại), mở kết nối TCP,
+ *        gửi CONNECT rồi đọc CONNACK. Bước chưa xong được kiểm tra lại ở lần
+ *        loop() sau; quá thời gian hoặc thất bại thì hẹn thử lại. _socketLock chỉ
+ *        được giữ khi ghi/đọc những gì đã có sẵn trên socket
  * 
- * @param None
+ * @param {unsigned long} now - millis() của lần loop() này
  * 
  * @return None
  */
-void PEClient::reconnect()
+void PEClient::connectMqtt(unsigned long now)
 {
-    while (!_client.connected())
+    if (_mqttStep == MQTT_STEP_IDLE)
     {
-        if (WiFi.status() != WL_CONNECTED)
+        ESP_LOGI("PEClient", "Attempting MQTT connection...");
+        // Đóng phiên cũ trước khi mở socket mới
+        xSemaphoreTakeRecursive(_socketLock, portMAX_DELAY);
+        _ackClient.stop();
+        xSemaphoreGiveRecursive(_socketLock);
+        if (!_mqttResolved)
         {
-            initWiFi();
+            if (!_resolver.start(_mqttServer))
+            {
+                ESP_LOGE("PEClient", "Cannot resolve %s", _mqttServer);
+                retryMqtt();
+                return;
+            }
+            setMqttStep(MQTT_STEP_RESOLVING, now);
         }
-        ESP_LOGI("PEClient", "Attempting MQTT connection...");
-        if (_client.connect(_clientId, _username, _passwordMqtt))
+    }
+
+    if (_mqttStep == MQTT_STEP_RESOLVING)
+    {
+        DnsResolver::Status status = _resolver.poll(_mqttAddress);
+        if (status == DnsResolver::DNS_PENDING && now - _mqttStepSince < PECLIENT_DNS_TIMEOUT_MS)
         {
-            ESP_LOGI("PEClient", "connected");
-            String topic = "v1/devices/";
-            topic += _clientId;
-            topic += "/attributes/set";
-            _client.subscribe(topic.c_str());
+            return;
+        }
+        if (status != DnsResolver::DNS_DONE)
+        {
+            ESP_LOGE("PEClient", "Cannot resolve %s", _mqttServer);
+            retryMqtt();
+            return;
+        }
+        _resolver.cancel();
+        _mqttResolved = true;
+    }
+
+    if (_mqttStep == MQTT_STEP_IDLE || _mqttStep == MQTT_STEP_RESOLVING)
+    {
+        // Lỗi khi bắt đầu kết nối được báo ở poll() bên dưới
+        _connector.start(_mqttAddress, _mqttPort);
+        setMqttStep(MQTT_STEP_TCP, now);
+    }
+
+    if (_mqttStep == MQTT_STEP_TCP)
+    {
+        TcpConnector::Status status = _connector.poll();
+        if (status == TcpConnector::TCP_CONNECTING && now - _mqttStepSince < PECLIENT_TCP_CONNECT_TIMEOUT_MS)
+        {
+            return;
+        }
+        if (status != TcpConnector::TCP_CONNECTED)
+        {
+            // Địa chỉ có thể đã đổi: tra lại DNS ở lần thử sau
+            ESP_LOGE("PEClient", "TCP connection to %s failed", _mqttServer);
+            _mqttResolved = false;
+            retryMqtt();
+            return;
+        }
+        setMqttStep(MQTT_STEP_CONNACK, now);
+        xSemaphoreTakeRecursive(_socketLock, portMAX_DELAY);
+        _espClient = WiFiClient(_connector.release());
+        bool sent = _ackClient.sendConnect(_clientId, _username, _passwordMqtt, PECLIENT_KEEPALIVE_S);
+        xSemaphoreGiveRecursive(_socketLock);
+        if (!sent)
+        {
+            ESP_LOGE("PEClient", "Cannot send CONNECT");
+            retryMqtt();
+            return;
+        }
+    }
+
+    // MQTT_STEP_CONNACK: PubSubClient chỉ được gọi khi CONNACK đã có trên socket,
+    // nên connect() đọc ngay mà không chờ; CONNECT nó ghi lại bị _ackClient bỏ
+    xSemaphoreTakeRecursive(_socketLock, portMAX_DELAY);
+    bool ready = _ackClient.connackReady();
+    bool lost = !ready && !_ackClient.connected();
+    bool ok = ready && _client.connect(_clientId, _username, _passwordMqtt);
+    if (ok)
+    {
+        char topic[96];
+        snprintf(topic, sizeof(topic), "v1/devices/%s/attributes/set", _clientId);
+        _client.subscribe(topic);
+        snprintf(topic, sizeof(topic), "v1/devices/%s/attributes/request/+", _clientId);
+        _client.subscribe(topic);
+        snprintf(topic, sizeof(topic), "v1/devices/%s/rpc/request/+", _clientId);
+        _client.subscribe(topic);
+        // Gói chưa có PUBACK trước khi mất kết nối được gửi lại trong poll()
+        _publisher.resendAll();
+    }
+    xSemaphoreGiveRecursive(_socketLock);
+
+    if (!ready && !lost && now - _mqttStepSince < PECLIENT_CONNACK_TIMEOUT_MS)
+    {
+        return;
+    }
+    if (!ok)
+    {
+        if (ready)
+        {
+            ESP_LOGE("PEClient", "failed, rc=%d", _client.state());
         }
         else
         {
-            ESP_LOGE("PEClient", "failed, rc=%d try again in 5 seconds", _client.state());
-            delay(5000);
+            ESP_LOGE("PEClient", "No CONNACK from %s", _mqttServer);
         }
+        retryMqtt();
+        return;
+    }
+
+    ESP_LOGI("PEClient", "connected");
+    setMqttStep(MQTT_STEP_IDLE, now);
+    _backoffMs = PECLIENT_BACKOFF_MIN_MS;
+    setState(STATE_CONNECTED);
+    if (_onConnect)
+    {
+        _onConnect();
+    }
+}
+
+/**
+ * @name setMqttStep
+ * @brief Chuyển sang bước kết nối MQTT tiếp theo, thời gian chờ của bước tính từ now
+ * 
+ * @param {MqttStep} step - Bước mới
+ * @param {unsigned long} now - millis() hiện tại
+ * 
+ * @return None
+ */
+void PEClient::setMqttStep(MqttStep step, unsigned long now)
+{
+    _mqttStep = step;
+    _mqttStepSince = now;
+}
+
+/**
+ * @name abortMqtt
+ * @brief Bỏ lần kết nối MQTT đang chạy: hủy tra DNS, đóng socket đang mở
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::abortMqtt()
+{
+    _resolver.cancel();
+    _connector.cancel();
+    if (_mqttStep == MQTT_STEP_CONNACK)
+    {
+        xSemaphoreTakeRecursive(_socketLock, portMAX_DELAY);
+        _ackClient.stop();
+        xSemaphoreGiveRecursive(_socketLock);
     }
+    _mqttStep = MQTT_STEP_IDLE;
+}
+
+/**
+ * @name retryMqtt
+ * @brief Bỏ lần kết nối MQTT đang chạy và hẹn thử lại
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::retryMqtt()
+{
+    abortMqtt();
+    scheduleRetry();
 }
 
 /**
@@ -167,33 +476,59 @@ void PEClient::reconnect()
  */
 void PEClient::callback(char *topic, byte *message, unsigned int length)
 {
-    String messageTemp;
-    for (int i = 0; i < length; i++)
+    ESP_LOGD("PEClient", "Message arrived on topic: %s (%u bytes)", topic, length);
+
+    if (strstr(topic, "/request/") != nullptr)
     {
-        messageTemp += (char)message[i];
+        _instance->handleRequest(topic, reinterpret_cast<char *>(message), length);
+        return;
     }
 
-    ESP_LOGD("PEClient", "Message arrived on topic: %s. Message: %s", topic, messageTemp.c_str());
+    // Phân tích ngay trong bộ đệm của PubSubClient, không sao chép payload
+    if (!_instance->_rpc.dispatch(reinterpret_cast<char *>(message), length))
+    {
+        ESP_LOGE("PEClient", "Invalid RPC payload on %s (%u errors)", topic, _instance->_rpc.parseErrors());
+    }
+}
+
+/**
+ * @name handleRequest
+ * @brief Đọc yêu cầu "keys"/"clientKeys" (thuộc tính) hoặc "method"/"params" (RPC)
+ *        ngay trong bộ đệm và chuyển cho hàm đã đăng ký bằng onRequest
+ * 
+ * @param {const char*} topic - Topic ".../attributes/request/<id>" hoặc ".../rpc/request/<id>"
+ * @param {char*} message - Payload (có thể rỗng)
+ * @param {unsigned int} length - Độ dài payload
+ * 
+ * @return None
+ */
+void PEClient::handleRequest(const char *topic, char *message, unsigned int length)
+{
+    _request.rpc = strstr(topic, "/rpc/request/") != nullptr;
+    _request.id = strrchr(topic, '/') + 1;
+    _request.method = nullptr;
+    _request.keys = nullptr;
+    _requestParams.type = RpcValue::RPC_NULL;
 
-    // Parse the JSON message
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, messageTemp);
-    if (error)
+    if (length > 0 && !_requestFields.dispatch(message, length))
     {
-        ESP_LOGE("PEClient", "deserializeJson() failed: %s", error.c_str());
+        ESP_LOGE("PEClient", "Invalid request payload on %s", topic);
         return;
     }
-
-    JsonObject obj = doc.as<JsonObject>();
-    for (JsonPair kv : obj)
+    // "params" của RPC là chuỗi khóa hoặc object có "keys"
+    if (_requestParams.type == RpcValue::RPC_STRING)
+    {
+        _request.keys = _requestParams.str;
+    }
+    else if (_requestParams.type == RpcValue::RPC_RAW && !_requestFields.dispatch(const_cast<char *>(_requestParams.str), _requestParams.length))
     {
-        String key = kv.key().c_str();
-        String value = kv.value().as<String>();
+        ESP_LOGE("PEClient", "Invalid RPC params on %s", topic);
+        return;
+    }
 
-        if (_instance->_callbacks.find(key) != _instance->_callbacks.end())
-        {
-            _instance->_callbacks[key](value);
-        }
+    if (_onRequest)
+    {
+        _onRequest(_request);
     }
 }
 
@@ -209,21 +544,19 @@ void PEClient::callback(char *topic, byte *message, unsigned int length)
  */
 void PEClient::sendMetric(uint64_t timestamp, const char *key, double value)
 {
-    if (!_client.connected())
+    if (_state != STATE_CONNECTED)
     {
         return;
     }
-    JsonDocument doc;
+    JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
     doc["ts"] = timestamp;
 
     JsonObject metrics = doc["metrics"].to<JsonObject>();
     metrics[key] = value;
 
-    char buffer[256];
-    serializeJson(doc, buffer);
-
-    _client.publish(_sendMetricTopic.c_str(), buffer);
-    ESP_LOGI("PEClient", "Send metric: %s", buffer);
+    publishDocument(_sendMetricTopic.c_str(), doc);
+    ESP_LOGI("PEClient", "Send metric: %s=%f", key, value);
 }
 
 /**
@@ -237,19 +570,277 @@ void PEClient::sendMetric(uint64_t timestamp, const char *key, double value)
  */
 void PEClient::sendMetric(const char *key, double value)
 {
-    if (!_client.connected())
+    if (_state != STATE_CONNECTED)
     {
         return;
     }
-    JsonDocument doc;
+    JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
 
     JsonObject metrics = doc["metrics"].to<JsonObject>();
     metrics[key] = value;
 
-    char buffer[256];
-    serializeJson(doc, buffer);
+    publishDocument(_sendMetricTopic.c_str(), doc);
+}
+
+/**
+ * @name setBatchLimits
+ * @brief Cấu hình giới hạn gom metric: gói tin được gửi khi đạt số metric, số byte
+ *        hoặc thời gian chờ tối đa, tùy điều kiện nào đến trước
+ * 
+ * @param {size_t} maxMetrics - Số metric tối đa trong một gói tin
+ * @param {size_t} maxBytes - Kích thước payload tối đa (byte)
+ * @param {uint32_t} maxLatencyMs - Thời gian giữ metric tối đa (ms)
+ * 
+ * @return None
+ */
+void PEClient::setBatchLimits(size_t maxMetrics, size_t maxBytes, uint32_t maxLatencyMs)
+{
+    if (_batchCount > 0)
+    {
+        flushMetrics();
+    }
+    _batchMaxMetrics = maxMetrics > 0 ? maxMetrics : 1;
+    // Gói metric phải vừa một slot của _publisher (kể cả topic có hậu tố "/msgpack")
+    _batchMaxBytes = std::min(maxBytes, _publisher.maxPayload(_sendMetricTopic.length() + 8));
+    _batchMaxLatencyMs = maxLatencyMs;
+    if (_batchCount == 0)
+    {
+        resetBatch();
+    }
+}
+
+/**
+ * @name addMetric
+ * @brief Thêm một metric vào gói tin đang gom. Các metric liên tiếp có cùng ts
+ *        được ghép vào cùng một nhóm
+ * 
+ * @param {uint64_t} timestamp - Thời gian
+ * @param {const char*} key - Tên thông số
+ * @param {double} value - Giá trị
+ * 
+ * @return bool - False nếu metric không được nhận: gói tin đầy và cửa sổ QoS1 chưa
+ *         có chỗ, hoặc arena của gói tin bị tràn
+ */
+bool PEClient::addMetric(uint64_t timestamp, const char *key, double value)
+{
+    // Ước lượng dư: "key":<tối đa 24 ký tự số>,
+    size_t metricBytes = strlen(key) + 28;
+    // {"ts":<20 chữ số>,"metrics":{}},
+    size_t groupBytes = (_batchCount == 0 || timestamp != _batchGroupTs) ? 40 : 0;
+
+    if (_batchCount > 0 && _batchBytes + groupBytes + metricBytes > _batchMaxBytes)
+    {
+        if (!flushMetrics())
+        {
+            return false;
+        }
+        groupBytes = 40;
+    }
+
+    if (_batchCount == 0)
+    {
+        _batchStartedAt = millis();
+        _batchBytes = 2; // []
+    }
+    if (groupBytes > 0)
+    {
+        JsonObject group = _batchDoc.as<JsonArray>().add<JsonObject>();
+        group["ts"] = timestamp;
+        _batchGroup = group["metrics"].to<JsonObject>();
+        _batchGroupTs = timestamp;
+    }
+    _batchGroup[key] = value;
+    if (_batchDoc.overflowed())
+    {
+        // Giới hạn gói tin lớn hơn arena: gửi phần đã gom, metric này do người gọi giữ lại
+        ESP_LOGE("PEClient", "Metric batch arena full, rejected %s", key);
+        flushMetrics();
+        return false;
+    }
+    _batchBytes += groupBytes + metricBytes;
+    _batchCount++;
+
+    if (_batchCount >= _batchMaxMetrics || _batchBytes >= _batchMaxBytes)
+    {
+        // Cửa sổ đầy thì gói tin được giữ lại và gửi ở lần sau
+        flushMetrics();
+    }
+    return true;
+}
+
+/**
+ * @name pollMetrics
+ * @brief Gửi gói tin đang gom nếu đã quá thời gian chờ tối đa
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::pollMetrics()
+{
+    if (_batchCount > 0 && millis() - _batchStartedAt >= _batchMaxLatencyMs)
+    {
+        flushMetrics();
+    }
+}
+
+/**
+ * @name flushMetrics
+ * @brief Đưa toàn bộ metric đang gom vào hàng gửi QoS1 của topic /metrics dưới dạng
+ *        [{"ts":...,"metrics":{...}}, ...]
+ * 
+ * @param None
+ * 
+ * @return bool - True nếu đã vào hàng gửi hoặc không có gì để gửi, false nếu cửa sổ
+ *         QoS1 đầy (gói tin được giữ lại)
+ */
+bool PEClient::flushMetrics()
+{
+    if (_batchCount == 0)
+    {
+        return true;
+    }
+
+    size_t length = measureDocument(_batchDoc);
+    if (length > _batchMaxBytes)
+    {
+        ESP_LOGE("PEClient", "Metric batch exceeds %u bytes, dropped", (unsigned)_batchMaxBytes);
+        Telemetry::count(TELEMETRY_PUBLISH_FAILURES);
+        resetBatch();
+        return true;
+    }
+    // Serialize thẳng vào slot của gói PUBLISH, task này không chờ socket
+    uint8_t *payload = _publisher.begin(_sendMetricTopic.c_str(), length);
+    if (payload == nullptr)
+    {
+        return false;
+    }
+    serializeDocument(_batchDoc, reinterpret_cast<char *>(payload), length + 1);
+    _publisher.commit();
+    ESP_LOGI("PEClient", "Queued %u metrics", (unsigned)_batchCount);
+    resetBatch();
+    return true;
+}
+
+/**
+ * @name setCodec
+ * @brief Chọn định dạng payload gửi lên. MessagePack được gửi trên topic có hậu tố
+ *        "/msgpack" để server phân biệt
+ * 
+ * @param {PayloadCodec} codec - CODEC_JSON hoặc CODEC_MSGPACK
+ * 
+ * @return None
+ */
+void PEClient::setCodec(PayloadCodec codec)
+{
+    if (_batchCount > 0)
+    {
+        flushMetrics();
+    }
+    _codec = codec;
+    updateTopics();
+}
+
+/**
+ * @name updateTopics
+ * @brief Tạo lại topic gửi metric/thuộc tính theo định dạng payload
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::updateTopics()
+{
+    const char *suffix = _codec == CODEC_MSGPACK ? "/msgpack" : "";
+
+    _sendMetricTopic = "v1/devices/";
+    _sendMetricTopic += _clientId;
+    _sendMetricTopic += "/metrics";
+    _sendMetricTopic += suffix;
 
-    _client.publish(_sendMetricTopic.c_str(), buffer);
+    _sendAttributeTopic = "v1/devices/";
+    _sendAttributeTopic += _clientId;
+    _sendAttributeTopic += "/attributes";
+    _sendAttributeTopic += suffix;
+}
+
+/**
+ * @name publishDocument
+ * @brief Mã hóa document theo định dạng đã chọn và gửi đi (QoS0). Bộ đệm được cấp
+ *        theo đúng kích thước payload nếu bộ đệm trên stack không đủ chỗ. Gói tin
+ *        được ghi khi giữ _socketLock; chờ khóa quá PECLIENT_SOCKET_LOCK_MS thì thất bại
+ * 
+ * @param {const char*} topic - Topic
+ * @param {JsonDocument&} doc - Dữ liệu
+ * 
+ * @return bool - True nếu gửi thành công
+ */
+bool PEClient::publishDocument(const char *topic, JsonDocument &doc)
+{
+    size_t length = measureDocument(doc);
+
+    char stackBuffer[PECLIENT_STACK_PAYLOAD_SIZE];
+    char *payload = length < sizeof(stackBuffer) ? stackBuffer : new (std::nothrow) char[length + 1];
+
+    bool ok = false;
+    if (payload != nullptr)
+    {
+        serializeDocument(doc, payload, length + 1);
+        if (xSemaphoreTakeRecursive(_socketLock, pdMS_TO_TICKS(PECLIENT_SOCKET_LOCK_MS)) == pdTRUE)
+        {
+            ok = _client.connected() &&
+                 _client.beginPublish(topic, length, false) &&
+                 _client.write(reinterpret_cast<const uint8_t *>(payload), length) == length &&
+                 _client.endPublish();
+            xSemaphoreGiveRecursive(_socketLock);
+        }
+    }
+
+    if (payload != stackBuffer)
+    {
+        delete[] payload;
+    }
+    if (!ok)
+    {
+        Telemetry::count(TELEMETRY_PUBLISH_FAILURES);
+    }
+    return ok;
+}
+
+size_t PEClient::measureDocument(JsonDocument &doc) const
+{
+    return _codec == CODEC_MSGPACK ? measureMsgPack(doc) : measureJson(doc);
+}
+
+void PEClient::serializeDocument(JsonDocument &doc, char *buffer, size_t size) const
+{
+    if (_codec == CODEC_MSGPACK)
+    {
+        serializeMsgPack(doc, buffer, size);
+    }
+    else
+    {
+        serializeJson(doc, buffer, size);
+    }
+}
+
+/**
+ * @name resetBatch
+ * @brief Xóa gói tin đang gom
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void PEClient::resetBatch()
+{
+    _batchDoc.clear();
+    _batchArena.reset();
+    _batchDoc.to<JsonArray>();
+    _batchGroup = JsonObject();
+    _batchCount = 0;
+    _batchBytes = 0;
 }
 
 /**
@@ -263,19 +854,17 @@ void PEClient::sendMetric(const char *key, double value)
  */
 void PEClient::sendAttribute(const char *key, double value)
 {
-    if (!_client.connected())
+    if (_state != STATE_CONNECTED)
     {
         return;
     }
-    JsonDocument doc;
+    JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
 
     JsonObject attributes = doc["attributes"].to<JsonObject>();
     attributes[key] = value;
 
-    char buffer[256];
-    serializeJson(doc, buffer);
-
-    _client.publish(_sendAttributeTopic.c_str(), buffer);
+    publishDocument(_sendAttributeTopic.c_str(), doc);
 }
 
 /**
@@ -289,19 +878,43 @@ void PEClient::sendAttribute(const char *key, double value)
  */
 void PEClient::sendAttribute(const char *key, const char *value)
 {
-    if (!_client.connected())
+    if (_state != STATE_CONNECTED)
     {
         return;
     }
-    JsonDocument doc;
+    JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
 
     JsonObject attributes = doc["attributes"].to<JsonObject>();
     attributes[key] = value;
 
-    char buffer[256];
-    serializeJson(doc, buffer);
+    if (!doc.overflowed())
+    {
+        publishDocument(_sendAttributeTopic.c_str(), doc);
+        return;
+    }
 
-    _client.publish(_sendAttributeTopic.c_str(), buffer);
+    // Giá trị quá lớn cho arena (vd. danh sách thiết bị): hiếm gặp, dùng heap
+    JsonDocument heapDoc;
+    heapDoc["attributes"][key] = value;
+    publishDocument(_sendAttributeTopic.c_str(), heapDoc);
+}
+
+/**
+ * @name sendAttributes
+ * @brief Gửi nhiều thông số trong một gói tin
+ * 
+ * @param {JsonDocument&} doc - Dữ liệu dạng {"attributes": {...}}
+ * 
+ * @return bool - True nếu gửi thành công
+ */
+bool PEClient::sendAttributes(JsonDocument &doc)
+{
+    if (_state != STATE_CONNECTED)
+    {
+        return false;
+    }
+    return publishDocument(_sendAttributeTopic.c_str(), doc);
 }
 
 /**
@@ -309,11 +922,59 @@ void PEClient::sendAttribute(const char *key, const char *value)
  * @brief Đăng ký callback cho một thông số
  * 
  * @param {const char*} key - Tên thông số
- * @param {void (*)(String)} callback - Hàm callback
+ * @param {RpcDispatcher::Handler} callback - Hàm callback
  * 
  * @return None
  */
-void PEClient::on(const char *key, void (*callback)(String))
+void PEClient::on(const char *key, RpcDispatcher::Handler callback)
 {
-    _callbacks[key] = std::bind(callback, std::placeholders::_1);
-}
\ No newline at end of file
+    _rpc.on(key, callback);
+}
+
+/**
+ * @name onDevice
+ * @brief Đăng ký callback cho thông số của thiết bị Zigbee ("<key>_<deviceId>")
+ * 
+ * @param {const char*} key - Tên thông số, "*" cho mọi thông số
+ * @param {RpcDispatcher::DeviceHandler} callback - Hàm callback
+ * 
+ * @return None
+ */
+void PEClient::onDevice(const char *key, RpcDispatcher::DeviceHandler callback)
+{
+    _rpc.onDevice(key, callback);
+}
+
+/**
+ * @name onRequest
+ * @brief Đăng ký hàm trả lời yêu cầu đọc dữ liệu từ server (chạy trong task PEClient)
+ * 
+ * @param {RequestHandler} callback - Hàm callback, trả lời bằng respond()
+ * 
+ * @return None
+ */
+void PEClient::onRequest(RequestHandler callback)
+{
+    _onRequest = callback;
+}
+
+/**
+ * @name respond
+ * @brief Gửi câu trả lời lên ".../attributes/response/<id>" hoặc ".../rpc/response/<id>"
+ * 
+ * @param {const Request&} request - Yêu cầu nhận được
+ * @param {JsonDocument&} doc - Câu trả lời
+ * 
+ * @return bool - True nếu gửi thành công
+ */
+bool PEClient::respond(const Request &request, JsonDocument &doc)
+{
+    char topic[128];
+    int length = snprintf(topic, sizeof(topic), "v1/devices/%s/%s/response/%s%s", _clientId,
+                          request.rpc ? "rpc" : "attributes", request.id, _codec == CODEC_MSGPACK ? "/msgpack" : "");
+    if (length < 0 || length >= static_cast<int>(sizeof(topic)))
+    {
+        return false;
+    }
+    return publishDocument(topic, doc);
+}
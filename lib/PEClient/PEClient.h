@@ -11,31 +11,119 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
-#include <map>
 #include <functional>
 #include <algorithm>
+#include "RpcDispatcher.h"
+#include "JsonArena.h"
+#include "MqttPublisher.h"
+#include "MqttAckClient.h"
+#include "DnsResolver.h"
+#include "TcpConnector.h"
+
+#define PECLIENT_WIFI_CONNECT_TIMEOUT_MS 15000
+#define PECLIENT_BACKOFF_MIN_MS 1000
+#define PECLIENT_BACKOFF_MAX_MS 60000
+#define PECLIENT_DNS_TIMEOUT_MS 5000         // Tra DNS tên broker tối đa
+#define PECLIENT_TCP_CONNECT_TIMEOUT_MS 3000 // Kết nối TCP tới broker tối đa
+#define PECLIENT_CONNACK_TIMEOUT_MS 3000     // Chờ CONNACK tối đa sau khi gửi CONNECT
+#define PECLIENT_KEEPALIVE_S 15              // Keep alive của CONNECT (giây)
+#define PECLIENT_SOCKET_TIMEOUT_S 1          // _client.loop() chờ phần còn lại của gói đang đọc dở tối đa (giây)
+#define PECLIENT_SOCKET_LOCK_MS 50           // Task khác chờ socket tối đa
+#define PECLIENT_STACK_PAYLOAD_SIZE 256 // Payload lớn hơn được cấp trên heap theo đúng kích thước
+#define PECLIENT_DOC_ARENA_SIZE 1536    // JsonDocument của một lần gửi, trên stack
+#define PECLIENT_BATCH_ARENA_SIZE 4096  // JsonDocument của gói metric, cấp một lần
 
 class PEClient
 {
 public:
+  enum ConnectionState
+  {
+    STATE_WIFI_CONNECTING, // Đang chờ WiFi
+    STATE_WIFI_BACKOFF,    // WiFi thất bại, chờ thử lại
+    STATE_MQTT_CONNECTING, // Có WiFi, chờ tới lượt kết nối MQTT
+    STATE_CONNECTED,
+    STATE_COUNT
+  };
+
+  enum PayloadCodec
+  {
+    CODEC_JSON,
+    CODEC_MSGPACK // Gửi trên topic có hậu tố "/msgpack"
+  };
+
   PEClient(const char *wifiSSID, const char *wifiPassword, const char *mqttServer, int mqttPort, const char *clientId, const char *username, const char *password);
   void begin();
   void loop();
   boolean connected();
+  void onConnect(std::function<void()> callback);
+
+  ConnectionState state() const { return _state; }
+  static const char *stateName(ConnectionState state);
+  uint32_t transitionCount(ConnectionState state) const { return _transitions[state]; }
+  uint32_t reconnectCount() const { return _reconnects; }
 
   void sendMetric(uint64_t timestamp, const char *key, double value);
 
   void sendMetric(const char *key, double value);
 
+  void setBatchLimits(size_t maxMetrics, size_t maxBytes, uint32_t maxLatencyMs);
+  // Trả về false nếu metric chưa được nhận (cửa sổ QoS1 đầy): người gọi giữ lại để gửi sau
+  bool addMetric(uint64_t timestamp, const char *key, double value);
+  bool flushMetrics();
+  void pollMetrics();
+
+  // Gói metric được gửi QoS1, tối đa window gói chờ PUBACK
+  void setPublishWindow(size_t window) { _publisher.setWindow(window); }
+  const MqttPublisher &publisher() const { return _publisher; }
+
+  void setCodec(PayloadCodec codec);
+  PayloadCodec codec() const { return _codec; }
+  // Độ dài payload và mã hóa theo codec đang chọn; buffer cần độ dài + 1 byte
+  size_t measureDocument(JsonDocument &doc) const;
+  void serializeDocument(JsonDocument &doc, char *buffer, size_t size) const;
+
   void sendAttribute(const char *key, double value);
   void sendAttribute(const char *key, const char *value);
+  // doc có dạng {"attributes": {...}}
+  bool sendAttributes(JsonDocument &doc);
 
-  void on(const char *key, void (*callback)(String));
+  void on(const char *key, RpcDispatcher::Handler callback);
+  void onDevice(const char *key, RpcDispatcher::DeviceHandler callback);
+  const RpcDispatcher &rpc() const { return _rpc; }
+
+  // Yêu cầu đọc dữ liệu từ server trên ".../attributes/request/<id>" hoặc ".../rpc/request/<id>"
+  struct Request
+  {
+    bool rpc;
+    const char *id;
+    const char *method; // Chỉ có với RPC, nullptr nếu không có
+    const char *keys;   // "a,b,c" từ "keys"/"clientKeys" (hoặc "params" của RPC), nullptr nếu không chỉ định
+  };
+  typedef std::function<void(const Request &request)> RequestHandler;
+
+  void onRequest(RequestHandler callback);
+  bool respond(const Request &request, JsonDocument &doc);
 
 private:
+  // Các bước của một lần kết nối MQTT trong STATE_MQTT_CONNECTING, mỗi bước
+  // được kiểm tra lại ở lần loop() sau thay vì chờ
+  enum MqttStep
+  {
+    MQTT_STEP_IDLE,      // Chờ tới lượt thử (backoff)
+    MQTT_STEP_RESOLVING, // Đang tra DNS
+    MQTT_STEP_TCP,       // Đang mở kết nối TCP
+    MQTT_STEP_CONNACK    // Đã gửi CONNECT, chờ CONNACK
+  };
+
   void initWiFi();
-  void reconnect();
+  void connectMqtt(unsigned long now);
+  void setMqttStep(MqttStep step, unsigned long now);
+  void abortMqtt();
+  void retryMqtt();
+  void setState(ConnectionState state);
+  void scheduleRetry();
   static void callback(char *topic, byte *message, unsigned int length);
+  void handleRequest(const char *topic, char *message, unsigned int length);
 
   const char *_ssid;
   const char *_password;
@@ -46,12 +134,56 @@ private:
   const char *_passwordMqtt;
 
   WiFiClient _espClient;
+  IPAddress _mqttAddress; // Địa chỉ broker đã tra DNS
+  bool _mqttResolved;
+  DnsResolver _resolver;
+  TcpConnector _connector;
+  MqttStep _mqttStep;
+  unsigned long _mqttStepSince;
+  MqttPublisher _publisher;
+  MqttAckClient _ackClient; // Bắt PUBACK cho _publisher
   PubSubClient _client;
+  // Mọi thao tác trên _client (kết nối, loop, PUBLISH từ task gửi lẫn từ callback)
+  // giữ khóa này để các gói tin không bị ghi xen kẽ vào socket. Không bao giờ giữ
+  // khi chờ mạng. Đệ quy vì callback có thể gửi dữ liệu khi task PEClient đang giữ khóa
+  SemaphoreHandle_t _socketLock;
+
+  // Máy trạng thái kết nối WiFi/MQTT, chạy trong loop() và không chờ
+  volatile ConnectionState _state;
+  unsigned long _stateSince;
+  unsigned long _nextAttemptAt;
+  uint32_t _backoffMs;
+  uint32_t _transitions[STATE_COUNT];
+  uint32_t _reconnects;
+  std::function<void()> _onConnect;
+
+  void resetBatch();
+  void updateTopics();
+  bool publishDocument(const char *topic, JsonDocument &doc);
 
   String _sendMetricTopic;
   String _sendAttributeTopic;
 
-  std::map<String, std::function<void(String)>> _callbacks;
+  // Gom nhiều metric vào một gói tin /metrics
+  JsonArena<PECLIENT_BATCH_ARENA_SIZE> _batchArena;
+  JsonDocument _batchDoc;
+  JsonObject _batchGroup;
+  uint64_t _batchGroupTs;
+  size_t _batchCount;
+  size_t _batchBytes;
+  unsigned long _batchStartedAt;
+  size_t _batchMaxMetrics;
+  size_t _batchMaxBytes;
+  uint32_t _batchMaxLatencyMs;
+  PayloadCodec _codec;
+
+  RpcDispatcher _rpc;
+
+  // Đọc payload của yêu cầu vào _request
+  RpcDispatcher _requestFields;
+  Request _request;
+  RpcValue _requestParams;
+  RequestHandler _onRequest;
   static PEClient *_instance;
 };
 
@@ -0,0 +1,440 @@
+#include "RpcDispatcher.h"
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+
+namespace {
+
+struct Cursor {
+    char *p;
+    char *end;
+};
+
+void skipWhitespace(Cursor &c) {
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r')) {
+        c.p++;
+    }
+}
+
+int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Đọc chuỗi JSON bắt đầu tại dấu '"', giải mã escape ngay trong bộ đệm
+ * và đặt '\0' sau chuỗi đã giải mã (không vượt quá vị trí dấu '"' đóng).
+ */
+bool parseString(Cursor &c, char *&out, size_t &outLength) {
+    if (c.p >= c.end || *c.p != '"') {
+        return false;
+    }
+    char *read = ++c.p;
+    char *write = read;
+    out = write;
+    while (read < c.end && *read != '"') {
+        char ch = *read++;
+        if (ch != '\\') {
+            *write++ = ch;
+            continue;
+        }
+        if (read >= c.end) {
+            return false;
+        }
+        char esc = *read++;
+        switch (esc) {
+        case '"': case '\\': case '/': *write++ = esc; break;
+        case 'b': *write++ = '\b'; break;
+        case 'f': *write++ = '\f'; break;
+        case 'n': *write++ = '\n'; break;
+        case 'r': *write++ = '\r'; break;
+        case 't': *write++ = '\t'; break;
+        case 'u': {
+            if (c.end - read < 4) {
+                return false;
+            }
+            uint32_t code = 0;
+            for (int i = 0; i < 4; i++) {
+                int v = hexValue(read[i]);
+                if (v < 0) {
+                    return false;
+                }
+                code = (code << 4) | v;
+            }
+            read += 4;
+            // UTF-8 của một mã \uXXXX không dài quá 6 ký tự escape
+            if (code < 0x80) {
+                *write++ = static_cast<char>(code);
+            } else if (code < 0x800) {
+                *write++ = static_cast<char>(0xc0 | (code >> 6));
+                *write++ = static_cast<char>(0x80 | (code & 0x3f));
+            } else {
+                *write++ = static_cast<char>(0xe0 | (code >> 12));
+                *write++ = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                *write++ = static_cast<char>(0x80 | (code & 0x3f));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    if (read >= c.end) {
+        return false;
+    }
+    outLength = write - out;
+    *write = '\0';
+    c.p = read + 1;
+    return true;
+}
+
+/**
+ * Đọc số JSON mà không dùng strtod (strtod của newlib có thể cấp phát bộ nhớ).
+ */
+bool parseNumber(Cursor &c, double &out) {
+    char *p = c.p;
+    bool negative = false;
+    if (p < c.end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p >= c.end || *p < '0' || *p > '9') {
+        return false;
+    }
+    double value = 0;
+    while (p < c.end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+    }
+    if (p < c.end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < c.end && *p >= '0' && *p <= '9') {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    if (p < c.end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExp = false;
+        if (p < c.end && (*p == '+' || *p == '-')) {
+            negativeExp = *p++ == '-';
+        }
+        int exponent = 0;
+        while (p < c.end && *p >= '0' && *p <= '9' && exponent < 400) {
+            exponent = exponent * 10 + (*p++ - '0');
+        }
+        double factor = 1;
+        while (exponent-- > 0) {
+            factor *= 10;
+        }
+        value = negativeExp ? value / factor : value * factor;
+    }
+    out = negative ? -value : value;
+    c.p = p;
+    return true;
+}
+
+bool matchLiteral(Cursor &c, const char *literal) {
+    size_t length = strlen(literal);
+    if (static_cast<size_t>(c.end - c.p) < length || memcmp(c.p, literal, length) != 0) {
+        return false;
+    }
+    c.p += length;
+    return true;
+}
+
+/**
+ * Bỏ qua một chuỗi JSON mà không sửa bộ đệm (chỉ bước qua escape)
+ */
+bool skipString(Cursor &c) {
+    char *p = c.p + 1;
+    while (p < c.end && *p != '"') {
+        p += *p == '\\' ? 2 : 1;
+    }
+    if (p >= c.end) {
+        return false;
+    }
+    c.p = p + 1;
+    return true;
+}
+
+/**
+ * Bỏ qua object/mảng lồng nhau. Bộ đệm giữ nguyên để giá trị RPC_RAW có thể
+ * được phân tích lại (vd. "params" của RPC)
+ */
+bool skipNested(Cursor &c) {
+    int depth = 0;
+    while (c.p < c.end) {
+        char ch = *c.p;
+        if (ch == '"') {
+            if (!skipString(c)) {
+                return false;
+            }
+            continue;
+        }
+        c.p++;
+        if (ch == '{' || ch == '[') {
+            depth++;
+        } else if (ch == '}' || ch == ']') {
+            if (--depth == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool parseValue(Cursor &c, RpcValue &value) {
+    value.boolean = false;
+    value.number = 0;
+    value.str = c.p;
+    value.length = 0;
+
+    char ch = c.p < c.end ? *c.p : '\0';
+    if (ch == '"') {
+        char *s;
+        if (!parseString(c, s, value.length)) {
+            return false;
+        }
+        value.type = RpcValue::RPC_STRING;
+        value.str = s;
+        return true;
+    }
+    if (ch == 't' || ch == 'f') {
+        value.type = RpcValue::RPC_BOOL;
+        value.boolean = ch == 't';
+        value.length = value.boolean ? 4 : 5;
+        return matchLiteral(c, value.boolean ? "true" : "false");
+    }
+    if (ch == 'n') {
+        value.type = RpcValue::RPC_NULL;
+        value.length = 4;
+        return matchLiteral(c, "null");
+    }
+    if (ch == '{' || ch == '[') {
+        value.type = RpcValue::RPC_RAW;
+        bool ok = skipNested(c);
+        value.length = c.p - value.str;
+        return ok;
+    }
+    value.type = RpcValue::RPC_NUMBER;
+    bool ok = parseNumber(c, value.number);
+    value.length = c.p - value.str;
+    return ok;
+}
+
+} // namespace
+
+/**
+ * @name asBool
+ * @brief Chuyển giá trị sang boolean ("true", "1", "on" hoặc số khác 0 là true)
+ * 
+ * @param None
+ * 
+ * @return bool - Giá trị boolean
+ */
+bool RpcValue::asBool() const {
+    switch (type) {
+    case RPC_BOOL:
+        return boolean;
+    case RPC_NUMBER:
+        return number != 0;
+    case RPC_STRING:
+        return strcasecmp(str, "true") == 0 || strcmp(str, "1") == 0 || strcasecmp(str, "on") == 0;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @name asNumber
+ * @brief Chuyển giá trị sang số
+ * 
+ * @param None
+ * 
+ * @return double - Giá trị số, 0 nếu không chuyển được
+ */
+double RpcValue::asNumber() const {
+    switch (type) {
+    case RPC_NUMBER:
+        return number;
+    case RPC_BOOL:
+        return boolean ? 1 : 0;
+    case RPC_STRING: {
+        Cursor c = {const_cast<char *>(str), const_cast<char *>(str) + length};
+        double value = 0;
+        return parseNumber(c, value) ? value : 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+int RpcDispatcher::compare(const char *a, size_t aLength, const char *b, size_t bLength) {
+    int result = memcmp(a, b, std::min(aLength, bLength));
+    if (result != 0) {
+        return result;
+    }
+    return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+}
+
+void RpcDispatcher::insert(std::vector<Entry> &table, const Entry &entry) {
+    auto it = std::lower_bound(table.begin(), table.end(), entry, [](const Entry &a, const Entry &b) {
+        return compare(a.key.data(), a.key.size(), b.key.data(), b.key.size()) < 0;
+    });
+    if (it != table.end() && it->key == entry.key) {
+        *it = entry;
+    } else {
+        table.insert(it, entry);
+    }
+}
+
+const RpcDispatcher::Entry *RpcDispatcher::find(const std::vector<Entry> &table, const char *key, size_t keyLength) {
+    size_t low = 0;
+    size_t high = table.size();
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int result = compare(table[mid].key.data(), table[mid].key.size(), key, keyLength);
+        if (result == 0) {
+            return &table[mid];
+        }
+        if (result < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @name on
+ * @brief Đăng ký handler cho một khóa (chỉ gọi khi khởi tạo)
+ * 
+ * @param {const char*} key - Tên khóa
+ * @param {Handler} handler - Hàm xử lý
+ * 
+ * @return None
+ */
+void RpcDispatcher::on(const char *key, Handler handler) {
+    Entry entry;
+    entry.key = key;
+    entry.handler = handler;
+    insert(_handlers, entry);
+}
+
+/**
+ * @name onDevice
+ * @brief Đăng ký handler cho khóa "<key>_<deviceId>", key "*" nhận mọi khóa
+ * 
+ * @param {const char*} key - Tên khóa (không gồm ID thiết bị)
+ * @param {DeviceHandler} handler - Hàm xử lý
+ * 
+ * @return None
+ */
+void RpcDispatcher::onDevice(const char *key, DeviceHandler handler) {
+    Entry entry;
+    entry.key = key;
+    entry.deviceHandler = handler;
+    insert(_deviceHandlers, entry);
+}
+
+/**
+ * @name route
+ * @brief Gọi handler tương ứng với khóa
+ * 
+ * @param {char*} key - Khóa, kết thúc bằng '\0'
+ * @param {size_t} keyLength - Độ dài khóa
+ * @param {const RpcValue&} value - Giá trị
+ * 
+ * @return None
+ */
+void RpcDispatcher::route(char *key, size_t keyLength, const RpcValue &value) {
+    const Entry *entry = find(_handlers, key, keyLength);
+    if (entry != nullptr) {
+        entry->handler(value);
+        return;
+    }
+
+    char *separator = nullptr;
+    for (char *p = key + keyLength; p > key; p--) {
+        if (p[-1] == '_') {
+            separator = p - 1;
+            break;
+        }
+    }
+    if (separator != nullptr && separator > key && separator[1] != '\0') {
+        size_t baseLength = separator - key;
+        entry = find(_deviceHandlers, key, baseLength);
+        if (entry == nullptr) {
+            entry = find(_deviceHandlers, "*", 1);
+        }
+        if (entry != nullptr) {
+            *separator = '\0';
+            entry->deviceHandler(key, separator + 1, value);
+            return;
+        }
+    }
+    _unhandled++;
+}
+
+/**
+ * @name dispatch
+ * @brief Phân tích payload JSON object ngay trong bộ đệm và gọi handler cho từng khóa
+ * 
+ * @param {char*} payload - Bộ đệm (sẽ bị sửa)
+ * @param {size_t} length - Độ dài payload
+ * 
+ * @return bool - False nếu payload không hợp lệ
+ */
+bool RpcDispatcher::dispatch(char *payload, size_t length) {
+    Cursor c = {payload, payload + length};
+    skipWhitespace(c);
+    if (c.p >= c.end || *c.p++ != '{') {
+        _parseErrors++;
+        return false;
+    }
+    skipWhitespace(c);
+    if (c.p < c.end && *c.p == '}') {
+        return true;
+    }
+
+    for (;;) {
+        char *key;
+        size_t keyLength;
+        RpcValue value;
+        skipWhitespace(c);
+        if (!parseString(c, key, keyLength)) {
+            break;
+        }
+        skipWhitespace(c);
+        if (c.p >= c.end || *c.p++ != ':') {
+            break;
+        }
+        skipWhitespace(c);
+        if (!parseValue(c, value)) {
+            break;
+        }
+        char *afterValue = c.p;
+        skipWhitespace(c);
+        if (c.p >= c.end) {
+            break;
+        }
+        char separator = *c.p++;
+        if (value.type == RpcValue::RPC_NUMBER || value.type == RpcValue::RPC_BOOL) {
+            // Đã đọc xong phần phân cách nên có thể kết thúc văn bản gốc bằng '\0'
+            *afterValue = '\0';
+        }
+        route(key, keyLength, value);
+        if (separator == '}') {
+            return true;
+        }
+        if (separator != ',') {
+            break;
+        }
+    }
+    _parseErrors++;
+    return false;
+}
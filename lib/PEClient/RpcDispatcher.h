@@ -0,0 +1,74 @@
+#ifndef RPCDISPATCHER_H
+#define RPCDISPATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <functional>
+
+/**
+ * Giá trị của một khóa trong JSON nhận được, trỏ thẳng vào bộ đệm MQTT.
+ * Chuỗi đã được giải mã escape và kết thúc bằng '\0' ngay trong bộ đệm.
+ */
+struct RpcValue {
+    enum Type : uint8_t {
+        RPC_NULL,
+        RPC_BOOL,
+        RPC_NUMBER,
+        RPC_STRING,
+        RPC_RAW // Object/mảng lồng nhau, chưa được phân tích
+    };
+
+    Type type;
+    bool boolean;
+    double number;
+    const char *str; // RPC_STRING, RPC_NUMBER và RPC_RAW: đoạn văn bản gốc
+    size_t length;
+
+    bool asBool() const;
+    double asNumber() const;
+};
+
+/**
+ * Phân tích JSON phẳng ngay trong bộ đệm và gọi handler theo khóa mà không cấp phát.
+ * Bảng handler được sắp xếp khi đăng ký và tra bằng tìm kiếm nhị phân.
+ *
+ * Khóa dạng "<key>_<deviceId>" không có handler riêng được chuyển cho handler
+ * đăng ký bằng onDevice(key) (hoặc onDevice("*") cho mọi khóa). ID thiết bị
+ * là phần sau dấu '_' cuối cùng.
+ */
+class RpcDispatcher
+{
+public:
+    typedef std::function<void(const RpcValue &value)> Handler;
+    typedef std::function<void(const char *key, const char *deviceId, const RpcValue &value)> DeviceHandler;
+
+    void on(const char *key, Handler handler);
+    void onDevice(const char *key, DeviceHandler handler);
+
+    // Trả về false nếu payload không phải JSON object hợp lệ
+    bool dispatch(char *payload, size_t length);
+
+    uint32_t parseErrors() const { return _parseErrors; }
+    uint32_t unhandled() const { return _unhandled; }
+
+private:
+    struct Entry {
+        std::string key;
+        Handler handler;
+        DeviceHandler deviceHandler;
+    };
+
+    static int compare(const char *a, size_t aLength, const char *b, size_t bLength);
+    static void insert(std::vector<Entry> &table, const Entry &entry);
+    static const Entry *find(const std::vector<Entry> &table, const char *key, size_t keyLength);
+    void route(char *key, size_t keyLength, const RpcValue &value);
+
+    std::vector<Entry> _handlers;
+    std::vector<Entry> _deviceHandlers;
+    uint32_t _parseErrors = 0;
+    uint32_t _unhandled = 0;
+};
+
+#endif // RPCDISPATCHER_H
@@ -0,0 +1,91 @@
+#include "TcpConnector.h"
+#include <errno.h>
+#include <string.h>
+#include <lwip/sockets.h>
+
+/**
+ * @name start
+ * @brief Tạo socket không chờ và bắt đầu kết nối tới ip:port
+ *
+ * @param {IPAddress} ip - Địa chỉ
+ * @param {uint16_t} port - Cổng
+ *
+ * @return bool - False nếu kết nối thất bại ngay (poll() trả về TCP_FAILED)
+ */
+bool TcpConnector::start(IPAddress ip, uint16_t port) {
+    cancel();
+    _fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_fd < 0) {
+        _status = TCP_FAILED;
+        return false;
+    }
+    lwip_fcntl(_fd, F_SETFL, lwip_fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = static_cast<uint32_t>(ip);
+    address.sin_port = htons(port);
+    if (lwip_connect(_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 && errno != EINPROGRESS) {
+        cancel();
+        _status = TCP_FAILED;
+        return false;
+    }
+    _status = TCP_CONNECTING;
+    return true;
+}
+
+/**
+ * @name poll
+ * @brief Kiểm tra kết nối đang mở mà không chờ
+ *
+ * @param None
+ *
+ * @return Status - TCP_CONNECTING khi chưa có kết quả
+ */
+TcpConnector::Status TcpConnector::poll() {
+    if (_status != TCP_CONNECTING) {
+        return _status;
+    }
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(_fd, &writable);
+    struct timeval timeout = {0, 0};
+    int ready = lwip_select(_fd + 1, nullptr, &writable, nullptr, &timeout);
+    if (ready == 0) {
+        return TCP_CONNECTING;
+    }
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (ready < 0 || lwip_getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        cancel();
+        _status = TCP_FAILED;
+        return _status;
+    }
+    // Như WiFiClient::connect(): socket chờ, gửi ngay từng gói nhỏ
+    lwip_fcntl(_fd, F_SETFL, lwip_fcntl(_fd, F_GETFL, 0) & ~O_NONBLOCK);
+    int enable = 1;
+    lwip_setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    lwip_setsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    _status = TCP_CONNECTED;
+    return _status;
+}
+
+int TcpConnector::release() {
+    if (_status != TCP_CONNECTED) {
+        return -1;
+    }
+    int fd = _fd;
+    _fd = -1;
+    _status = TCP_IDLE;
+    return fd;
+}
+
+void TcpConnector::cancel() {
+    if (_fd >= 0) {
+        lwip_close(_fd);
+        _fd = -1;
+    }
+    _status = TCP_IDLE;
+}
@@ -0,0 +1,39 @@
+#ifndef TCPCONNECTOR_H
+#define TCPCONNECTOR_H
+
+#include <stdint.h>
+#include <Arduino.h>
+
+/**
+ * Mở kết nối TCP không chờ cho task PEClient: start() tạo socket lwIP ở chế độ
+ * không chờ và gửi SYN, poll() kiểm tra (select() với timeout 0) kết nối đã xong
+ * chưa. Khi thành công, socket được chuyển về chế độ chờ (như WiFiClient::connect())
+ * và release() giao nó cho WiFiClient(fd).
+ */
+class TcpConnector
+{
+public:
+    enum Status : uint8_t {
+        TCP_IDLE,
+        TCP_CONNECTING,
+        TCP_CONNECTED,
+        TCP_FAILED
+    };
+
+    TcpConnector() : _fd(-1), _status(TCP_IDLE) {}
+    ~TcpConnector() { cancel(); }
+
+    // Trả về false nếu không tạo được socket hoặc connect() bị từ chối ngay
+    bool start(IPAddress ip, uint16_t port);
+    Status poll();
+    // Giao socket đã kết nối cho người gọi, trả về -1 nếu chưa có
+    int release();
+    // Đóng socket đang kết nối (nếu có)
+    void cancel();
+
+private:
+    int _fd;
+    Status _status;
+};
+
+#endif // TCPCONNECTOR_H
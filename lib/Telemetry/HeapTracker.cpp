@@ -0,0 +1,86 @@
+#include "HeapTracker.h"
+#include <atomic>
+
+#ifdef HEAP_TRACKING
+
+static std::atomic<uint32_t> totalCount(0);
+static std::atomic<uint32_t> steadyCount(0);
+static volatile bool steady = false;
+static TaskHandle_t trackedTasks[HEAP_TRACKER_MAX_TASKS];
+static std::atomic<size_t> trackedCount(0);
+
+static void countAllocation() {
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    if (!steady) {
+        return;
+    }
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    size_t count = trackedCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+        if (trackedTasks[i] == current) {
+            steadyCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    countAllocation();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    countAllocation();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    countAllocation();
+    return __real_realloc(ptr, size);
+}
+}
+
+bool HeapTracker::enabled() { return true; }
+
+/**
+ * @name track
+ * @brief Thêm một task vào danh sách theo dõi (chỉ gọi khi khởi tạo)
+ * 
+ * @param {TaskHandle_t} task - Task cần theo dõi
+ * 
+ * @return bool - False nếu danh sách đã đầy
+ */
+bool HeapTracker::track(TaskHandle_t task) {
+    size_t count = trackedCount.load(std::memory_order_relaxed);
+    if (task == NULL || count >= HEAP_TRACKER_MAX_TASKS) {
+        return false;
+    }
+    trackedTasks[count] = task;
+    trackedCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+void HeapTracker::markSteadyState() {
+    steadyCount.store(0, std::memory_order_relaxed);
+    steady = true;
+}
+
+bool HeapTracker::steadyState() { return steady; }
+uint32_t HeapTracker::steadyAllocations() { return steadyCount.load(std::memory_order_relaxed); }
+uint32_t HeapTracker::totalAllocations() { return totalCount.load(std::memory_order_relaxed); }
+
+#else
+
+bool HeapTracker::enabled() { return false; }
+bool HeapTracker::track(TaskHandle_t) { return false; }
+void HeapTracker::markSteadyState() {}
+bool HeapTracker::steadyState() { return false; }
+uint32_t HeapTracker::steadyAllocations() { return 0; }
+uint32_t HeapTracker::totalAllocations() { return 0; }
+
+#endif // HEAP_TRACKING
@@ -0,0 +1,37 @@
+#ifndef HEAPTRACKER_H
+#define HEAPTRACKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+#define HEAP_TRACKER_MAX_TASKS 4
+
+/**
+ * Đếm số lần cấp phát heap (malloc/calloc/realloc, kể cả new) của các task
+ * được theo dõi sau khi khởi động xong. Ở trạng thái ổn định, luồng dữ liệu
+ * (nhận khung tin, gom và gửi metric) không được cấp phát, nên số đếm phải
+ * giữ bằng 0.
+ *
+ * Chỉ hoạt động khi build với HEAP_TRACKING và bọc các hàm cấp phát:
+ *   -DHEAP_TRACKING -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+ * (xem env heap-tracking trong platformio.ini). Nếu không, mọi số đếm bằng 0.
+ */
+class HeapTracker
+{
+public:
+    static bool enabled();
+
+    // Theo dõi cấp phát của một task (vd. task Zigbee, task gửi metric)
+    static bool track(TaskHandle_t task);
+    // Kết thúc giai đoạn khởi động: các lần cấp phát từ đây được tính
+    static void markSteadyState();
+
+    static bool steadyState();
+    // Số lần cấp phát của các task được theo dõi kể từ markSteadyState()
+    static uint32_t steadyAllocations();
+    // Tổng số lần cấp phát kể từ khi khởi động (mọi task)
+    static uint32_t totalAllocations();
+};
+
+#endif // HEAPTRACKER_H
@@ -0,0 +1,70 @@
+#include "Telemetry.h"
+#include "HeapTracker.h"
+#include <esp_heap_caps.h>
+
+Telemetry::CoreCounters Telemetry::_cores[TELEMETRY_CORES];
+std::atomic<uint32_t> Telemetry::_gauges[TELEMETRY_GAUGE_COUNT];
+
+static const char *const counterNames[TELEMETRY_COUNTER_COUNT] = {
+    "framesRx",
+    "crcErrors",
+    "unknownDeviceFrames",
+    "parseErrors",
+    "metricsDropped",
+    "metricsSuppressed",
+    "publishFailures",
+    "reconnects",
+    "devicesOffline",
+    "publishResends",
+    "metricsUndated",
+};
+
+static const char *const gaugeNames[TELEMETRY_GAUGE_COUNT] = {
+    "queueDepth",
+    "queueHighWater",
+    "freeHeap",
+    "largestFreeBlock",
+    "minFreeHeap",
+    "heapFragmentation",
+    "steadyAllocations",
+    "publishInFlight",
+    "pubackLatencyMs",
+    "pubackLatencyMaxMs",
+};
+
+/**
+ * @name snapshot
+ * @brief Đọc giá trị hiện tại của mọi bộ đếm (cộng các core) và gauge
+ * 
+ * @param {Snapshot&} out - Kết quả
+ * 
+ * @return None
+ */
+void Telemetry::snapshot(Snapshot &out) {
+    size_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    set(TELEMETRY_FREE_HEAP, freeHeap);
+    set(TELEMETRY_LARGEST_FREE_BLOCK, largestBlock);
+    set(TELEMETRY_MIN_FREE_HEAP, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    set(TELEMETRY_HEAP_FRAGMENTATION, freeHeap > 0 ? 100 - largestBlock * 100 / freeHeap : 0);
+    set(TELEMETRY_STEADY_ALLOCATIONS, HeapTracker::steadyAllocations());
+
+    for (size_t i = 0; i < TELEMETRY_COUNTER_COUNT; i++) {
+        uint32_t total = 0;
+        for (size_t core = 0; core < TELEMETRY_CORES; core++) {
+            total += _cores[core].counters[i].load(std::memory_order_relaxed);
+        }
+        out.counters[i] = total;
+    }
+    for (size_t i = 0; i < TELEMETRY_GAUGE_COUNT; i++) {
+        out.gauges[i] = _gauges[i].load(std::memory_order_relaxed);
+    }
+}
+
+const char *Telemetry::counterName(TelemetryCounter counter) {
+    return counter < TELEMETRY_COUNTER_COUNT ? counterNames[counter] : "";
+}
+
+const char *Telemetry::gaugeName(TelemetryGauge gauge) {
+    return gauge < TELEMETRY_GAUGE_COUNT ? gaugeNames[gauge] : "";
+}
@@ -0,0 +1,90 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <Arduino.h>
+
+#ifndef TELEMETRY_CORES
+#define TELEMETRY_CORES portNUM_PROCESSORS
+#endif
+
+#ifndef TELEMETRY_CACHE_LINE_SIZE
+#define TELEMETRY_CACHE_LINE_SIZE 32
+#endif
+
+enum TelemetryCounter : uint8_t {
+    TELEMETRY_FRAMES_RX,          // Khung tin Zigbee hợp lệ
+    TELEMETRY_CRC_ERRORS,         // Khung tin sai CRC
+    TELEMETRY_UNKNOWN_DEVICE,     // Khung tin từ thiết bị chưa có trong danh sách
+    TELEMETRY_PARSE_ERRORS,       // Mục sai định dạng trong trường DATA
+    TELEMETRY_METRICS_DROPPED,    // Metric bị bỏ vì hàng đợi đầy
+    TELEMETRY_METRICS_SUPPRESSED, // Metric không đổi, bị bộ lọc deadband bỏ qua
+    TELEMETRY_PUBLISH_FAILURES,   // Gửi MQTT thất bại
+    TELEMETRY_RECONNECTS,         // Số lần kết nối lại MQTT
+    TELEMETRY_DEVICES_OFFLINE,    // Số lần thiết bị chuyển sang offline
+    TELEMETRY_PUBLISH_RESENDS,    // Gói QoS1 gửi lại (DUP) do chưa có PUBACK
+    TELEMETRY_METRICS_UNDATED,    // Metric đã lưu, chưa đồng bộ NTP ở lần khởi động trước, bị bỏ khi đọc lại
+    TELEMETRY_COUNTER_COUNT
+};
+
+enum TelemetryGauge : uint8_t {
+    TELEMETRY_QUEUE_DEPTH,
+    TELEMETRY_QUEUE_HIGH_WATER,
+    TELEMETRY_FREE_HEAP,          // Lấy mẫu khi gọi snapshot()
+    TELEMETRY_LARGEST_FREE_BLOCK, // Lấy mẫu khi gọi snapshot()
+    TELEMETRY_MIN_FREE_HEAP,      // Lấy mẫu khi gọi snapshot()
+    TELEMETRY_HEAP_FRAGMENTATION, // %, 100 - khối trống lớn nhất / tổng trống
+    TELEMETRY_STEADY_ALLOCATIONS, // Cấp phát ở trạng thái ổn định (HeapTracker)
+    TELEMETRY_PUBLISH_IN_FLIGHT,  // Gói QoS1 đang chờ PUBACK
+    TELEMETRY_PUBACK_LATENCY,     // ms, trung bình trượt PUBLISH -> PUBACK
+    TELEMETRY_PUBACK_LATENCY_MAX, // ms
+    TELEMETRY_GAUGE_COUNT
+};
+
+/**
+ * Bộ đếm và gauge chạy suốt vòng đời gateway.
+ * Mỗi core tăng bộ đếm trên cache line riêng, nên hai core không tranh chấp.
+ * Các task trên cùng một core dùng phép cộng nguyên tử (relaxed).
+ * snapshot() cộng tất cả các core lại.
+ */
+class Telemetry
+{
+public:
+    struct Snapshot {
+        uint32_t counters[TELEMETRY_COUNTER_COUNT];
+        uint32_t gauges[TELEMETRY_GAUGE_COUNT];
+    };
+
+    static void count(TelemetryCounter counter, uint32_t n = 1) {
+        _cores[xPortGetCoreID()].counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    static void set(TelemetryGauge gauge, uint32_t value) {
+        _gauges[gauge].store(value, std::memory_order_relaxed);
+    }
+
+    // Chỉ tăng, dùng cho mức cao nhất (high-water mark)
+    static void max(TelemetryGauge gauge, uint32_t value) {
+        uint32_t current = _gauges[gauge].load(std::memory_order_relaxed);
+        while (value > current &&
+               !_gauges[gauge].compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void snapshot(Snapshot &out);
+
+    static const char *counterName(TelemetryCounter counter);
+    static const char *gaugeName(TelemetryGauge gauge);
+
+private:
+    struct alignas(TELEMETRY_CACHE_LINE_SIZE) CoreCounters {
+        std::atomic<uint32_t> counters[TELEMETRY_COUNTER_COUNT];
+    };
+
+    static CoreCounters _cores[TELEMETRY_CORES];
+    static std::atomic<uint32_t> _gauges[TELEMETRY_GAUGE_COUNT];
+};
+
+#endif // TELEMETRY_H
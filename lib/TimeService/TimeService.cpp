@@ -0,0 +1,95 @@
+#include "TimeService.h"
+#include <esp_sntp.h>
+
+TimeService *TimeService::_instance = nullptr;
+
+TimeService::TimeService()
+    : _offsetUs(0), _syncedAtUs(0), _driftPpm(0), _synced(false), _syncs(0)
+{
+    portMUX_INITIALIZE(&_lock);
+}
+
+/**
+ * @name begin
+ * @brief Bắt đầu đồng bộ SNTP chạy nền
+ * 
+ * @param {const char*} server - Máy chủ NTP
+ * @param {uint32_t} syncIntervalMs - Chu kỳ đồng bộ lại (ms)
+ * 
+ * @return None
+ */
+void TimeService::begin(const char *server, uint32_t syncIntervalMs) {
+    _instance = this;
+    sntp_set_time_sync_notification_cb(onSync);
+    sntp_set_sync_interval(syncIntervalMs);
+    configTime(0, 0, server);
+}
+
+/**
+ * @name onSync
+ * @brief Callback của SNTP (chạy trong task lwIP) khi nhận được thời gian mới
+ * 
+ * @param {struct timeval*} tv - Thời gian epoch vừa đồng bộ
+ * 
+ * @return None
+ */
+void TimeService::onSync(struct timeval *tv) {
+    if (_instance == nullptr || tv == nullptr) {
+        return;
+    }
+    int64_t epochUs = static_cast<int64_t>(tv->tv_sec) * 1000000 + tv->tv_usec;
+    _instance->update(epochUs, monotonicUs());
+}
+
+/**
+ * @name update
+ * @brief Cập nhật độ lệch và ước lượng lại độ trôi
+ * 
+ * @param {int64_t} epochUs - Thời gian epoch (us)
+ * @param {int64_t} monotonicUs - Thời gian đơn điệu tương ứng (us)
+ * 
+ * @return None
+ */
+void TimeService::update(int64_t epochUs, int64_t monotonicUs) {
+    int64_t offsetUs = epochUs - monotonicUs;
+
+    portENTER_CRITICAL(&_lock);
+    int64_t elapsedUs = monotonicUs - _syncedAtUs;
+    // Bỏ qua các lần đồng bộ quá gần nhau, sai số mạng lấn át độ trôi
+    if (_synced && elapsedUs >= 60 * 1000000LL) {
+        int64_t ppm = (offsetUs - _offsetUs) * 1000000 / elapsedUs;
+        if (ppm > TIME_SERVICE_MAX_DRIFT_PPM) ppm = TIME_SERVICE_MAX_DRIFT_PPM;
+        if (ppm < -TIME_SERVICE_MAX_DRIFT_PPM) ppm = -TIME_SERVICE_MAX_DRIFT_PPM;
+        _driftPpm = static_cast<int32_t>((_driftPpm + ppm) / 2);
+    }
+    _offsetUs = offsetUs;
+    _syncedAtUs = monotonicUs;
+    _synced = true;
+    _syncs++;
+    portEXIT_CRITICAL(&_lock);
+}
+
+/**
+ * @name toEpochMs
+ * @brief Chuyển thời gian đơn điệu sang epoch (ms)
+ * 
+ * @param {int64_t} monotonicUs - Thời gian đơn điệu (us), vd. lúc nhận khung tin
+ * @param {bool*} trusted - Nếu khác nullptr, nhận false khi chưa đồng bộ
+ * 
+ * @return uint64_t - Thời gian epoch (ms), hoặc thời gian kể từ khi khởi động nếu chưa đồng bộ
+ */
+uint64_t TimeService::toEpochMs(int64_t monotonicUs, bool *trusted) {
+    portENTER_CRITICAL(&_lock);
+    bool synced = _synced;
+    int64_t epochUs = monotonicUs + _offsetUs +
+                      (monotonicUs - _syncedAtUs) * _driftPpm / 1000000;
+    portEXIT_CRITICAL(&_lock);
+
+    if (trusted != nullptr) {
+        *trusted = synced;
+    }
+    if (!synced) {
+        return monotonicUs / 1000;
+    }
+    return epochUs / 1000;
+}
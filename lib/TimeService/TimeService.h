@@ -0,0 +1,56 @@
+#ifndef TIMESERVICE_H
+#define TIMESERVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define TIME_SERVICE_DEFAULT_SERVER "pool.ntp.org"
+#define TIME_SERVICE_SYNC_INTERVAL_MS 3600000
+#define TIME_SERVICE_MAX_DRIFT_PPM 500
+
+/**
+ * Đồng hồ epoch (ms) dựa trên bộ đếm đơn điệu esp_timer, đồng bộ SNTP chạy nền
+ * trong lwIP nên không chặn luồng dữ liệu.
+ *
+ * Mỗi lần đồng bộ lưu độ lệch epoch - đơn điệu và ước lượng độ trôi (ppm) của
+ * thạch anh so với lần trước, dùng để hiệu chỉnh giữa hai lần đồng bộ.
+ * Trước lần đồng bộ đầu tiên, thời gian trả về là thời gian kể từ khi khởi động
+ * và được đánh dấu không tin cậy.
+ *
+ * Gọi được từ mọi task.
+ */
+class TimeService
+{
+public:
+    TimeService();
+
+    // Gọi sau khi WiFi đã khởi tạo (stack TCP/IP sẵn sàng)
+    void begin(const char *server = TIME_SERVICE_DEFAULT_SERVER, uint32_t syncIntervalMs = TIME_SERVICE_SYNC_INTERVAL_MS);
+
+    static int64_t monotonicUs() { return esp_timer_get_time(); }
+
+    uint64_t nowMs(bool *trusted = nullptr) { return toEpochMs(monotonicUs(), trusted); }
+    uint64_t toEpochMs(int64_t monotonicUs, bool *trusted = nullptr);
+
+    bool synced() const { return _synced; }
+    uint32_t syncCount() const { return _syncs; }
+    int32_t driftPpm() const { return _driftPpm; }
+
+private:
+    static void onSync(struct timeval *tv);
+    void update(int64_t epochUs, int64_t monotonicUs);
+
+    portMUX_TYPE _lock;
+    int64_t _offsetUs;   // epoch - đơn điệu tại lần đồng bộ cuối
+    int64_t _syncedAtUs; // Thời gian đơn điệu của lần đồng bộ cuối
+    int32_t _driftPpm;
+    volatile bool _synced;
+    uint32_t _syncs;
+
+    static TimeService *_instance;
+};
+
+#endif // TIMESERVICE_H
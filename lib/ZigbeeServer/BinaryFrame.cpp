@@ -0,0 +1,202 @@
+#include "BinaryFrame.h"
+#include "Crc32.h"
+#include <string.h>
+
+namespace BinaryFrame {
+
+/**
+ * @name cobsEncode
+ * @brief Mã hóa COBS, output phải có ít nhất length + length / 254 + 1 byte
+ * 
+ * @param {const uint8_t*} input - Dữ liệu gốc
+ * @param {size_t} length - Độ dài dữ liệu
+ * @param {uint8_t*} output - Bộ đệm kết quả (không chứa byte 0x00)
+ * 
+ * @return size_t - Độ dài sau mã hóa
+ */
+size_t cobsEncode(const uint8_t *input, size_t length, uint8_t *output) {
+    size_t codeIndex = 0;
+    size_t outIndex = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] == 0) {
+            output[codeIndex] = code;
+            codeIndex = outIndex++;
+            code = 1;
+        } else {
+            output[outIndex++] = input[i];
+            if (++code == 0xff) {
+                output[codeIndex] = code;
+                codeIndex = outIndex++;
+                code = 1;
+            }
+        }
+    }
+    output[codeIndex] = code;
+    return outIndex;
+}
+
+/**
+ * @name cobsDecode
+ * @brief Giải mã COBS ngay trong bộ đệm (dữ liệu giải mã luôn ngắn hơn dữ liệu mã hóa)
+ * 
+ * @param {uint8_t*} buffer - Dữ liệu mã hóa, không gồm byte 0x00 phân cách
+ * @param {size_t} length - Độ dài dữ liệu mã hóa
+ * @param {size_t&} decodedLength - Độ dài sau giải mã
+ * 
+ * @return bool - False nếu dữ liệu không hợp lệ
+ */
+bool cobsDecode(uint8_t *buffer, size_t length, size_t &decodedLength) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length) {
+        uint8_t code = buffer[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return false;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            buffer[out++] = buffer[in++];
+        }
+        if (code != 0xff && in < length) {
+            buffer[out++] = 0;
+        }
+    }
+    decodedLength = out;
+    return true;
+}
+
+Reader::Reader(const uint8_t *payload, size_t length)
+    : _pos(payload), _end(payload), _type(0), _valid(false)
+{
+    // type(1) + CRC(4)
+    if (length < 5) {
+        return;
+    }
+    const uint8_t *crcPos = payload + length - 4;
+    uint32_t received = (uint32_t(crcPos[0]) << 24) | (uint32_t(crcPos[1]) << 16) |
+                        (uint32_t(crcPos[2]) << 8) | crcPos[3];
+    if (Crc32::calculate(reinterpret_cast<const char *>(payload), length - 4) != received) {
+        return;
+    }
+    _type = payload[0];
+    _pos = payload + 1;
+    _end = crcPos;
+    _valid = true;
+}
+
+/**
+ * @name next
+ * @brief Lấy TLV tiếp theo
+ * 
+ * @param {uint8_t&} tag - Tag
+ * @param {const uint8_t*&} value - Con trỏ tới giá trị trong payload
+ * @param {uint8_t&} length - Độ dài giá trị
+ * 
+ * @return bool - False khi hết TLV hoặc TLV bị cắt cụt
+ */
+bool Reader::next(uint8_t &tag, const uint8_t *&value, uint8_t &length) {
+    if (!_valid || _end - _pos < 2) {
+        return false;
+    }
+    tag = _pos[0];
+    length = _pos[1];
+    if (_end - _pos - 2 < length) {
+        _valid = false;
+        return false;
+    }
+    value = _pos + 2;
+    _pos += 2 + length;
+    return true;
+}
+
+/**
+ * @name parseReading
+ * @brief Tách giá trị của TLV READING
+ * 
+ * @param {const uint8_t*} value - Giá trị TLV
+ * @param {uint8_t} length - Độ dài giá trị TLV
+ * @param {const char*&} key - Tên thông số (không kết thúc bằng '\0')
+ * @param {uint8_t&} keyLength - Độ dài tên thông số
+ * @param {float&} reading - Giá trị đo
+ * 
+ * @return bool - False nếu TLV không hợp lệ
+ */
+bool Reader::parseReading(const uint8_t *value, uint8_t length, const char *&key, uint8_t &keyLength, float &reading) {
+    if (length < 1 + 4 || value[0] == 0 || value[0] + 1u + 4u != length) {
+        return false;
+    }
+    keyLength = value[0];
+    key = reinterpret_cast<const char *>(value + 1);
+    const uint8_t *v = value + 1 + keyLength;
+    uint32_t bits = uint32_t(v[0]) | (uint32_t(v[1]) << 8) | (uint32_t(v[2]) << 16) | (uint32_t(v[3]) << 24);
+    memcpy(&reading, &bits, sizeof(reading));
+    return true;
+}
+
+Writer::Writer(uint8_t *buffer, size_t capacity, Type type)
+    : _buffer(buffer), _capacity(capacity), _length(0), _overflow(capacity < 1)
+{
+    if (!_overflow) {
+        _buffer[_length++] = type;
+    }
+}
+
+bool Writer::add(uint8_t tag, const void *value, size_t length) {
+    if (_overflow || length > 0xff || _length + 2 + length > _capacity) {
+        _overflow = true;
+        return false;
+    }
+    _buffer[_length++] = tag;
+    _buffer[_length++] = static_cast<uint8_t>(length);
+    memcpy(_buffer + _length, value, length);
+    _length += length;
+    return true;
+}
+
+bool Writer::addString(uint8_t tag, const char *value) {
+    return add(tag, value, strlen(value));
+}
+
+bool Writer::addReading(const char *key, float value) {
+    size_t keyLength = strlen(key);
+    uint8_t tlv[1 + 0xff];
+    if (keyLength == 0 || keyLength + 1 + 4 > 0xff) {
+        _overflow = true;
+        return false;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    tlv[0] = static_cast<uint8_t>(keyLength);
+    memcpy(tlv + 1, key, keyLength);
+    for (int i = 0; i < 4; i++) {
+        tlv[1 + keyLength + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    return add(TAG_READING, tlv, keyLength + 1 + 4);
+}
+
+/**
+ * @name finish
+ * @brief Thêm CRC32 vào payload và đóng khung COBS với 0x00 ở hai đầu
+ * 
+ * @param {uint8_t*} output - Bộ đệm kết quả
+ * @param {size_t} outputCapacity - Kích thước bộ đệm kết quả
+ * 
+ * @return size_t - Số byte cần gửi, 0 nếu bộ đệm không đủ
+ */
+size_t Writer::finish(uint8_t *output, size_t outputCapacity) {
+    if (_overflow || _length + 4 > _capacity || outputCapacity < maxEncodedSize(_length)) {
+        return 0;
+    }
+    uint32_t crc = Crc32::calculate(reinterpret_cast<const char *>(_buffer), _length);
+    _buffer[_length++] = static_cast<uint8_t>(crc >> 24);
+    _buffer[_length++] = static_cast<uint8_t>(crc >> 16);
+    _buffer[_length++] = static_cast<uint8_t>(crc >> 8);
+    _buffer[_length++] = static_cast<uint8_t>(crc);
+
+    output[0] = kDelimiter;
+    size_t encoded = cobsEncode(_buffer, _length, output + 1);
+    output[1 + encoded] = kDelimiter;
+    return encoded + 2;
+}
+
+} // namespace BinaryFrame
@@ -0,0 +1,85 @@
+#ifndef BINARYFRAME_H
+#define BINARYFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Khung nhị phân trên UART (dùng song song với khung ASCII cũ):
+ *
+ *   0x00 | COBS(payload) | 0x00
+ *
+ * payload = type(1) | TLV... | CRC32(4, big-endian, tính trên type và các TLV)
+ * TLV     = tag(1) | len(1) | value(len)
+ *
+ * Mỗi khung có byte 0x00 ở cả đầu và cuối; khung ASCII không bao giờ chứa 0x00
+ * nên bộ nhận phân biệt được hai định dạng trên cùng một luồng.
+ */
+namespace BinaryFrame {
+
+enum Type : uint8_t {
+    TYPE_DATA = 0x01,    // Thiết bị -> gateway: các giá trị đo
+    TYPE_COMMAND = 0x02, // Gateway -> thiết bị: lệnh
+};
+
+enum Tag : uint8_t {
+    TAG_DEVICE_ID = 0x01, // ASCII
+    TAG_READING = 0x02,   // keyLen(1) | key | float32 little-endian
+    TAG_COMMAND = 0x03,   // ASCII
+    TAG_SECRET_KEY = 0x04, // ASCII
+    TAG_ACK = 0x05         // Rỗng: khung tin là ACK cho lệnh đang chờ
+};
+
+const uint8_t kDelimiter = 0x00;
+
+size_t cobsEncode(const uint8_t *input, size_t length, uint8_t *output);
+bool cobsDecode(uint8_t *buffer, size_t length, size_t &decodedLength);
+
+/**
+ * Đọc tuần tự các TLV trong payload đã giải mã, không sao chép dữ liệu.
+ */
+class Reader
+{
+public:
+    Reader(const uint8_t *payload, size_t length);
+
+    bool valid() const { return _valid; }
+    uint8_t type() const { return _type; }
+    bool next(uint8_t &tag, const uint8_t *&value, uint8_t &length);
+
+    static bool parseReading(const uint8_t *value, uint8_t length, const char *&key, uint8_t &keyLength, float &reading);
+
+private:
+    const uint8_t *_pos;
+    const uint8_t *_end;
+    uint8_t _type;
+    bool _valid;
+};
+
+/**
+ * Ghi payload vào bộ đệm do người gọi cấp, sau đó đóng khung COBS.
+ */
+class Writer
+{
+public:
+    Writer(uint8_t *buffer, size_t capacity, Type type);
+
+    bool add(uint8_t tag, const void *value, size_t length);
+    bool addString(uint8_t tag, const char *value);
+    bool addReading(const char *key, float value);
+
+    // Thêm CRC và mã hóa COBS kèm byte 0x00 hai đầu vào output
+    size_t finish(uint8_t *output, size_t outputCapacity);
+
+    static size_t maxEncodedSize(size_t payloadLength) { return payloadLength + 4 + (payloadLength + 4) / 254 + 3; }
+
+private:
+    uint8_t *_buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflow;
+};
+
+} // namespace BinaryFrame
+
+#endif // BINARYFRAME_H
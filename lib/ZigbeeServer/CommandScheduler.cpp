@@ -0,0 +1,339 @@
+#include "CommandScheduler.h"
+#include <string.h>
+
+CommandScheduler::CommandScheduler()
+    : _nextHandle(1), _nextSequence(0), _nextSendAt(0), _baudRate(9600), _maxInFlight(1),
+      _ackTimeoutMs(ZIGBEE_COMMAND_ACK_TIMEOUT_MS), _maxAttempts(ZIGBEE_COMMAND_MAX_ATTEMPTS),
+      _rejected(0), _retries(0), _failures(0)
+{
+    memset(_slots, 0, sizeof(_slots));
+    portMUX_INITIALIZE(&_lock);
+}
+
+/**
+ * @name setRetryPolicy
+ * @brief Cấu hình thời gian chờ ACK và số lần gửi tối đa
+ * 
+ * @param {uint32_t} ackTimeoutMs - Thời gian chờ ACK sau khi gửi xong (ms)
+ * @param {uint8_t} maxAttempts - Số lần gửi tối đa
+ * 
+ * @return None
+ */
+void CommandScheduler::setRetryPolicy(uint32_t ackTimeoutMs, uint8_t maxAttempts) {
+    _ackTimeoutMs = ackTimeoutMs;
+    _maxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+}
+
+CommandScheduler::Slot *CommandScheduler::findSlot(CommandHandle handle) {
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        if (_slots[i].state != SLOT_FREE && _slots[i].handle == handle) {
+            return &_slots[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @name allocateSlot
+ * @brief Lấy ô trống, hoặc thu hồi lệnh đã xong lâu nhất mà không ai chờ
+ * 
+ * @param None
+ * 
+ * @return Slot* - Ô lệnh, nullptr nếu hàng đợi đầy
+ */
+CommandScheduler::Slot *CommandScheduler::allocateSlot() {
+    Slot *oldestDone = nullptr;
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        Slot &slot = _slots[i];
+        if (slot.state == SLOT_FREE) {
+            return &slot;
+        }
+        if (slot.state == SLOT_DONE && slot.waiter == NULL &&
+            (oldestDone == nullptr || (int32_t)(slot.sequence - oldestDone->sequence) < 0)) {
+            oldestDone = &slot;
+        }
+    }
+    return oldestDone;
+}
+
+uint8_t CommandScheduler::inFlight(const char *deviceId) const {
+    uint8_t count = 0;
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        if (_slots[i].state == SLOT_IN_FLIGHT && strcmp(_slots[i].deviceId, deviceId) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @name submit
+ * @brief Thêm lệnh (đã đóng khung) vào hàng đợi
+ * 
+ * @param {const char*} deviceId - ID thiết bị nhận
+ * @param {const uint8_t*} data - Dữ liệu cần gửi
+ * @param {size_t} length - Độ dài dữ liệu
+ * @param {uint8_t} priority - Độ ưu tiên (CommandPriority)
+ * @param {bool} anyReply - Coi mọi khung tin từ thiết bị là ACK
+ * 
+ * @return CommandHandle - Handle của lệnh, 0 nếu hàng đợi đầy hoặc lệnh quá dài
+ */
+CommandHandle CommandScheduler::submit(const char *deviceId, const uint8_t *data, size_t length,
+                                       uint8_t priority, bool anyReply) {
+    if (length == 0 || length > ZIGBEE_COMMAND_MAX_SIZE || strlen(deviceId) >= DEVICE_ID_SIZE) {
+        _rejected++;
+        return 0;
+    }
+
+    CommandHandle handle = 0;
+    portENTER_CRITICAL(&_lock);
+    Slot *slot = allocateSlot();
+    if (slot != nullptr) {
+        handle = _nextHandle++;
+        if (_nextHandle == 0) {
+            _nextHandle = 1;
+        }
+        slot->handle = handle;
+        slot->sequence = _nextSequence++;
+        slot->deadline = 0;
+        slot->waiter = NULL;
+        slot->length = static_cast<uint16_t>(length);
+        slot->state = SLOT_QUEUED;
+        slot->priority = priority;
+        slot->attempts = 0;
+        slot->result = CMD_STATUS_QUEUED;
+        slot->anyReply = anyReply;
+        strcpy(slot->deviceId, deviceId);
+        memcpy(slot->data, data, length);
+    } else {
+        _rejected++;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return handle;
+}
+
+/**
+ * @name status
+ * @brief Trạng thái hiện tại của lệnh
+ * 
+ * @param {CommandHandle} handle - Handle của lệnh
+ * 
+ * @return CommandStatus - Trạng thái
+ */
+CommandStatus CommandScheduler::status(CommandHandle handle) {
+    CommandStatus result = CMD_STATUS_UNKNOWN;
+    portENTER_CRITICAL(&_lock);
+    Slot *slot = findSlot(handle);
+    if (slot != nullptr) {
+        result = static_cast<CommandStatus>(slot->result);
+    }
+    portEXIT_CRITICAL(&_lock);
+    return result;
+}
+
+/**
+ * @name wait
+ * @brief Chờ đến khi lệnh được ACK hoặc thất bại. Ô lệnh được giải phóng khi trả về kết quả cuối
+ * 
+ * @param {CommandHandle} handle - Handle của lệnh
+ * @param {uint32_t} timeoutMs - Thời gian chờ tối đa (ms)
+ * 
+ * @return CommandStatus - CMD_STATUS_ACKED, CMD_STATUS_FAILED, CMD_STATUS_TIMEOUT hoặc CMD_STATUS_UNKNOWN
+ */
+CommandStatus CommandScheduler::wait(CommandHandle handle, uint32_t timeoutMs) {
+    unsigned long start = millis();
+    for (;;) {
+        CommandStatus result = CMD_STATUS_UNKNOWN;
+        bool finished = true;
+        portENTER_CRITICAL(&_lock);
+        Slot *slot = findSlot(handle);
+        if (slot != nullptr) {
+            if (slot->state == SLOT_DONE) {
+                result = static_cast<CommandStatus>(slot->result);
+                slot->state = SLOT_FREE;
+                slot->waiter = NULL;
+            } else if (millis() - start >= timeoutMs) {
+                result = CMD_STATUS_TIMEOUT;
+                slot->waiter = NULL;
+            } else {
+                slot->waiter = xTaskGetCurrentTaskHandle();
+                finished = false;
+            }
+        }
+        portEXIT_CRITICAL(&_lock);
+
+        if (finished) {
+            return result;
+        }
+        uint32_t elapsed = millis() - start;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs > elapsed ? timeoutMs - elapsed : 0));
+    }
+}
+
+/**
+ * @name next
+ * @brief Lấy lệnh tiếp theo được phép gửi lúc này
+ * 
+ * @param {unsigned long} now - millis() hiện tại
+ * @param {Transmission&} transmission - Dữ liệu cần ghi ra UART
+ * 
+ * @return bool - True nếu có lệnh cần gửi
+ */
+bool CommandScheduler::next(unsigned long now, Transmission &transmission) {
+    bool found = false;
+    portENTER_CRITICAL(&_lock);
+    if ((long)(now - _nextSendAt) >= 0) {
+        Slot *best = nullptr;
+        for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+            Slot &slot = _slots[i];
+            if (slot.state != SLOT_QUEUED) {
+                continue;
+            }
+            if (best != nullptr && (slot.priority > best->priority ||
+                                    (slot.priority == best->priority && (int32_t)(slot.sequence - best->sequence) > 0))) {
+                continue;
+            }
+            if (inFlight(slot.deviceId) >= _maxInFlight) {
+                continue;
+            }
+            best = &slot;
+        }
+
+        if (best != nullptr) {
+            // 10 bit mỗi byte (8N1)
+            uint32_t transmitMs = (best->length * 10000UL + _baudRate - 1) / _baudRate;
+            best->state = SLOT_IN_FLIGHT;
+            best->result = CMD_STATUS_IN_FLIGHT;
+            best->attempts++;
+            best->deadline = now + transmitMs + _ackTimeoutMs;
+            memcpy(transmission.data, best->data, best->length);
+            transmission.length = best->length;
+            _nextSendAt = now + transmitMs + ZIGBEE_COMMAND_GAP_MS;
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return found;
+}
+
+/**
+ * @name complete
+ * @brief Kết thúc lệnh, gọi trong vùng khóa
+ * 
+ * @param {Slot&} slot - Ô lệnh
+ * @param {CommandStatus} result - Kết quả
+ * 
+ * @return None
+ */
+void CommandScheduler::complete(Slot &slot, CommandStatus result) {
+    slot.state = SLOT_DONE;
+    slot.result = result;
+}
+
+/**
+ * @name poll
+ * @brief Gửi lại hoặc đánh dấu thất bại các lệnh quá hạn ACK
+ * 
+ * @param {unsigned long} now - millis() hiện tại
+ * 
+ * @return None
+ */
+void CommandScheduler::poll(unsigned long now) {
+    TaskHandle_t waiters[ZIGBEE_COMMAND_SLOTS];
+    size_t waiterCount = 0;
+
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        Slot &slot = _slots[i];
+        if (slot.state != SLOT_IN_FLIGHT || (long)(now - slot.deadline) < 0) {
+            continue;
+        }
+        if (slot.attempts >= _maxAttempts) {
+            complete(slot, CMD_STATUS_FAILED);
+            _failures++;
+            if (slot.waiter != NULL) {
+                waiters[waiterCount++] = slot.waiter;
+            }
+        } else {
+            slot.state = SLOT_QUEUED;
+            slot.result = CMD_STATUS_QUEUED;
+            _retries++;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    // Không gọi API FreeRTOS có thể chuyển task khi đang giữ spinlock
+    for (size_t i = 0; i < waiterCount; i++) {
+        xTaskNotifyGive(waiters[i]);
+    }
+}
+
+/**
+ * @name acknowledge
+ * @brief Ghép khung tin trả lời với lệnh đang chờ lâu nhất của thiết bị
+ * 
+ * @param {const char*} deviceId - ID thiết bị gửi khung tin
+ * @param {bool} explicitAck - True nếu khung tin là ACK, false nếu là dữ liệu thường
+ * 
+ * @return bool - True nếu có lệnh được ACK
+ */
+bool CommandScheduler::acknowledge(const char *deviceId, bool explicitAck) {
+    TaskHandle_t waiter = NULL;
+    bool matched = false;
+
+    portENTER_CRITICAL(&_lock);
+    Slot *oldest = nullptr;
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        Slot &slot = _slots[i];
+        if (slot.state == SLOT_IN_FLIGHT && (explicitAck || slot.anyReply) &&
+            strcmp(slot.deviceId, deviceId) == 0 &&
+            (oldest == nullptr || (int32_t)(slot.sequence - oldest->sequence) < 0)) {
+            oldest = &slot;
+        }
+    }
+    if (oldest != nullptr) {
+        complete(*oldest, CMD_STATUS_ACKED);
+        waiter = oldest->waiter;
+        matched = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (waiter != NULL) {
+        xTaskNotifyGive(waiter);
+    }
+    return matched;
+}
+
+/**
+ * @name nextWakeMs
+ * @brief Thời gian đến lần cần xử lý tiếp theo (gửi lệnh hoặc hết hạn ACK)
+ * 
+ * @param {unsigned long} now - millis() hiện tại
+ * 
+ * @return uint32_t - Số ms, UINT32_MAX nếu không có lệnh nào
+ */
+uint32_t CommandScheduler::nextWakeMs(unsigned long now) {
+    uint32_t wake = UINT32_MAX;
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < ZIGBEE_COMMAND_SLOTS; i++) {
+        const Slot &slot = _slots[i];
+        long remaining;
+        if (slot.state == SLOT_QUEUED) {
+            if (inFlight(slot.deviceId) >= _maxInFlight) {
+                // Sẽ được đánh thức bởi hạn ACK của lệnh đang chờ
+                continue;
+            }
+            remaining = (long)(_nextSendAt - now);
+        } else if (slot.state == SLOT_IN_FLIGHT) {
+            remaining = (long)(slot.deadline - now);
+        } else {
+            continue;
+        }
+        uint32_t value = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        if (value < wake) {
+            wake = value;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return wake;
+}
@@ -0,0 +1,119 @@
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include "DeviceRegistry.h"
+
+#ifndef ZIGBEE_COMMAND_SLOTS
+#define ZIGBEE_COMMAND_SLOTS 16
+#endif
+
+#define ZIGBEE_COMMAND_MAX_SIZE 128
+#define ZIGBEE_COMMAND_GAP_MS 20       // Khoảng nghỉ tối thiểu giữa hai lệnh
+#define ZIGBEE_COMMAND_ACK_TIMEOUT_MS 1000
+#define ZIGBEE_COMMAND_MAX_ATTEMPTS 3
+
+typedef uint32_t CommandHandle;
+
+enum CommandPriority : uint8_t {
+    CMD_PRIORITY_HIGH = 0,
+    CMD_PRIORITY_NORMAL = 1,
+    CMD_PRIORITY_LOW = 2
+};
+
+enum CommandStatus : uint8_t {
+    CMD_STATUS_UNKNOWN = 0, // Handle không hợp lệ hoặc đã bị thu hồi
+    CMD_STATUS_QUEUED,
+    CMD_STATUS_IN_FLIGHT,   // Đã gửi, đang chờ ACK
+    CMD_STATUS_ACKED,
+    CMD_STATUS_FAILED,      // Hết số lần thử mà không có ACK
+    CMD_STATUS_TIMEOUT      // Chỉ trả về từ wait(): người gọi hết thời gian chờ
+};
+
+/**
+ * Hàng đợi lệnh gửi xuống thiết bị, có giới hạn, an toàn giữa các core.
+ *
+ * - Lệnh được chọn theo độ ưu tiên rồi theo thứ tự gửi.
+ * - Mỗi thiết bị có tối đa maxInFlight lệnh đang chờ ACK.
+ * - Khoảng cách giữa hai lần gửi đủ để truyền hết lệnh trước ở baud hiện tại.
+ * - Lệnh không có ACK sau ackTimeout được gửi lại, tối đa maxAttempts lần.
+ *
+ * submit()/status()/wait() gọi được từ bất kỳ task nào; next()/poll()/acknowledge()
+ * chỉ gọi từ task ZigbeeServer.
+ */
+class CommandScheduler
+{
+public:
+    struct Transmission {
+        uint8_t data[ZIGBEE_COMMAND_MAX_SIZE];
+        size_t length;
+    };
+
+    CommandScheduler();
+
+    void setBaudRate(uint32_t baudRate) { _baudRate = baudRate > 0 ? baudRate : 9600; }
+    void setMaxInFlight(uint8_t maxInFlight) { _maxInFlight = maxInFlight > 0 ? maxInFlight : 1; }
+    void setRetryPolicy(uint32_t ackTimeoutMs, uint8_t maxAttempts);
+
+    // anyReply: mọi khung tin từ thiết bị đều được coi là ACK (vd. lệnh CHECK)
+    CommandHandle submit(const char *deviceId, const uint8_t *data, size_t length,
+                         uint8_t priority = CMD_PRIORITY_NORMAL, bool anyReply = false);
+    CommandStatus status(CommandHandle handle);
+    // Chờ lệnh hoàn tất; dùng task notification của task gọi
+    CommandStatus wait(CommandHandle handle, uint32_t timeoutMs);
+
+    bool next(unsigned long now, Transmission &transmission);
+    void poll(unsigned long now);
+    bool acknowledge(const char *deviceId, bool explicitAck);
+    uint32_t nextWakeMs(unsigned long now);
+
+    uint32_t rejected() const { return _rejected; }
+    uint32_t retries() const { return _retries; }
+    uint32_t failures() const { return _failures; }
+
+private:
+    enum SlotState : uint8_t {
+        SLOT_FREE = 0,
+        SLOT_QUEUED,
+        SLOT_IN_FLIGHT,
+        SLOT_DONE
+    };
+
+    struct Slot {
+        CommandHandle handle;
+        uint32_t sequence;
+        unsigned long deadline;
+        TaskHandle_t waiter;
+        uint16_t length;
+        uint8_t state;
+        uint8_t priority;
+        uint8_t attempts;
+        uint8_t result;
+        bool anyReply;
+        char deviceId[DEVICE_ID_SIZE];
+        uint8_t data[ZIGBEE_COMMAND_MAX_SIZE];
+    };
+
+    Slot *findSlot(CommandHandle handle);
+    Slot *allocateSlot();
+    uint8_t inFlight(const char *deviceId) const;
+    void complete(Slot &slot, CommandStatus result);
+
+    Slot _slots[ZIGBEE_COMMAND_SLOTS];
+    portMUX_TYPE _lock;
+    CommandHandle _nextHandle;
+    uint32_t _nextSequence;
+    unsigned long _nextSendAt;
+    uint32_t _baudRate;
+    uint8_t _maxInFlight;
+    uint32_t _ackTimeoutMs;
+    uint8_t _maxAttempts;
+
+    uint32_t _rejected;
+    uint32_t _retries;
+    uint32_t _failures;
+};
+
+#endif // COMMANDSCHEDULER_H
@@ -0,0 +1,97 @@
+#include "Crc32.h"
+
+uint32_t Crc32::_table[4][256];
+
+// Bảng tra được tạo một lần khi khởi động (4 KB RAM)
+struct Crc32TableInit {
+    Crc32TableInit() { Crc32::initTable(); }
+};
+static Crc32TableInit crc32TableInit;
+
+/**
+ * @name initTable
+ * @brief Tạo bảng tra slice-by-4
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void Crc32::initTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+        _table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 4; k++) {
+            uint32_t prev = _table[k - 1][i];
+            _table[k][i] = (prev << 8) ^ _table[0][prev >> 24];
+        }
+    }
+}
+
+/**
+ * @name update
+ * @brief Cập nhật CRC với một khối dữ liệu, xử lý 4 byte mỗi lần
+ * 
+ * @param {const char*} data - Dữ liệu
+ * @param {size_t} length - Độ dài dữ liệu
+ * 
+ * @return None
+ */
+void Crc32::update(const char *data, size_t length) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    uint32_t crc = _crc;
+    while (length >= 4) {
+        crc ^= (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        crc = _table[3][crc >> 24] ^ _table[2][(crc >> 16) & 0xff] ^
+              _table[1][(crc >> 8) & 0xff] ^ _table[0][crc & 0xff];
+        p += 4;
+        length -= 4;
+    }
+    while (length--) {
+        crc = (crc << 8) ^ _table[0][(crc >> 24) ^ *p++];
+    }
+    _crc = crc;
+}
+
+/**
+ * @name calculate
+ * @brief Tính CRC32 của cả khối dữ liệu
+ * 
+ * @param {const char*} data - Dữ liệu cần tính toán
+ * @param {size_t} length - Độ dài dữ liệu
+ * 
+ * @return uint32_t - CRC32
+ */
+uint32_t Crc32::calculate(const char *data, size_t length) {
+    Crc32 crc;
+    crc.update(data, length);
+    return crc.value();
+}
+
+/**
+ * @name matchesHex
+ * @brief So CRC nhận được với giá trị đã tính như giao thức gốc ("%08X"): đúng 8 chữ số
+ *        hex in hoa, các ký tự sau ký tự thứ 8 được bỏ qua. Không cấp phát bộ nhớ
+ * 
+ * @param {const char*} hex - Chuỗi CRC nhận được
+ * @param {size_t} length - Độ dài chuỗi
+ * @param {uint32_t} crc - CRC đã tính
+ * 
+ * @return bool - True nếu khớp; chuỗi ngắn hơn 8 ký tự hoặc có chữ thường là không khớp
+ */
+bool Crc32::matchesHex(const char *hex, size_t length, uint32_t crc) {
+    static const char digits[] = "0123456789ABCDEF";
+    if (length < 8) {
+        return false;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (hex[i] != digits[(crc >> (28 - 4 * i)) & 0x0f]) {
+            return false;
+        }
+    }
+    return true;
+}
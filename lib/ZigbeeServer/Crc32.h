@@ -0,0 +1,39 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * CRC32 (đa thức 0x04C11DB7, MSB-first, init 0xFFFFFFFF, đảo bit kết quả)
+ * dùng bảng tra slice-by-4. Có thể cập nhật từng byte khi dữ liệu đến
+ * hoặc cả khối dữ liệu một lần.
+ */
+class Crc32
+{
+public:
+    Crc32() : _crc(0xffffffff) {}
+
+    void reset() { _crc = 0xffffffff; }
+
+    void update(uint8_t c) { _crc = (_crc << 8) ^ _table[0][(_crc >> 24) ^ c]; }
+    void update(const char *data, size_t length);
+
+    // Trạng thái trung gian (chưa đảo bit), dùng để lưu lại giữa chừng khung tin
+    uint32_t state() const { return _crc; }
+    uint32_t value() const { return ~_crc; }
+
+    static uint32_t finalize(uint32_t state) { return ~state; }
+    static uint32_t calculate(const char *data, size_t length);
+    static bool matchesHex(const char *hex, size_t length, uint32_t crc);
+
+private:
+    static void initTable();
+
+    uint32_t _crc;
+    static uint32_t _table[4][256];
+
+    friend struct Crc32TableInit;
+};
+
+#endif // CRC32_H
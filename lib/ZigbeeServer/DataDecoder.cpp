@@ -0,0 +1,122 @@
+#include "DataDecoder.h"
+#include <string.h>
+#include <strings.h>
+
+/**
+ * @name parseNumber
+ * @brief Đọc một số thập phân mà không dùng strtod/std::stod (không cấp phát, không ngoại lệ)
+ * 
+ * @param {const char*} p - Vị trí bắt đầu
+ * @param {const char*} end - Vị trí kết thúc
+ * @param {double&} out - Giá trị đọc được
+ * 
+ * @return const char* - Vị trí ngay sau số, nullptr nếu không có số hợp lệ
+ */
+const char *DataDecoder::parseNumber(const char *p, const char *end, double &out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    double value = 0;
+    bool digits = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+        digits = true;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+            digits = true;
+        }
+    }
+    if (!digits) {
+        return nullptr;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExp = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negativeExp = *p++ == '-';
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            return nullptr;
+        }
+        int exponent = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (exponent < 400) {
+                exponent = exponent * 10 + (*p - '0');
+            }
+            p++;
+        }
+        double factor = 1;
+        while (exponent-- > 0) {
+            factor *= 10;
+        }
+        value = negativeExp ? value / factor : value * factor;
+    }
+
+    out = negative ? -value : value;
+    return p;
+}
+
+const DataField *DataDecoder::lookup(const char *key, size_t keyLength) const {
+    for (size_t i = 0; i < _schemaSize; i++) {
+        if (strncmp(_schema[i].key, key, keyLength) == 0 && _schema[i].key[keyLength] == '\0') {
+            return &_schema[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @name decodeValue
+ * @brief Đọc giá trị theo kiểu của thông số, cho phép khoảng trắng ở hai đầu
+ * 
+ * @param {const DataField*} field - Thông số trong bảng, nullptr nếu không biết
+ * @param {const char*} p - Vị trí bắt đầu giá trị
+ * @param {const char*} end - Vị trí kết thúc giá trị
+ * @param {double&} out - Giá trị đã nhân hệ số
+ * 
+ * @return bool - False nếu giá trị sai định dạng
+ */
+bool DataDecoder::decodeValue(const DataField *field, const char *p, const char *end, double &out) const {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    if (p == end) {
+        return false;
+    }
+
+    if (field != nullptr && field->type == DATA_BOOL) {
+        size_t length = end - p;
+        if ((length == 4 && strncasecmp(p, "true", 4) == 0) || (length == 2 && strncasecmp(p, "on", 2) == 0) ||
+            (length == 1 && *p == '1')) {
+            out = 1;
+            return true;
+        }
+        if ((length == 5 && strncasecmp(p, "false", 5) == 0) || (length == 3 && strncasecmp(p, "off", 3) == 0) ||
+            (length == 1 && *p == '0')) {
+            out = 0;
+            return true;
+        }
+        return false;
+    }
+
+    double value;
+    if (parseNumber(p, end, value) != end) {
+        return false;
+    }
+    if (field != nullptr) {
+        if (field->type == DATA_INT &&
+            (value < -9.0e18 || value > 9.0e18 || value != static_cast<double>(static_cast<int64_t>(value)))) {
+            return false;
+        }
+        value *= field->scale;
+    }
+    out = value;
+    return true;
+}
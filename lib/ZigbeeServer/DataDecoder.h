@@ -0,0 +1,106 @@
+#ifndef DATADECODER_H
+#define DATADECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DATA_DECODER_KEY_SIZE 32
+
+enum DataType : uint8_t {
+    DATA_NUMBER, // Số thực
+    DATA_INT,    // Số nguyên
+    DATA_BOOL    // true/false, on/off, 1/0
+};
+
+/**
+ * Mô tả một thông số đã biết: giá trị đọc được nhân với scale để ra đơn vị unit.
+ */
+struct DataField {
+    const char *key;
+    DataType type;
+    float scale;
+    const char *unit;
+};
+
+/**
+ * Một giá trị đã giải mã. key kết thúc bằng '\0' (bản sao trên stack),
+ * field là nullptr nếu thông số không có trong bảng.
+ */
+struct DataValue {
+    const char *key;
+    double value;
+    const DataField *field;
+};
+
+/**
+ * Giải mã trường DATA dạng "key:value[,key:value...]" trong một lượt, không
+ * cấp phát và không ném ngoại lệ. Thông số có trong bảng được đọc theo kiểu
+ * và hệ số của nó; thông số khác được đọc như số thực. Mục sai định dạng bị
+ * bỏ qua và được đếm vào errors().
+ */
+class DataDecoder
+{
+public:
+    DataDecoder(const DataField *schema, size_t schemaSize) : _schema(schema), _schemaSize(schemaSize), _errors(0) {}
+
+    // Trả về số giá trị đã giải mã; emit(const DataValue&) được gọi cho từng giá trị
+    template <typename Emit>
+    size_t decode(const char *data, Emit emit);
+
+    uint32_t errors() const { return _errors; }
+
+    // Đọc số dạng [-]digits[.digits][e[+-]digits], trả về vị trí sau số hoặc nullptr
+    static const char *parseNumber(const char *p, const char *end, double &out);
+
+private:
+    const DataField *lookup(const char *key, size_t keyLength) const;
+    bool decodeValue(const DataField *field, const char *p, const char *end, double &out) const;
+
+    const DataField *_schema;
+    size_t _schemaSize;
+    uint32_t _errors;
+};
+
+template <typename Emit>
+size_t DataDecoder::decode(const char *data, Emit emit) {
+    size_t decoded = 0;
+    const char *p = data;
+    while (*p) {
+        const char *itemEnd = p;
+        while (*itemEnd && *itemEnd != ',') {
+            itemEnd++;
+        }
+
+        const char *colon = p;
+        while (colon < itemEnd && *colon != ':') {
+            colon++;
+        }
+        size_t keyLength = colon - p;
+        if (p == itemEnd) {
+            // Bỏ qua mục rỗng ("a:1,,b:2")
+        } else if (colon == itemEnd || keyLength == 0 || keyLength >= DATA_DECODER_KEY_SIZE) {
+            _errors++;
+        } else {
+            char key[DATA_DECODER_KEY_SIZE];
+            for (size_t i = 0; i < keyLength; i++) {
+                key[i] = p[i];
+            }
+            key[keyLength] = '\0';
+
+            DataValue value;
+            value.key = key;
+            value.field = lookup(key, keyLength);
+            if (decodeValue(value.field, colon + 1, itemEnd, value.value)) {
+                emit(value);
+                decoded++;
+            } else {
+                _errors++;
+            }
+        }
+
+        p = *itemEnd ? itemEnd + 1 : itemEnd;
+    }
+    return decoded;
+}
+
+#endif // DATADECODER_H
@@ -0,0 +1,55 @@
+#include "DeviceChangeSet.h"
+
+DeviceChangeSet::DeviceChangeSet(size_t capacity)
+    : _words((capacity + 31) / 32), _pending(0), _firstAt(0), _lastAt(0)
+{
+    _bits = new std::atomic<uint32_t>[_words];
+    for (size_t i = 0; i < _words; i++) {
+        _bits[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+DeviceChangeSet::~DeviceChangeSet() {
+    delete[] _bits;
+}
+
+/**
+ * @name mark
+ * @brief Đánh dấu thiết bị vừa thay đổi
+ * 
+ * @param {size_t} index - Chỉ số thiết bị
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return None
+ */
+void DeviceChangeSet::mark(size_t index, unsigned long now) {
+    if (index / 32 >= _words) {
+        return;
+    }
+    _lastAt.store(now, std::memory_order_relaxed);
+    uint32_t bit = 1u << (index % 32);
+    if (_bits[index / 32].fetch_or(bit, std::memory_order_acq_rel) & bit) {
+        return;
+    }
+    if (_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        _firstAt.store(now, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @name ready
+ * @brief Kiểm tra đã đến lúc gửi các thay đổi đang chờ chưa
+ * 
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * @param {uint32_t} quietMs - Gửi khi không có thay đổi mới trong khoảng này
+ * @param {uint32_t} maxDelayMs - Gửi muộn nhất sau khoảng này, kể cả khi vẫn còn thay đổi mới
+ * 
+ * @return bool - True nếu nên gửi
+ */
+bool DeviceChangeSet::ready(unsigned long now, uint32_t quietMs, uint32_t maxDelayMs) const {
+    if (pending() == 0) {
+        return false;
+    }
+    return now - _lastAt.load(std::memory_order_relaxed) >= quietMs ||
+           now - _firstAt.load(std::memory_order_relaxed) >= maxDelayMs;
+}
@@ -0,0 +1,56 @@
+#ifndef DEVICECHANGESET_H
+#define DEVICECHANGESET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * Tập các thiết bị (theo chỉ số trong DeviceRegistry) vừa vào hoặc rời mạng
+ * nhưng chưa được báo lên server. Mỗi thiết bị một bit, nên nhiều thay đổi
+ * liên tiếp của cùng thiết bị chỉ được báo một lần với trạng thái cuối cùng.
+ *
+ * mark() chỉ gọi từ task ZigbeeServer; ready()/drain() gọi từ task gửi MQTT.
+ * Hai bên chỉ dùng phép toán nguyên tử, không khóa.
+ */
+class DeviceChangeSet
+{
+public:
+    explicit DeviceChangeSet(size_t capacity);
+    ~DeviceChangeSet();
+
+    void mark(size_t index, unsigned long now);
+
+    size_t pending() const { return _pending.load(std::memory_order_acquire); }
+    // True khi đã im lặng quietMs kể từ thay đổi cuối, hoặc thay đổi đầu tiên đã chờ maxDelayMs
+    bool ready(unsigned long now, uint32_t quietMs, uint32_t maxDelayMs) const;
+
+    // Gọi fn(index) cho mỗi thiết bị đã thay đổi và xóa khỏi tập
+    template <typename Fn>
+    size_t drain(Fn fn) {
+        size_t count = 0;
+        for (size_t word = 0; word < _words; word++) {
+            uint32_t bits = _bits[word].exchange(0, std::memory_order_acq_rel);
+            while (bits != 0) {
+                int bit = __builtin_ctz(bits);
+                bits &= bits - 1;
+                fn(word * 32 + bit);
+                count++;
+            }
+        }
+        _pending.fetch_sub(count, std::memory_order_acq_rel);
+        return count;
+    }
+
+private:
+    DeviceChangeSet(const DeviceChangeSet &);
+    DeviceChangeSet &operator=(const DeviceChangeSet &);
+
+    std::atomic<uint32_t> *_bits;
+    size_t _words;
+    std::atomic<size_t> _pending;
+    std::atomic<unsigned long> _firstAt;
+    std::atomic<unsigned long> _lastAt;
+};
+
+#endif // DEVICECHANGESET_H
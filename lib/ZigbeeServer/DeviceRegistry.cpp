@@ -0,0 +1,98 @@
+#include "DeviceRegistry.h"
+#include <string.h>
+
+DeviceRegistry::DeviceRegistry(size_t capacity)
+    : _capacity(capacity < kEmpty ? capacity : kEmpty - 1), _count(0)
+{
+    // Bảng băm lớn hơn ít nhất 2 lần số thiết bị để chuỗi dò ngắn
+    size_t indexSize = 1;
+    while (indexSize < _capacity * 2) {
+        indexSize <<= 1;
+    }
+    _indexMask = indexSize - 1;
+
+    _devices = new Device[_capacity];
+    memset(_devices, 0, sizeof(Device) * _capacity);
+    _index = new std::atomic<uint16_t>[indexSize];
+    for (size_t i = 0; i < indexSize; i++) {
+        _index[i].store(kEmpty, std::memory_order_relaxed);
+    }
+}
+
+DeviceRegistry::~DeviceRegistry() {
+    delete[] _devices;
+    delete[] _index;
+}
+
+/**
+ * @name hash
+ * @brief Băm FNV-1a cho ID thiết bị
+ * 
+ * @param {const char*} id - ID của thiết bị
+ * 
+ * @return uint32_t - Giá trị băm
+ */
+uint32_t DeviceRegistry::hash(const char *id) {
+    uint32_t h = 2166136261u;
+    while (*id) {
+        h ^= static_cast<uint8_t>(*id++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @name find
+ * @brief Tìm thiết bị theo ID
+ * 
+ * @param {const char*} id - ID của thiết bị
+ * 
+ * @return int - Vị trí của thiết bị, kNotFound nếu không có
+ */
+int DeviceRegistry::find(const char *id) const {
+    size_t slot = hash(id) & _indexMask;
+    for (;;) {
+        uint16_t index = _index[slot].load(std::memory_order_acquire);
+        if (index == kEmpty) {
+            return kNotFound;
+        }
+        if (strcmp(_devices[index].id, id) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & _indexMask;
+    }
+}
+
+/**
+ * @name add
+ * @brief Thêm thiết bị mới, chỉ gọi từ task ZigbeeServer
+ * 
+ * @param {const char*} id - ID của thiết bị
+ * 
+ * @return int - Vị trí của thiết bị, kNotFound nếu danh sách đầy hoặc ID quá dài
+ */
+int DeviceRegistry::add(const char *id) {
+    int existing = find(id);
+    if (existing != kNotFound) {
+        return existing;
+    }
+
+    size_t count = _count.load(std::memory_order_relaxed);
+    size_t length = strlen(id);
+    if (count >= _capacity || length == 0 || length >= DEVICE_ID_SIZE) {
+        return kNotFound;
+    }
+
+    Device &device = _devices[count];
+    memset(&device, 0, sizeof(device));
+    memcpy(device.id, id, length + 1);
+
+    size_t slot = hash(id) & _indexMask;
+    while (_index[slot].load(std::memory_order_relaxed) != kEmpty) {
+        slot = (slot + 1) & _indexMask;
+    }
+    // Công bố thiết bị sau khi đã ghi đầy đủ
+    _index[slot].store(static_cast<uint16_t>(count), std::memory_order_release);
+    _count.store(count + 1, std::memory_order_release);
+    return static_cast<int>(count);
+}
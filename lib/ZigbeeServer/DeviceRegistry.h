@@ -0,0 +1,84 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifndef DEVICE_REGISTRY_CAPACITY
+#define DEVICE_REGISTRY_CAPACITY 512
+#endif
+
+#define DEVICE_ID_SIZE 24
+
+enum WireFormat : uint8_t {
+    WIRE_ASCII = 0,  // "ID:...,DATA:...,CRC:..."
+    WIRE_BINARY = 1  // Khung COBS/TLV (BinaryFrame.h)
+};
+
+enum DeviceStatus : uint8_t {
+    DEVICE_UNKNOWN = 0, // Chưa nhận khung tin nào (vd. thêm bằng addDevice)
+    DEVICE_ONLINE = 1,
+    DEVICE_STALE = 2,   // Không trả lời lệnh kiểm tra
+    DEVICE_OFFLINE = 3  // Không trả lời ZIGBEE_OFFLINE_AFTER_MISSES lệnh kiểm tra liên tiếp
+};
+
+struct Device {
+    char id[DEVICE_ID_SIZE];
+    uint32_t lastSeen;  // millis() khi nhận khung tin gần nhất
+    uint32_t frames;    // Số khung tin hợp lệ
+    uint16_t crcErrors; // Số khung tin sai CRC
+    int8_t rssi;        // dBm, 0 nếu thiết bị không báo
+    uint8_t lqi;        // 0 nếu thiết bị không báo
+    uint8_t wireFormat; // Định dạng khung gần nhất thiết bị gửi (WireFormat)
+    uint8_t status;     // DeviceStatus
+};
+
+/**
+ * Danh sách thiết bị có bảng băm (địa chỉ mở) để tìm theo ID trong O(1).
+ * Chỉ task ZigbeeServer được thêm thiết bị; các task khác có thể tìm kiếm
+ * và duyệt danh sách đồng thời vì thiết bị chỉ được công bố sau khi ghi xong
+ * và không bao giờ bị xóa hay di chuyển.
+ */
+class DeviceRegistry
+{
+public:
+    static const int kNotFound = -1;
+
+    explicit DeviceRegistry(size_t capacity = DEVICE_REGISTRY_CAPACITY);
+    ~DeviceRegistry();
+
+    int find(const char *id) const;
+    int add(const char *id);
+
+    Device &at(size_t index) { return _devices[index]; }
+    const Device &at(size_t index) const { return _devices[index]; }
+
+    size_t size() const { return _count.load(std::memory_order_acquire); }
+    size_t capacity() const { return _capacity; }
+
+    // Duyệt các thiết bị đã được công bố, an toàn khi gọi từ core khác
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        size_t count = size();
+        for (size_t i = 0; i < count; i++) {
+            fn(_devices[i]);
+        }
+    }
+
+private:
+    DeviceRegistry(const DeviceRegistry &);
+    DeviceRegistry &operator=(const DeviceRegistry &);
+
+    static uint32_t hash(const char *id);
+
+    static const uint16_t kEmpty = 0xffff;
+
+    Device *_devices;
+    std::atomic<uint16_t> *_index;
+    size_t _capacity;
+    size_t _indexMask;
+    std::atomic<size_t> _count;
+};
+
+#endif // DEVICEREGISTRY_H
@@ -0,0 +1,196 @@
+#include "FrameParser.h"
+
+FrameParser::FrameParser()
+    : _length(0), _discarding(false), _binary(false), _binaryLength(0), _crcAtComma(0),
+      _frame(), _overlongLines(0), _truncatedLines(0), _binaryOverruns(0)
+{
+    _buf[0] = '\0';
+}
+
+/**
+ * @name reset
+ * @brief Bỏ dòng đang nhận dở
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void FrameParser::reset() {
+    _length = 0;
+    _discarding = false;
+    _binary = false;
+    _crc.reset();
+    _buf[0] = '\0';
+}
+
+/**
+ * @name push
+ * @brief Đưa một byte nhận được vào bộ đệm, CRC được tính dần theo từng byte
+ * 
+ * @param {char} c - Byte nhận được
+ * 
+ * @return Result - Trạng thái sau khi nhận byte
+ */
+FrameParser::Result FrameParser::push(char c) {
+    if (static_cast<uint8_t>(c) == BinaryFrame::kDelimiter) {
+        return delimiter();
+    }
+    if (_binary) {
+        return pushBinary(c);
+    }
+    if (c == '\n') {
+        return finishLine();
+    }
+    if (_discarding) {
+        return FRAME_NONE;
+    }
+    if (_length >= kMaxLineLength) {
+        // Dòng quá dài (vd. nhiễu không có '\n'): bỏ cho đến hết dòng
+        _discarding = true;
+        return FRAME_NONE;
+    }
+    if (c == ',') {
+        // CRC hex không chứa dấu phẩy nên dấu phẩy cuối cùng luôn là của ",CRC:"
+        _crcAtComma = _crc.state();
+    }
+    _crc.update(static_cast<uint8_t>(c));
+    _buf[_length++] = c;
+    return FRAME_NONE;
+}
+
+/**
+ * @name pushBinary
+ * @brief Nhận một byte của khung nhị phân đang mở
+ * 
+ * @param {char} c - Byte nhận được (khác 0x00)
+ * 
+ * @return Result - FRAME_OVERLONG nếu khung vượt quá khung COBS hợp lệ dài nhất
+ *         và bộ phân tích quay lại chế độ ASCII
+ */
+FrameParser::Result FrameParser::pushBinary(char c) {
+    if (_length < kMaxLineLength) {
+        _buf[_length++] = c;
+        return FRAME_NONE;
+    }
+    // Không khung COBS nào giải mã vừa bộ đệm lại dài như vậy: byte 0x00 mở khung
+    // nhiều khả năng là nhiễu (UART break, nhiễu lúc module khởi động). Quay lại
+    // chế độ ASCII để các dòng của thiết bị cũ không bị mất mãi
+    _binaryOverruns++;
+    reset();
+    // Byte hiện tại thuộc về dòng ASCII đang bị cắt ngang, dòng này sẽ bị tính là thiếu trường
+    Result result = push(c);
+    return result == FRAME_NONE ? FRAME_OVERLONG : result;
+}
+
+/**
+ * @name delimiter
+ * @brief Xử lý byte 0x00: mở hoặc đóng một khung nhị phân
+ * 
+ * @param None
+ * 
+ * @return Result - Kết quả sau khi nhận byte phân cách
+ */
+FrameParser::Result FrameParser::delimiter() {
+    if (!_binary) {
+        // Dòng ASCII đang nhận dở bị cắt bởi khung nhị phân
+        bool truncated = _length > 0 || _discarding;
+        reset();
+        _binary = true;
+        if (truncated) {
+            _truncatedLines++;
+            return FRAME_TRUNCATED;
+        }
+        return FRAME_NONE;
+    }
+    if (_length == 0) {
+        // Hai byte phân cách liền nhau: vẫn chờ nội dung khung
+        return FRAME_NONE;
+    }
+
+    size_t decoded = 0;
+    bool ok = BinaryFrame::cobsDecode(reinterpret_cast<uint8_t *>(_buf), _length, decoded);
+    // Không gọi reset() để giữ nguyên payload vừa giải mã trong _buf
+    _length = 0;
+    _binary = false;
+    if (!ok) {
+        _truncatedLines++;
+        return FRAME_TRUNCATED;
+    }
+    _binaryLength = decoded;
+    return FRAME_BINARY;
+}
+
+/**
+ * @name finishLine
+ * @brief Kết thúc một dòng khi gặp '\n'
+ * 
+ * @param None
+ * 
+ * @return Result - Kết quả phân tích dòng
+ */
+FrameParser::Result FrameParser::finishLine() {
+    if (_discarding) {
+        _overlongLines++;
+        reset();
+        return FRAME_OVERLONG;
+    }
+
+    size_t length = _length;
+    while (length > 0 && _buf[length - 1] == '\r') {
+        length--;
+    }
+    _buf[length] = '\0';
+    _length = 0;
+    _crc.reset();
+
+    if (length == 0) {
+        return FRAME_NONE;
+    }
+
+    _frame.line = _buf;
+    _frame.length = length;
+    _frame.crcState = _crcAtComma;
+
+    if (tokenize()) {
+        return FRAME_READY;
+    }
+    if (strncmp(_buf, "ID:", 3) != 0 && strstr(_buf, "CMD:") != nullptr) {
+        return FRAME_OTHER;
+    }
+    _truncatedLines++;
+    return FRAME_TRUNCATED;
+}
+
+/**
+ * @name tokenize
+ * @brief Tách các trường ID, DATA, CRC ngay trong bộ đệm, thay dấu phân cách bằng '\0'
+ * 
+ * @param None
+ * 
+ * @return bool - True nếu dòng có đủ ID, DATA và CRC
+ */
+bool FrameParser::tokenize() {
+    char *line = _buf;
+    size_t length = _frame.length;
+    if (length < 3 || strncmp(line, "ID:", 3) != 0) {
+        return false;
+    }
+
+    char *dataMarker = strstr(line, ",DATA:");
+    char *crcMarker = strrchr(line, ',');
+    if (dataMarker == nullptr || crcMarker == nullptr || crcMarker <= dataMarker ||
+        strncmp(crcMarker, ",CRC:", 5) != 0) {
+        return false;
+    }
+
+    char *id = line + 3;
+    char *data = dataMarker + 6;
+    char *crc = crcMarker + 5;
+
+    _frame.id = FieldView(id, dataMarker - id);
+    _frame.data = FieldView(data, crcMarker - data);
+    _frame.crc = FieldView(crc, line + length - crc);
+    *dataMarker = '\0';
+    *crcMarker = '\0';
+    return !_frame.id.empty();
+}
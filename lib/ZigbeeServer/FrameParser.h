@@ -0,0 +1,88 @@
+#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Crc32.h"
+#include "BinaryFrame.h"
+
+/**
+ * Tham chiếu tới một đoạn trong bộ đệm khung tin, không sao chép dữ liệu.
+ * Sau khi tokenize, mỗi trường đều kết thúc bằng '\0' nên có thể dùng như const char*.
+ */
+struct FieldView {
+    const char *data;
+    size_t length;
+
+    FieldView() : data(""), length(0) {}
+    FieldView(const char *d, size_t l) : data(d), length(l) {}
+    bool empty() const { return length == 0; }
+    bool equals(const char *s) const { return strlen(s) == length && memcmp(s, data, length) == 0; }
+};
+
+struct Frame {
+    const char *line;
+    size_t length;
+    FieldView id;
+    FieldView data;
+    FieldView crc;
+    uint32_t crcState; // Trạng thái CRC của phần dữ liệu trước ",CRC:"
+};
+
+/**
+ * Bộ đệm dòng có kích thước cố định cho luồng UART dạng
+ * "ID:<id>,DATA:<data>,CRC:<hex>\n". Không cấp phát bộ nhớ khi nhận khung tin.
+ * Byte 0x00 chuyển sang nhận khung nhị phân (xem BinaryFrame.h) cho đến byte 0x00 kế tiếp;
+ * khung dài hơn bộ đệm bị bỏ và bộ phân tích quay lại chế độ ASCII (binaryOverruns()).
+ */
+class FrameParser
+{
+public:
+    static const size_t kMaxLineLength = 256;
+
+    enum Result {
+        FRAME_NONE,      // Chưa có dòng hoàn chỉnh
+        FRAME_READY,     // Có khung tin ID/DATA/CRC hợp lệ về cú pháp
+        FRAME_OTHER,     // Dòng không phải khung dữ liệu (vd. "CMD:BRD:DISC")
+        FRAME_TRUNCATED, // Thiếu trường ID, DATA hoặc CRC
+        FRAME_OVERLONG,  // Dòng hoặc khung nhị phân vượt quá kMaxLineLength và đã bị bỏ
+        FRAME_BINARY     // Có khung nhị phân đã giải mã COBS (chưa kiểm tra CRC)
+    };
+
+    FrameParser();
+
+    Result push(char c);
+    void reset();
+
+    const Frame &frame() const { return _frame; }
+    const char *line() const { return _buf; }
+    const uint8_t *binaryPayload() const { return reinterpret_cast<const uint8_t *>(_buf); }
+    size_t binaryLength() const { return _binaryLength; }
+
+    uint32_t overlongLines() const { return _overlongLines; }
+    uint32_t truncatedLines() const { return _truncatedLines; }
+    // Số khung nhị phân bị bỏ vì quá dài (thường do byte 0x00 nhiễu trên luồng ASCII)
+    uint32_t binaryOverruns() const { return _binaryOverruns; }
+
+private:
+    Result finishLine();
+    Result pushBinary(char c);
+    Result delimiter();
+    bool tokenize();
+
+    char _buf[kMaxLineLength + 1];
+    size_t _length;
+    bool _discarding;
+    bool _binary;
+    size_t _binaryLength;
+    Crc32 _crc;
+    uint32_t _crcAtComma;
+    Frame _frame;
+
+    uint32_t _overlongLines;
+    uint32_t _truncatedLines;
+    uint32_t _binaryOverruns;
+};
+
+#endif // FRAMEPARSER_H
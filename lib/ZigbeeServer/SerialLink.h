@@ -0,0 +1,56 @@
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "HardwareSerial.h"
+
+/**
+ * Giao diện cổng nối tiếp tới module Zigbee. ZigbeeServer chỉ làm việc qua giao diện này
+ * nên có thể thay bằng cổng giả lập phát lại luồng byte đã ghi.
+ */
+class SerialLink
+{
+public:
+    virtual ~SerialLink() {}
+
+    virtual void begin(uint32_t baudRate) = 0;
+    virtual size_t available() = 0;
+    // Đọc tối đa length byte đang có sẵn, không chờ
+    virtual size_t read(uint8_t *buffer, size_t length) = 0;
+    virtual size_t write(const uint8_t *data, size_t length) = 0;
+    // Callback được gọi (ngoài ngắt) khi có dữ liệu mới trong bộ đệm nhận
+    virtual void onReceive(std::function<void()> callback) = 0;
+};
+
+/**
+ * SerialLink trên HardwareSerial của ESP32, nhận theo sự kiện UART.
+ */
+class HardwareSerialLink : public SerialLink
+{
+public:
+    HardwareSerialLink(HardwareSerial &serial, int8_t rxPin, int8_t txPin, size_t rxBufferSize = 1024)
+        : _serial(serial), _rxPin(rxPin), _txPin(txPin), _rxBufferSize(rxBufferSize) {}
+
+    void begin(uint32_t baudRate) override {
+        // Phải đặt trước begin() để bộ đệm nhận đủ lớn khi baud cao
+        _serial.setRxBufferSize(_rxBufferSize);
+        _serial.begin(baudRate, SERIAL_8N1, _rxPin, _txPin);
+    }
+    size_t available() override { return _serial.available(); }
+    size_t read(uint8_t *buffer, size_t length) override {
+        size_t ready = _serial.available();
+        return _serial.readBytes(buffer, length < ready ? length : ready);
+    }
+    size_t write(const uint8_t *data, size_t length) override { return _serial.write(data, length); }
+    void onReceive(std::function<void()> callback) override { _serial.onReceive(callback); }
+
+private:
+    HardwareSerial &_serial;
+    int8_t _rxPin;
+    int8_t _txPin;
+    size_t _rxBufferSize;
+};
+
+#endif // SERIALLINK_H
@@ -0,0 +1,167 @@
+#include "TimerWheel.h"
+#include <Arduino.h>
+
+TimerWheel::TimerWheel(size_t capacity, uint32_t tickMs)
+    : _capacity(capacity < kNone ? capacity : kNone - 1), _pending(0), _tickMs(tickMs > 0 ? tickMs : 1),
+      _current(0), _lastTickAt(0), _started(false)
+{
+    _timers = new Timer[_capacity];
+    for (size_t i = 0; i < _capacity; i++) {
+        _timers[i].bucket = kNone;
+    }
+    for (size_t i = 0; i < kBuckets; i++) {
+        _heads[i] = kNone;
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    delete[] _timers;
+}
+
+/**
+ * @name schedule
+ * @brief Đặt timer hết hạn sau delayMs, thay cho lần đặt trước nếu có
+ * 
+ * @param {uint16_t} id - ID của timer (< capacity)
+ * @param {uint32_t} delayMs - Thời gian chờ (ms), làm tròn lên theo tick
+ * 
+ * @return None
+ */
+void TimerWheel::schedule(uint16_t id, uint32_t delayMs) {
+    if (id >= _capacity) {
+        return;
+    }
+    if (!_started) {
+        _lastTickAt = millis();
+        _started = true;
+    }
+    if (_timers[id].bucket != kNone) {
+        unlink(id);
+    }
+    uint32_t ticks = (delayMs + _tickMs - 1) / _tickMs;
+    _timers[id].expires = _current + (ticks > 0 ? ticks : 1);
+    insert(id);
+}
+
+/**
+ * @name cancel
+ * @brief Hủy timer
+ * 
+ * @param {uint16_t} id - ID của timer
+ * 
+ * @return None
+ */
+void TimerWheel::cancel(uint16_t id) {
+    if (scheduled(id)) {
+        unlink(id);
+    }
+}
+
+/**
+ * @name nextWakeMs
+ * @brief Thời gian task có thể ngủ trước tick kế tiếp
+ * 
+ * @param {unsigned long} now - Thời gian hiện tại (millis())
+ * 
+ * @return uint32_t - Số ms, UINT32_MAX nếu không có timer nào
+ */
+uint32_t TimerWheel::nextWakeMs(unsigned long now) const {
+    if (_pending == 0) {
+        return UINT32_MAX;
+    }
+    uint32_t elapsed = now - _lastTickAt;
+    return elapsed >= _tickMs ? 0 : _tickMs - elapsed;
+}
+
+/**
+ * @name insert
+ * @brief Đưa timer vào ô theo khoảng cách tới tick hết hạn
+ * 
+ * @param {uint16_t} id - ID của timer, expires đã được đặt
+ * 
+ * @return None
+ */
+void TimerWheel::insert(uint16_t id) {
+    Timer &timer = _timers[id];
+    uint32_t delta = timer.expires - _current;
+    if (static_cast<int32_t>(delta) < 0) {
+        // Đã quá hạn (khi chuyển tầng): xử lý ở tick này
+        timer.expires = _current;
+        delta = 0;
+    }
+
+    uint16_t bucket;
+    if (delta < kLevel0Size) {
+        bucket = timer.expires & kLevel0Mask;
+    } else {
+        uint32_t shift = TIMER_WHEEL_LEVEL0_BITS;
+        size_t level = 1;
+        while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << (shift + TIMER_WHEEL_LEVEL_BITS))) {
+            shift += TIMER_WHEEL_LEVEL_BITS;
+            level++;
+        }
+        uint32_t limit = (1u << (shift + TIMER_WHEEL_LEVEL_BITS)) - 1;
+        if (delta > limit) {
+            timer.expires = _current + limit;
+        }
+        bucket = kLevel0Size + (level - 1) * kLevelSize + ((timer.expires >> shift) & kLevelMask);
+    }
+
+    timer.bucket = bucket;
+    timer.prev = kNone;
+    timer.next = _heads[bucket];
+    if (timer.next != kNone) {
+        _timers[timer.next].prev = id;
+    }
+    _heads[bucket] = id;
+    _pending++;
+}
+
+/**
+ * @name unlink
+ * @brief Gỡ timer khỏi ô đang chứa nó
+ * 
+ * @param {uint16_t} id - ID của timer
+ * 
+ * @return None
+ */
+void TimerWheel::unlink(uint16_t id) {
+    Timer &timer = _timers[id];
+    if (timer.prev != kNone) {
+        _timers[timer.prev].next = timer.next;
+    } else {
+        _heads[timer.bucket] = timer.next;
+    }
+    if (timer.next != kNone) {
+        _timers[timer.next].prev = timer.prev;
+    }
+    timer.bucket = kNone;
+    _pending--;
+}
+
+/**
+ * @name cascade
+ * @brief Khi một tầng quay hết vòng, chuyển các timer của ô kế tiếp ở tầng trên xuống
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void TimerWheel::cascade() {
+    uint32_t shift = TIMER_WHEEL_LEVEL0_BITS;
+    for (size_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if ((_current & ((1u << shift) - 1)) != 0) {
+            break;
+        }
+        uint16_t bucket = kLevel0Size + (level - 1) * kLevelSize + ((_current >> shift) & kLevelMask);
+        uint16_t id = _heads[bucket];
+        _heads[bucket] = kNone;
+        while (id != kNone) {
+            uint16_t next = _timers[id].next;
+            _pending--;
+            insert(id);
+            id = next;
+        }
+        shift += TIMER_WHEEL_LEVEL_BITS;
+    }
+}
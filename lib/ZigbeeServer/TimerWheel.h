@@ -0,0 +1,89 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMER_WHEEL_LEVEL0_BITS 8 // 256 ô, mỗi ô một tick
+#define TIMER_WHEEL_LEVEL_BITS 6  // Các tầng trên 64 ô, mỗi ô bằng cả vòng của tầng dưới
+#define TIMER_WHEEL_LEVELS 3
+
+/**
+ * Bánh xe hẹn giờ phân tầng cho tối đa capacity timer, mỗi timer có ID cố định
+ * (vd. chỉ số thiết bị trong DeviceRegistry). Đặt, hủy và đặt lại timer đều O(1):
+ * mỗi ô là danh sách liên kết đôi nằm trong mảng, không cấp phát khi chạy.
+ *
+ * Với tick 100 ms, tầng 0 phủ 25,6 s, tầng 1 phủ 27 phút, tầng 2 phủ 29 giờ;
+ * timer xa hơn bị giới hạn về mức tối đa. Timer ở tầng trên được chuyển xuống
+ * dần khi tầng dưới quay hết vòng, nên mỗi tick chỉ xử lý một ô.
+ *
+ * Chỉ dùng từ một task.
+ */
+class TimerWheel
+{
+public:
+    static const uint16_t kNone = 0xffff;
+
+    TimerWheel(size_t capacity, uint32_t tickMs);
+    ~TimerWheel();
+
+    // Đặt (hoặc đặt lại) timer hết hạn sau delayMs, tối thiểu một tick
+    void schedule(uint16_t id, uint32_t delayMs);
+    void cancel(uint16_t id);
+    bool scheduled(uint16_t id) const { return id < _capacity && _timers[id].bucket != kNone; }
+    size_t pending() const { return _pending; }
+
+    // Thời gian (ms) tới tick kế tiếp nếu còn timer, UINT32_MAX nếu không có timer nào
+    uint32_t nextWakeMs(unsigned long now) const;
+
+    /**
+     * Quay bánh xe tới thời điểm now và gọi fn(id) cho mỗi timer hết hạn.
+     * fn có thể đặt lại chính timer đó hoặc timer khác.
+     */
+    template <typename Fn>
+    void advance(unsigned long now, Fn fn) {
+        while (now - _lastTickAt >= _tickMs) {
+            _lastTickAt += _tickMs;
+            _current++;
+            cascade();
+            uint16_t bucket = _current & kLevel0Mask;
+            uint16_t id;
+            while ((id = _heads[bucket]) != kNone) {
+                unlink(id);
+                fn(id);
+            }
+        }
+    }
+
+private:
+    TimerWheel(const TimerWheel &);
+    TimerWheel &operator=(const TimerWheel &);
+
+    static const uint32_t kLevel0Size = 1u << TIMER_WHEEL_LEVEL0_BITS;
+    static const uint32_t kLevelSize = 1u << TIMER_WHEEL_LEVEL_BITS;
+    static const uint32_t kLevel0Mask = kLevel0Size - 1;
+    static const uint32_t kLevelMask = kLevelSize - 1;
+    static const size_t kBuckets = kLevel0Size + kLevelSize * (TIMER_WHEEL_LEVELS - 1);
+
+    struct Timer {
+        uint32_t expires; // Tick hết hạn
+        uint16_t next;
+        uint16_t prev;
+        uint16_t bucket;  // kNone nếu không được đặt
+    };
+
+    void insert(uint16_t id);
+    void unlink(uint16_t id);
+    void cascade();
+
+    Timer *_timers;
+    uint16_t _heads[kBuckets];
+    size_t _capacity;
+    size_t _pending;
+    uint32_t _tickMs;
+    uint32_t _current;        // Tick hiện tại
+    unsigned long _lastTickAt; // millis() của tick hiện tại
+    bool _started;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,88 @@
+#include "ZigbeeRouter.h"
+
+/**
+ * @name add
+ * @brief Thêm một radio (chỉ gọi khi khởi tạo)
+ * 
+ * @param {ZigbeeServer&} server - Radio
+ * 
+ * @return bool - False nếu đã đủ ZIGBEE_ROUTER_MAX_SERVERS radio
+ */
+bool ZigbeeRouter::add(ZigbeeServer &server) {
+    if (_count >= ZIGBEE_ROUTER_MAX_SERVERS) {
+        return false;
+    }
+    _servers[_count++] = &server;
+    return true;
+}
+
+/**
+ * @name owner
+ * @brief Tìm radio quản lý thiết bị
+ * 
+ * @param {const char*} deviceId - ID của thiết bị
+ * 
+ * @return ZigbeeServer* - Radio nhận khung tin gần nhất từ thiết bị, nullptr nếu không có
+ */
+ZigbeeServer *ZigbeeRouter::owner(const char *deviceId) const {
+    ZigbeeServer *best = nullptr;
+    uint32_t bestAge = 0;
+    uint32_t now = millis();
+    for (size_t i = 0; i < _count; i++) {
+        const DeviceRegistry &devices = _servers[i]->devices();
+        int index = devices.find(deviceId);
+        if (index == DeviceRegistry::kNotFound) {
+            continue;
+        }
+        uint32_t age = now - devices.at(index).lastSeen;
+        if (best == nullptr || age < bestAge) {
+            best = _servers[i];
+            bestAge = age;
+        }
+    }
+    return best;
+}
+
+/**
+ * @name sendCommand
+ * @brief Gửi lệnh tới radio quản lý thiết bị
+ * 
+ * @param {const char*} deviceId - ID của thiết bị
+ * @param {const char*} cmd - Lệnh
+ * @param {uint8_t} priority - Độ ưu tiên (CommandPriority)
+ * @param {ZigbeeServer**} owner - Nếu khác nullptr, nhận radio đã nhận lệnh (để chờ ACK)
+ * 
+ * @return CommandHandle - Handle của lệnh trên radio đó, 0 nếu thất bại
+ */
+CommandHandle ZigbeeRouter::sendCommand(const char *deviceId, const char *cmd, uint8_t priority, ZigbeeServer **owner) {
+    ZigbeeServer *server = this->owner(deviceId);
+    if (owner != nullptr) {
+        *owner = server;
+    }
+    if (server == nullptr) {
+        return 0;
+    }
+    return server->sendCommand(deviceId, cmd, priority);
+}
+
+/**
+ * @name broadcastMessage
+ * @brief Gửi lệnh tìm thiết bị trên mọi radio
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void ZigbeeRouter::broadcastMessage() {
+    for (size_t i = 0; i < _count; i++) {
+        _servers[i]->broadcastMessage();
+    }
+}
+
+size_t ZigbeeRouter::deviceCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < _count; i++) {
+        count += _servers[i]->devices().size();
+    }
+    return count;
+}
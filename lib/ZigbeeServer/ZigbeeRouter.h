@@ -0,0 +1,48 @@
+#ifndef ZIGBEEROUTER_H
+#define ZIGBEEROUTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ZigbeeServer.h"
+
+#ifndef ZIGBEE_ROUTER_MAX_SERVERS
+#define ZIGBEE_ROUTER_MAX_SERVERS 4
+#endif
+
+/**
+ * Gom nhiều ZigbeeServer (mỗi radio điều phối một UART) thành một gateway.
+ * Lệnh được gửi tới radio đang quản lý thiết bị; nếu thiết bị xuất hiện ở
+ * nhiều radio (vd. chuyển mạng), radio nhận khung tin gần nhất được chọn.
+ *
+ * Chỉ thêm radio khi khởi tạo; các hàm còn lại gọi được từ mọi task.
+ */
+class ZigbeeRouter
+{
+public:
+    ZigbeeRouter() : _count(0) {}
+
+    bool add(ZigbeeServer &server);
+    size_t size() const { return _count; }
+    ZigbeeServer &at(size_t index) { return *_servers[index]; }
+
+    ZigbeeServer *owner(const char *deviceId) const;
+    // Trả về 0 nếu không radio nào biết thiết bị hoặc hàng đợi lệnh đầy
+    CommandHandle sendCommand(const char *deviceId, const char *cmd, uint8_t priority = CMD_PRIORITY_NORMAL,
+                              ZigbeeServer **owner = nullptr);
+    void broadcastMessage();
+
+    size_t deviceCount() const;
+
+    template <typename Fn>
+    void forEachDevice(Fn fn) const {
+        for (size_t i = 0; i < _count; i++) {
+            _servers[i]->devices().forEach(fn);
+        }
+    }
+
+private:
+    ZigbeeServer *_servers[ZIGBEE_ROUTER_MAX_SERVERS];
+    size_t _count;
+};
+
+#endif // ZIGBEEROUTER_H
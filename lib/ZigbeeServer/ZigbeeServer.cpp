@@ -1,22 +1,47 @@
 #include "ZigbeeServer.h"
 #include <algorithm> // Thêm dòng này để sử dụng std::find_if
+#include <strings.h>
+#include "Telemetry.h"
+#include <esp_timer.h>
 
-ZigbeeServer* ZigbeeServer::_instance = nullptr;
+ZigbeeServer::ZigbeeServer()
+    : ZigbeeServer(Serial1, 16, 17) // Thay đổi RX_PIN và TX_PIN theo cấu hình của bạn
+{
+}
 
-ZigbeeServer::ZigbeeServer() : _zigbeeSerial(&Serial1)
+ZigbeeServer::ZigbeeServer(HardwareSerial &serial, int8_t rxPin, int8_t txPin)
+    : _defaultLink(new HardwareSerialLink(serial, rxPin, txPin)), _link(_defaultLink), _baudRate(ZIGBEE_DEFAULT_BAUD), _task(NULL),
+      _binaryFraming(false), _frameTimeUs(0), _pollTimers(_devices.capacity(), ZIGBEE_POLL_TICK_MS),
+      _polls(new PollState[_devices.capacity()]()), _pollIntervalMs(ZIGBEE_POLL_INTERVAL_MS),
+      _membershipChanges(_devices.capacity())
 {
 }
 
+ZigbeeServer::ZigbeeServer(SerialLink &link)
+    : _defaultLink(nullptr), _link(&link), _baudRate(ZIGBEE_DEFAULT_BAUD), _task(NULL), _binaryFraming(false), _frameTimeUs(0),
+      _pollTimers(_devices.capacity(), ZIGBEE_POLL_TICK_MS), _polls(new PollState[_devices.capacity()]()),
+      _pollIntervalMs(ZIGBEE_POLL_INTERVAL_MS), _membershipChanges(_devices.capacity())
+{
+}
+
+ZigbeeServer::~ZigbeeServer() {
+    delete[] _polls;
+    delete _defaultLink;
+}
+
 /**
  * @name begin
  * @brief Khởi tạo ZigbeeServer
  * 
- * @param None
+ * @param {uint32_t} baudRate - Tốc độ UART tới module Zigbee
+ * @param {BaseType_t} core - Core chạy task nhận dữ liệu
  * 
  * @return None
  */
-void ZigbeeServer::begin() {
+void ZigbeeServer::begin(uint32_t baudRate, BaseType_t core) {
     ESP_LOGI("ZigbeeServer", "Starting...");
+    _baudRate = baudRate;
+    _commands.setBaudRate(baudRate);
     initZigbee();
     broadcastMessage();
     xTaskCreatePinnedToCore(
@@ -25,17 +50,31 @@ void ZigbeeServer::begin() {
             ZigbeeServer *zigbeeServer = static_cast<ZigbeeServer *>(pvParameters);
             for (;;)
             {
+                // Ngủ cho đến khi UART báo có dữ liệu hoặc có lệnh cần gửi
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(zigbeeServer->idleWaitMs()));
                 zigbeeServer->loop();
-                vTaskDelay(10 / portTICK_PERIOD_MS); // Giảm tần suất kiểm tra
             }
         },
         "ZigbeeServerTask",
         10000,
         this,
         1,
-        NULL,
-        0 // Chạy trên core 0
-    );
+        &_task,
+        core);
+}
+
+/**
+ * @name wake
+ * @brief Đánh thức task ZigbeeServer
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void ZigbeeServer::wake() {
+    if (_task != NULL) {
+        xTaskNotifyGive(_task);
+    }
 }
 
 /**
@@ -48,22 +87,69 @@ void ZigbeeServer::begin() {
  * @return None
  */
 void ZigbeeServer::loop() {
-    static std::string incomingMessage; // Thêm static để lưu trữ tạm thời dữ liệu nhận được
-    while (_zigbeeSerial->available()) {
-        char c = _zigbeeSerial->read();
-        incomingMessage += c;
-        if (c == '\n') {
-            if (!incomingMessage.empty()) {
-                handleIncomingMessage(incomingMessage);
-                ESP_LOGI("ZigbeeServer", "Received: %s", incomingMessage.c_str());
-                incomingMessage.clear();
-            }
+    uint8_t chunk[ZIGBEE_RX_CHUNK_SIZE];
+    size_t received;
+    while ((received = _link->read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < received; i++) {
+            handleByte(static_cast<char>(chunk[i]));
         }
     }
-    while (!messageQueue.empty()) {
-        std::string command = messageQueue.front();
-        messageQueue.pop();
-        _zigbeeSerial->println(command.c_str());
+
+    unsigned long now = millis();
+    // Chỉ các thiết bị đến hạn kiểm tra được xử lý, không duyệt cả danh sách
+    _pollTimers.advance(now, [this](uint16_t index) { pollDevice(index); });
+    _commands.poll(now);
+    CommandScheduler::Transmission transmission;
+    while (_commands.next(now, transmission)) {
+        _link->write(transmission.data, transmission.length);
+    }
+}
+
+/**
+ * @name idleWaitMs
+ * @brief Thời gian task có thể ngủ khi không có dữ liệu đến
+ * 
+ * @param None
+ * 
+ * @return uint32_t - Số ms
+ */
+uint32_t ZigbeeServer::idleWaitMs() {
+    unsigned long now = millis();
+    return std::min<uint32_t>(std::min<uint32_t>(ZIGBEE_IDLE_WAKE_MS, _commands.nextWakeMs(now)), _pollTimers.nextWakeMs(now));
+}
+
+/**
+ * @name handleByte
+ * @brief Đưa một byte vào bộ phân tích khung và xử lý khung hoàn chỉnh
+ * 
+ * @param {char} c - Byte nhận được
+ * 
+ * @return None
+ */
+void ZigbeeServer::handleByte(char c) {
+    FrameParser::Result result = _parser.push(c);
+    if (result == FrameParser::FRAME_READY || result == FrameParser::FRAME_BINARY) {
+        _frameTimeUs = esp_timer_get_time();
+    }
+    switch (result) {
+    case FrameParser::FRAME_READY:
+        ESP_LOGI("ZigbeeServer", "Received: ID:%s,DATA:%s", _parser.frame().id.data, _parser.frame().data.data);
+        handleIncomingMessage(_parser.frame());
+        break;
+    case FrameParser::FRAME_BINARY:
+        handleBinaryMessage(_parser.binaryPayload(), _parser.binaryLength());
+        break;
+    case FrameParser::FRAME_OTHER:
+        handleControlMessage(_parser.line());
+        break;
+    case FrameParser::FRAME_TRUNCATED:
+        ESP_LOGE("ZigbeeServer", "Invalid message: %s", _parser.line());
+        break;
+    case FrameParser::FRAME_OVERLONG:
+        ESP_LOGE("ZigbeeServer", "Line or binary frame too long, dropped");
+        break;
+    default:
+        break;
     }
 }
 
@@ -76,9 +162,15 @@ void ZigbeeServer::loop() {
  * @return None
  */
 void ZigbeeServer::addDevice(const char *id) {
-    Device device;
-    device.id = id;
-    deviceList.push_back(device);
+    int index = _devices.add(id);
+    if (index == DeviceRegistry::kNotFound) {
+        ESP_LOGE("ZigbeeServer", "Cannot add device %s", id);
+        return;
+    }
+    if (!_pollTimers.scheduled(index)) {
+        // Thiết bị chưa từng gửi khung tin: kiểm tra sớm, rải đều trong một chu kỳ
+        _pollTimers.schedule(index, esp_random() % (_pollIntervalMs + 1));
+    }
 }
 
 /**
@@ -106,30 +198,70 @@ void ZigbeeServer::onChange(std::function<void()> callback) {
 }
 
 /**
- * @name getInstance
- * @brief Lấy đối tượng ZigbeeServer
+ * @name onReading
+ * @brief Đăng ký hàm callback cho từng giá trị đo trong khung nhị phân
  * 
- * @param None
+ * @param {std::function<void(const char *id, const char *key, double value)>} callback - Hàm callback
  * 
- * @return ZigbeeServer* - Đối tượng ZigbeeServer
+ * @return None
+ */
+void ZigbeeServer::onReading(std::function<void(const char *id, const char *key, double value)> callback) {
+    readingCallback = callback;
+}
+
+/**
+ * @name onStatus
+ * @brief Đăng ký hàm callback khi thiết bị chuyển trạng thái online/stale/offline
+ * 
+ * @param {std::function<void(const char *id, DeviceStatus status)>} callback - Hàm callback
+ * 
+ * @return None
+ */
+void ZigbeeServer::onStatus(std::function<void(const char *id, DeviceStatus status)> callback) {
+    statusCallback = callback;
+}
+
+/**
+ * @name setPollInterval
+ * @brief Đặt chu kỳ kiểm tra mặc định, áp dụng từ lần đặt lịch kế tiếp của mỗi thiết bị
+ * 
+ * @param {uint32_t} intervalMs - Thiết bị im lặng lâu hơn thời gian này sẽ được kiểm tra
+ * 
+ * @return None
  */
-ZigbeeServer* ZigbeeServer::getInstance() {
-    if (_instance == nullptr) {
-        _instance = new ZigbeeServer();
+void ZigbeeServer::setPollInterval(uint32_t intervalMs) {
+    _pollIntervalMs = intervalMs > ZIGBEE_POLL_TICK_MS ? intervalMs : ZIGBEE_POLL_TICK_MS;
+}
+
+/**
+ * @name setPollInterval
+ * @brief Đặt chu kỳ kiểm tra riêng cho một thiết bị
+ * 
+ * @param {const char *} id - ID của thiết bị
+ * @param {uint32_t} intervalMs - Chu kỳ (ms, làm tròn theo giây), 0 để dùng chu kỳ mặc định
+ * 
+ * @return bool - False nếu không có thiết bị
+ */
+bool ZigbeeServer::setPollInterval(const char *id, uint32_t intervalMs) {
+    int index = _devices.find(id);
+    if (index == DeviceRegistry::kNotFound) {
+        return false;
     }
-    return _instance;
+    uint32_t seconds = (intervalMs + 999) / 1000;
+    _polls[index].intervalS = seconds < 0xffff ? seconds : 0xffff;
+    return true;
 }
 
 /**
  * @name checkDevice
- * @brief Gửi lệnh kiểm tra thiết bị
+ * @brief Gửi lệnh kiểm tra thiết bị, mọi khung tin trả lời đều được coi là ACK
  * 
  * @param {const char *} id - ID của thiết bị
  * 
- * @return None
+ * @return CommandHandle - Handle của lệnh, 0 nếu hàng đợi đầy
  */
-void ZigbeeServer::checkDevice(const char *id) {
-    sendCommand(id, "CHECK");
+CommandHandle ZigbeeServer::checkDevice(const char *id) {
+    return queueCommand(id, nullptr, "CHECK", CMD_PRIORITY_LOW, true);
 }
 
 /**
@@ -138,12 +270,12 @@ void ZigbeeServer::checkDevice(const char *id) {
  * 
  * @param {const char *} id - ID của thiết bị
  * @param {const char *} cmd - Lệnh cần gửi
+ * @param {uint8_t} priority - Độ ưu tiên (CommandPriority)
  * 
- * @return None
+ * @return CommandHandle - Handle của lệnh, 0 nếu hàng đợi đầy
  */
-void ZigbeeServer::sendCommand(const char *id, const char *cmd) {
-    std::string message = std::string("ID:") + id + ",CMD:" + cmd;
-    messageQueue.push(message);
+CommandHandle ZigbeeServer::sendCommand(const char *id, const char *cmd, uint8_t priority) {
+    return queueCommand(id, nullptr, cmd, priority, false);
 }
 
 /**
@@ -153,12 +285,83 @@ void ZigbeeServer::sendCommand(const char *id, const char *cmd) {
  * @param {const char *} id - ID của thiết bị
  * @param {const char *} secrect_key - Khóa bí mật
  * @param {const char *} cmd - Lệnh cần gửi
+ * @param {uint8_t} priority - Độ ưu tiên (CommandPriority)
  * 
- * @return None
+ * @return CommandHandle - Handle của lệnh, 0 nếu hàng đợi đầy
  */
-void ZigbeeServer::sendCommand(const char *id, const char *secrect_key, const char *cmd) {
-    std::string message = std::string("ID:") + id +",SECRECT_KEY:"+ secrect_key +",CMD:" + cmd;
-    messageQueue.push(message);
+CommandHandle ZigbeeServer::sendCommand(const char *id, const char *secrect_key, const char *cmd, uint8_t priority) {
+    return queueCommand(id, secrect_key, cmd, priority, false);
+}
+
+/**
+ * @name waitCommand
+ * @brief Chờ lệnh được thiết bị ACK hoặc thất bại sau khi hết số lần gửi lại
+ * 
+ * @param {CommandHandle} handle - Handle của lệnh
+ * @param {uint32_t} timeoutMs - Thời gian chờ tối đa (ms)
+ * 
+ * @return CommandStatus - Kết quả
+ */
+CommandStatus ZigbeeServer::waitCommand(CommandHandle handle, uint32_t timeoutMs) {
+    return _commands.wait(handle, timeoutMs);
+}
+
+/**
+ * @name commandStatus
+ * @brief Trạng thái hiện tại của lệnh
+ * 
+ * @param {CommandHandle} handle - Handle của lệnh
+ * 
+ * @return CommandStatus - Trạng thái
+ */
+CommandStatus ZigbeeServer::commandStatus(CommandHandle handle) {
+    return _commands.status(handle);
+}
+
+/**
+ * @name queueCommand
+ * @brief Đóng khung lệnh theo định dạng thiết bị hỗ trợ và đưa vào hàng đợi gửi
+ * 
+ * @param {const char *} id - ID của thiết bị
+ * @param {const char *} secrect_key - Khóa bí mật, nullptr nếu không dùng
+ * @param {const char *} cmd - Lệnh cần gửi
+ * @param {uint8_t} priority - Độ ưu tiên
+ * @param {bool} anyReply - Coi mọi khung tin từ thiết bị là ACK
+ * 
+ * @return CommandHandle - Handle của lệnh, 0 nếu lệnh quá dài hoặc hàng đợi đầy
+ */
+CommandHandle ZigbeeServer::queueCommand(const char *id, const char *secrect_key, const char *cmd, uint8_t priority, bool anyReply) {
+    uint8_t wire[ZIGBEE_COMMAND_MAX_SIZE];
+    size_t length = 0;
+
+    int index = _devices.find(id);
+    if (index != DeviceRegistry::kNotFound && _devices.at(index).wireFormat == WIRE_BINARY) {
+        uint8_t payload[ZIGBEE_COMMAND_MAX_SIZE];
+        BinaryFrame::Writer writer(payload, sizeof(payload), BinaryFrame::TYPE_COMMAND);
+        writer.addString(BinaryFrame::TAG_DEVICE_ID, id);
+        if (secrect_key != nullptr) {
+            writer.addString(BinaryFrame::TAG_SECRET_KEY, secrect_key);
+        }
+        writer.addString(BinaryFrame::TAG_COMMAND, cmd);
+        length = writer.finish(wire, sizeof(wire));
+    } else {
+        int written = secrect_key != nullptr
+            ? snprintf(reinterpret_cast<char *>(wire), sizeof(wire), "ID:%s,SECRECT_KEY:%s,CMD:%s\r\n", id, secrect_key, cmd)
+            : snprintf(reinterpret_cast<char *>(wire), sizeof(wire), "ID:%s,CMD:%s\r\n", id, cmd);
+        length = written > 0 && static_cast<size_t>(written) < sizeof(wire) ? written : 0;
+    }
+
+    if (length == 0) {
+        ESP_LOGE("ZigbeeServer", "Command too long for %s", id);
+        return 0;
+    }
+    CommandHandle handle = _commands.submit(id, wire, length, priority, anyReply);
+    if (handle == 0) {
+        ESP_LOGE("ZigbeeServer", "Command queue full, dropped command for %s", id);
+        return 0;
+    }
+    wake();
+    return handle;
 }
 
 /**
@@ -170,7 +373,23 @@ void ZigbeeServer::sendCommand(const char *id, const char *secrect_key, const ch
  * @return None
  */
 void ZigbeeServer::broadcastMessage() {
-    _zigbeeSerial->println("CMD:BRD:DISC");
+    // Thiết bị hỗ trợ khung nhị phân sẽ trả lời bằng khung nhị phân,
+    // thiết bị cũ vẫn dùng khung ASCII
+    const char *message = _binaryFraming ? "CMD:BRD:DISC,CAP:BIN\r\n" : "CMD:BRD:DISC\r\n";
+    _link->write(reinterpret_cast<const uint8_t *>(message), strlen(message));
+}
+
+/**
+ * @name setBinaryFraming
+ * @brief Bật/tắt quảng bá khả năng nhận khung nhị phân trong lệnh discovery.
+ *        Khung nhị phân đến luôn được nhận, kể cả khi tắt
+ * 
+ * @param {bool} enabled - True để quảng bá "CAP:BIN"
+ * 
+ * @return None
+ */
+void ZigbeeServer::setBinaryFraming(bool enabled) {
+    _binaryFraming = enabled;
 }
 
 /**
@@ -182,7 +401,8 @@ void ZigbeeServer::broadcastMessage() {
  * @return None
  */
 void ZigbeeServer::initZigbee() {
-    _zigbeeSerial->begin(9600, SERIAL_8N1, 16, 17); // Thay đổi RX_PIN và TX_PIN theo cấu hình của bạn
+    _link->begin(_baudRate);
+    _link->onReceive([this]() { wake(); });
     // _zigbeeSerial->println("AT+ZSET:ROLE=COORD");
     // delay(1000);
     // _zigbeeSerial->println("AT+PANID=1234");
@@ -193,107 +413,321 @@ void ZigbeeServer::initZigbee() {
 }
 
 /**
- * @name calculateCRC32
- * @brief Tính toán CRC32
+ * @name checkCRC32
+ * @brief Kiểm tra CRC32 với giá trị đã tính dần khi nhận từng byte
  * 
- * @param {const char*} data - Dữ liệu cần tính toán
- * @param {size_t} length - Độ dài dữ liệu
+ * @param {const Frame&} frame - Khung tin đã tách trường
  * 
- * @return uint32_t - CRC32
+ * @return bool - True nếu CRC32 hợp lệ, False nếu ngược lại
  */
-uint32_t calculateCRC32(const char* data, size_t length) {
-    uint32_t crc = 0xffffffff;
-    while (length--) {
-        uint8_t c = *data++;
-        for (uint32_t i = 0x80; i > 0; i >>= 1) {
-            bool bit = crc & 0x80000000;
-            if (c & i) {
-                bit = !bit;
-            }
-            crc <<= 1;
-            if (bit) {
-                crc ^= 0x04c11db7;
-            }
+static bool checkCRC32(const Frame& frame) {
+    return Crc32::matchesHex(frame.crc.data, frame.crc.length, Crc32::finalize(frame.crcState));
+}
+
+/**
+ * @name handleIncomingMessage
+ * @brief Xử lý khung dữ liệu nhận được
+ * 
+ * @param {const Frame&} frame - Khung tin, các trường trỏ thẳng vào bộ đệm nhận
+ * 
+ * @return None
+ */
+void ZigbeeServer::handleIncomingMessage(const Frame& frame) {
+    const char *id = frame.id.data;
+    const char *data = frame.data.data;
+
+    if (!checkCRC32(frame)) {
+        ESP_LOGE("ZigbeeServer", "Invalid CRC");
+        Telemetry::count(TELEMETRY_CRC_ERRORS);
+        int index = _devices.find(id);
+        if (index != DeviceRegistry::kNotFound) {
+            _devices.at(index).crcErrors++;
         }
+        return;
+    }
+
+    bool isNew = false;
+    Device *device = touchDevice(id, WIRE_ASCII, isNew);
+    if (device == nullptr) {
+        return;
+    }
+    // "ACK" hoặc "ACK:<...>" trả lời lệnh đang chờ, không phải dữ liệu đo
+    bool isAck = strncmp(data, "ACK", 3) == 0 && (data[3] == '\0' || data[3] == ':');
+    _commands.acknowledge(id, isAck);
+    // Khung tin đầu tiên của thiết bị mới cũng là dữ liệu đo
+    if (isAck) {
+        return;
+    }
+    updateLinkQuality(*device, frame.data);
+    if (messageCallback) {
+        messageCallback(id, data);
     }
-    return ~crc;
 }
 
 /**
- * @name checkCRC32
- * @brief Kiểm tra CRC32
+ * @name handleBinaryMessage
+ * @brief Xử lý khung nhị phân đã giải mã COBS
  * 
- * @param {const std::string&} data_with_crc - Dữ liệu cần kiểm tra
+ * @param {const uint8_t*} payload - Payload gồm type, các TLV và CRC32
+ * @param {size_t} length - Độ dài payload
  * 
- * @return bool - True nếu CRC32 hợp lệ, False nếu ngược lại
+ * @return None
  */
-bool checkCRC32(const std::string& data_with_crc) {
-    size_t pos = data_with_crc.rfind(",CRC:");
-    if (pos == std::string::npos) {
-        return false;
+void ZigbeeServer::handleBinaryMessage(const uint8_t *payload, size_t length) {
+    BinaryFrame::Reader reader(payload, length);
+    if (!reader.valid()) {
+        ESP_LOGE("ZigbeeServer", "Invalid binary frame CRC");
+        Telemetry::count(TELEMETRY_CRC_ERRORS);
+        return;
+    }
+    if (reader.type() != BinaryFrame::TYPE_DATA) {
+        return;
     }
 
-    std::string data = data_with_crc.substr(0, pos);
-    std::string received_crc = data_with_crc.substr(pos + 5);
+    uint8_t tag;
+    const uint8_t *value;
+    uint8_t valueLength;
+    if (!reader.next(tag, value, valueLength) || tag != BinaryFrame::TAG_DEVICE_ID ||
+        valueLength == 0 || valueLength >= DEVICE_ID_SIZE) {
+        ESP_LOGE("ZigbeeServer", "Binary frame without device ID");
+        return;
+    }
+    char id[DEVICE_ID_SIZE];
+    memcpy(id, value, valueLength);
+    id[valueLength] = '\0';
 
-    uint32_t calculated_crc = calculateCRC32(data.c_str(), data.length());
-    
-    char crcString[9];
-    snprintf(crcString, sizeof(crcString), "%08X", calculated_crc);
-    
-//     ESP_LOGI("ZigbeeServer", "Full input: %s", data_with_crc.c_str());
-// ESP_LOGI("ZigbeeServer", "Data part: %s", data.c_str());
-// ESP_LOGI("ZigbeeServer", "CRC part: %s", received_crc.c_str());
+    bool isNew = false;
+    Device *device = touchDevice(id, WIRE_BINARY, isNew);
+    if (device == nullptr) {
+        return;
+    }
+    // TLV ACK đứng ngay sau ID nếu khung tin là trả lời lệnh
+    BinaryFrame::Reader ackProbe = reader;
+    bool isAck = ackProbe.next(tag, value, valueLength) && tag == BinaryFrame::TAG_ACK;
+    _commands.acknowledge(id, isAck);
+    if (isAck) {
+        return;
+    }
 
-// ESP_LOGI("ZigbeeServer", "Calculated CRC length: %d", strlen(crcString));
-// ESP_LOGI("ZigbeeServer", "Received CRC length: %d", received_crc.length());
+    while (reader.next(tag, value, valueLength)) {
+        const char *key;
+        uint8_t keyLength;
+        float reading;
+        if (tag != BinaryFrame::TAG_READING ||
+            !BinaryFrame::Reader::parseReading(value, valueLength, key, keyLength, reading)) {
+            continue;
+        }
+        char keyBuffer[32];
+        if (keyLength >= sizeof(keyBuffer)) {
+            continue;
+        }
+        memcpy(keyBuffer, key, keyLength);
+        keyBuffer[keyLength] = '\0';
+        if (strcasecmp(keyBuffer, "rssi") == 0) {
+            device->rssi = static_cast<int8_t>(reading);
+        } else if (strcasecmp(keyBuffer, "lqi") == 0) {
+            device->lqi = static_cast<uint8_t>(reading);
+        }
+        if (readingCallback) {
+            readingCallback(id, keyBuffer, reading);
+        }
+    }
+}
+
+/**
+ * @name touchDevice
+ * @brief Cập nhật trạng thái thiết bị khi nhận khung tin hợp lệ, thêm mới nếu chưa có
+ * 
+ * @param {const char*} id - ID của thiết bị
+ * @param {uint8_t} wireFormat - Định dạng khung vừa nhận (WireFormat)
+ * @param {bool&} isNew - True nếu thiết bị vừa được thêm
+ * 
+ * @return Device* - Thiết bị, nullptr nếu không thể thêm
+ */
+Device *ZigbeeServer::touchDevice(const char *id, uint8_t wireFormat, bool &isNew) {
+    int index = _devices.find(id);
+    isNew = index == DeviceRegistry::kNotFound;
+    if (isNew) {
+        Telemetry::count(TELEMETRY_UNKNOWN_DEVICE);
+        // Nếu không, thêm mới vào danh sách thiết bị
+        index = _devices.add(id);
+        if (index == DeviceRegistry::kNotFound) {
+            ESP_LOGE("ZigbeeServer", "Cannot add device %s", id);
+            return nullptr;
+        }
+    }
+
+    Telemetry::count(TELEMETRY_FRAMES_RX);
+    Device &device = _devices.at(index);
+    device.lastSeen = millis();
+    device.frames++;
+    device.wireFormat = wireFormat;
+    markSeen(index);
 
-received_crc = received_crc.substr(0, 8);
-    return std::string(crcString) == std::string(received_crc);
+    if (isNew && onChangeCallback) {
+        onChangeCallback();
+    }
+    return &device;
 }
 
 /**
- * @name handleIncomingMessage
- * @brief Xử lý dữ liệu nhận được
+ * @name markSeen
+ * @brief Thiết bị vừa gửi khung tin: đánh dấu online và dời lần kiểm tra kế tiếp
  * 
- * @param {const std::string&} message - Dữ liệu nhận được
+ * @param {size_t} index - Chỉ số thiết bị
  * 
  * @return None
  */
-void ZigbeeServer::handleIncomingMessage(const std::string& message) {
-    if (!checkCRC32(message)) {
-        ESP_LOGE("ZigbeeServer", "Invalid CRC");
-        return;
+void ZigbeeServer::markSeen(size_t index) {
+    PollState &poll = _polls[index];
+    poll.missed = 0;
+    setStatus(index, DEVICE_ONLINE);
+    uint32_t interval = poll.intervalS > 0 ? poll.intervalS * 1000u : _pollIntervalMs;
+    _pollTimers.schedule(index, withJitter(interval));
+}
+
+/**
+ * @name pollDevice
+ * @brief Thiết bị im lặng quá chu kỳ: cập nhật trạng thái theo số lần lỡ rồi gửi lệnh kiểm tra
+ * 
+ * @param {uint16_t} index - Chỉ số thiết bị
+ * 
+ * @return None
+ */
+void ZigbeeServer::pollDevice(uint16_t index) {
+    PollState &poll = _polls[index];
+    if (poll.missed >= ZIGBEE_OFFLINE_AFTER_MISSES) {
+        setStatus(index, DEVICE_OFFLINE);
+    } else if (poll.missed > 0) {
+        setStatus(index, DEVICE_STALE);
     }
 
-    size_t pos = message.find(",DATA:");
-    if (pos != std::string::npos) {
-        std::string id = message.substr(3, pos - 3); // Skip "ID:"
+    const Device &device = _devices.at(index);
+    // Hàng đợi lệnh đầy thì không tính là lỡ, thử lại ở lần sau
+    if (checkDevice(device.id) != 0 && poll.missed < 0xff) {
+        poll.missed++;
+    }
+    _pollTimers.schedule(index, withJitter(device.status == DEVICE_OFFLINE ? ZIGBEE_OFFLINE_POLL_MS : ZIGBEE_POLL_TIMEOUT_MS));
+}
 
-        std::string data = message.substr(pos + 6, message.find(",CRC:") - pos - 6); // Skip ",DATA:" và loại bỏ phần ",HASH:"
+/**
+ * @name setStatus
+ * @brief Đổi trạng thái thiết bị và gọi statusCallback nếu có thay đổi
+ * 
+ * @param {size_t} index - Chỉ số thiết bị
+ * @param {DeviceStatus} status - Trạng thái mới
+ * 
+ * @return None
+ */
+void ZigbeeServer::setStatus(size_t index, DeviceStatus status) {
+    Device &device = _devices.at(index);
+    if (device.status == status) {
+        return;
+    }
+    // Vào mạng: online từ bất kỳ trạng thái nào trừ stale; rời mạng: offline
+    bool membership = (status == DEVICE_ONLINE && device.status != DEVICE_STALE) || status == DEVICE_OFFLINE;
+    // Ghi trạng thái trước khi đánh dấu: mark() là release, drain() là acquire, nên
+    // task gửi MQTT đọc được trạng thái mới của mọi thiết bị nó lấy ra
+    __atomic_store_n(&device.status, static_cast<uint8_t>(status), __ATOMIC_RELEASE);
+    if (membership) {
+        _membershipChanges.mark(index, millis());
+    }
+    if (status == DEVICE_OFFLINE) {
+        Telemetry::count(TELEMETRY_DEVICES_OFFLINE);
+        ESP_LOGW("ZigbeeServer", "Device %s is offline", device.id);
+    }
+    if (statusCallback) {
+        statusCallback(device.id, status);
+    }
+}
 
-        // Kiểm tra xem id có tồn tại trong deviceList hay không
-        auto it = std::find_if(deviceList.begin(), deviceList.end(), [&id](const Device& device) {
-            return device.id == id;
-        });
+/**
+ * @name withJitter
+ * @brief Cộng thêm một khoảng ngẫu nhiên để các lệnh kiểm tra không gửi cùng lúc
+ * 
+ * @param {uint32_t} delayMs - Thời gian chờ (ms)
+ * 
+ * @return uint32_t - Thời gian chờ đã cộng tới ZIGBEE_POLL_JITTER_PERCENT
+ */
+uint32_t ZigbeeServer::withJitter(uint32_t delayMs) {
+    return delayMs + esp_random() % (delayMs / 100 * ZIGBEE_POLL_JITTER_PERCENT + 1);
+}
 
-        if (it == deviceList.end()) {
-            // Nếu không, thêm mới vào deviceList
-            addDevice(id.c_str());
-            if (onChangeCallback) {
-                onChangeCallback();
-            }
-        } else {
-            if (messageCallback) {
-                messageCallback(id.c_str(), data.c_str());
-            }
+/**
+ * @name updateLinkQuality
+ * @brief Cập nhật RSSI/LQI nếu thiết bị gửi kèm trong DATA (vd. "temp:25,rssi:-70,lqi:180")
+ * 
+ * @param {Device&} device - Thiết bị
+ * @param {const FieldView&} data - Trường DATA
+ * 
+ * @return None
+ */
+void ZigbeeServer::updateLinkQuality(Device &device, const FieldView &data) {
+    const char *end = data.data + data.length;
+    for (const char *item = data.data; item < end;) {
+        if (strncasecmp(item, "rssi:", 5) == 0) {
+            device.rssi = static_cast<int8_t>(atoi(item + 5));
+        } else if (strncasecmp(item, "lqi:", 4) == 0) {
+            device.lqi = static_cast<uint8_t>(atoi(item + 4));
+        }
+        const char *comma = static_cast<const char *>(memchr(item, ',', end - item));
+        if (comma == nullptr) {
+            break;
         }
+        item = comma + 1;
     }
-    else if (message.find("CMD:BRD:DISC") != std::string::npos) {
+}
+
+/**
+ * @name handleControlMessage
+ * @brief Xử lý các dòng điều khiển không phải khung dữ liệu
+ * 
+ * @param {const char*} line - Dòng nhận được
+ * 
+ * @return None
+ */
+void ZigbeeServer::handleControlMessage(const char *line) {
+    if (strstr(line, "CMD:BRD:DISC") != nullptr) {
         // Xử lý khi nhận được broadcast message
         
     }
     else {
-        ESP_LOGE("ZigbeeServer", "Invalid message: %s", message.c_str());
+        ESP_LOGE("ZigbeeServer", "Invalid message: %s", line);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @name overlongLines
+ * @brief Số dòng bị bỏ do vượt quá kích thước bộ đệm
+ * 
+ * @param None
+ * 
+ * @return uint32_t - Số dòng
+ */
+uint32_t ZigbeeServer::overlongLines() const {
+    return _parser.overlongLines();
+}
+
+/**
+ * @name truncatedLines
+ * @brief Số dòng bị thiếu trường ID, DATA hoặc CRC
+ * 
+ * @param None
+ * 
+ * @return uint32_t - Số dòng
+ */
+uint32_t ZigbeeServer::truncatedLines() const {
+    return _parser.truncatedLines();
+}
+
+/**
+ * @name binaryOverruns
+ * @brief Số khung nhị phân bị bỏ vì quá dài, sau đó bộ nhận quay lại chế độ ASCII
+ * 
+ * @param None
+ * 
+ * @return uint32_t - Số khung
+ */
+uint32_t ZigbeeServer::binaryOverruns() const {
+    return _parser.binaryOverruns();
+}
@@ -1,46 +1,114 @@
 #ifndef ZIGBEESERVER_H
 #define ZIGBEESERVER_H
 
-#include <vector>
 #include <string>
-#include <queue>
 #include <functional>
 #include "HardwareSerial.h"
 #include <algorithm>
-#include <sstream>
+#include "FrameParser.h"
+#include "DeviceRegistry.h"
+#include "SerialLink.h"
+#include "CommandScheduler.h"
+#include "TimerWheel.h"
+#include "DeviceChangeSet.h"
 // #include <iomanip>
 
-struct Device {
-    std::string id;
-    std::string status;
-};
+#ifndef ZIGBEE_DEFAULT_BAUD
+#define ZIGBEE_DEFAULT_BAUD 9600
+#endif
+
+#ifndef ZIGBEE_TASK_CORE
+#define ZIGBEE_TASK_CORE 0
+#endif
+
+#define ZIGBEE_RX_CHUNK_SIZE 64
+#define ZIGBEE_IDLE_WAKE_MS 100
+
+#ifndef ZIGBEE_POLL_INTERVAL_MS
+#define ZIGBEE_POLL_INTERVAL_MS 300000 // Kiểm tra thiết bị im lặng lâu hơn thời gian này
+#endif
+#define ZIGBEE_POLL_TICK_MS 100
+#define ZIGBEE_POLL_TIMEOUT_MS 15000    // Chờ trả lời lệnh kiểm tra trước khi tính là lỡ
+#define ZIGBEE_POLL_JITTER_PERCENT 20   // Cộng ngẫu nhiên tới 20% để các lệnh kiểm tra không dồn vào nhau
+#define ZIGBEE_OFFLINE_POLL_MS 900000   // Chu kỳ kiểm tra thiết bị đã offline
+#define ZIGBEE_OFFLINE_AFTER_MISSES 3
 
 class ZigbeeServer
 {
 public:
     ZigbeeServer();
-    void begin();
+    ZigbeeServer(HardwareSerial &serial, int8_t rxPin, int8_t txPin);
+    explicit ZigbeeServer(SerialLink &link);
+    ~ZigbeeServer();
+    // Mỗi instance có UART, task nhận dữ liệu và danh sách thiết bị riêng
+    void begin(uint32_t baudRate = ZIGBEE_DEFAULT_BAUD, BaseType_t core = ZIGBEE_TASK_CORE);
     void loop();
     void addDevice(const char *id);
     void onMessage(std::function<void(const char *id, const char *data)> callback);
     void onChange(std::function<void()> callback);
-    static ZigbeeServer* getInstance();
-    void checkDevice(const char *id);
-    void sendCommand(const char *id, const char *cmd);
-    void sendCommand(const char *id, const char *secrect_key, const char *cmd);
+    void onReading(std::function<void(const char *id, const char *key, double value)> callback);
+    // Gọi khi thiết bị chuyển giữa online/stale/offline (trong task ZigbeeServer)
+    void onStatus(std::function<void(const char *id, DeviceStatus status)> callback);
+    void setPollInterval(uint32_t intervalMs);
+    bool setPollInterval(const char *id, uint32_t intervalMs);
+    CommandHandle checkDevice(const char *id);
+    CommandHandle sendCommand(const char *id, const char *cmd, uint8_t priority = CMD_PRIORITY_NORMAL);
+    CommandHandle sendCommand(const char *id, const char *secrect_key, const char *cmd, uint8_t priority = CMD_PRIORITY_NORMAL);
+    CommandStatus waitCommand(CommandHandle handle, uint32_t timeoutMs);
+    CommandStatus commandStatus(CommandHandle handle);
     void broadcastMessage();
+    void setBinaryFraming(bool enabled);
+    uint32_t overlongLines() const;
+    uint32_t truncatedLines() const;
+    uint32_t binaryOverruns() const;
 
-    std::vector<Device> deviceList;
+    const DeviceRegistry &devices() const { return _devices; }
+    // Thiết bị vừa vào mạng (online lần đầu hoặc trở lại) hoặc rời mạng (offline), chưa được báo
+    DeviceChangeSet &membershipChanges() { return _membershipChanges; }
+    TaskHandle_t task() const { return _task; }
+    // Thời điểm (esp_timer, us) nhận byte kết thúc của khung tin đang xử lý, dùng trong callback
+    int64_t frameTimeUs() const { return _frameTimeUs; }
 
 private:
     void initZigbee();
-    void handleIncomingMessage(const std::string& message);
-    HardwareSerial *_zigbeeSerial;
+    void wake();
+    uint32_t idleWaitMs();
+    CommandHandle queueCommand(const char *id, const char *secrect_key, const char *cmd, uint8_t priority, bool anyReply);
+    void handleByte(char c);
+    void handleIncomingMessage(const Frame& frame);
+    void handleBinaryMessage(const uint8_t *payload, size_t length);
+    void handleControlMessage(const char *line);
+    Device *touchDevice(const char *id, uint8_t wireFormat, bool &isNew);
+    void updateLinkQuality(Device &device, const FieldView &data);
+    void markSeen(size_t index);
+    void pollDevice(uint16_t index);
+    void setStatus(size_t index, DeviceStatus status);
+    uint32_t withJitter(uint32_t delayMs);
+
+    // Trạng thái kiểm tra của từng thiết bị, cùng chỉ số với DeviceRegistry
+    struct PollState {
+        uint16_t intervalS; // 0: dùng _pollIntervalMs
+        uint8_t missed;     // Số lệnh kiểm tra liên tiếp chưa được trả lời
+    };
+
+    HardwareSerialLink *_defaultLink; // Chỉ tạo khi dùng UART của ZigbeeServer, nullptr nếu link do bên ngoài truyền vào
+    SerialLink *_link;
+    uint32_t _baudRate;
+    TaskHandle_t _task;
+    FrameParser _parser;
+    DeviceRegistry _devices;
+    bool _binaryFraming;
+    int64_t _frameTimeUs;
 
-    static ZigbeeServer *_instance;
-    std::queue<std::string> messageQueue;
+    CommandScheduler _commands;
+    TimerWheel _pollTimers;
+    PollState *_polls;
+    uint32_t _pollIntervalMs;
+    DeviceChangeSet _membershipChanges;
     std::function<void(const char *id, const char *data)> messageCallback;
+    std::function<void(const char *id, const char *key, double value)> readingCallback;
     std::function<void()> onChangeCallback;
+    std::function<void(const char *id, DeviceStatus status)> statusCallback;
 };
 
 #endif // ZIGBEESERVER_H
@@ -1,17 +1,24 @@
 #include <Arduino.h>
 #include "ZigbeeServer.h"
+#include "ZigbeeRouter.h"
+#include "DataDecoder.h"
 #include "PEClient.h"
+#include "SpscRing.h"
+#include "Metric.h"
+#include "MetricStore.h"
+#include "MetricAggregator.h"
+#include "DeadbandFilter.h"
+#include "DeviceShadow.h"
+#include "Telemetry.h"
+#include "HeapTracker.h"
+#include "TimeService.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
 #include "esp_log.h"
-#include <sstream>
-#include <vector>
-#include <deque>
-#include <string>
-#include <queue>  
-#include <WiFiUdp.h>
-#include <NTPClient.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
 
 #define WIFI_SSID "VanPhong2.4g"
 #define WIFI_PASSWORD "Vp@1denchin"
@@ -27,30 +34,94 @@
 
 #define LED1_PIN 2
 
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org",3600 * 0, 60000); // Update mỗi 60 giây
+TimeService timeService; // Đồng bộ SNTP chạy nền, không chặn luồng dữ liệu
 
 PEClient peClient(WIFI_SSID, WIFI_PASSWORD, MQTT_SERVER, MQTT_PORT, CLIENT_ID, USERNAME, PASSWORD);
-ZigbeeServer zigbeeServer;
-void led1Callback(String value);
-void sendAttributes();
-void onCollectData(const char *id, const char *data);
 
-struct Metric {
-    std::string name;
-    double value;
-    uint64_t ts;
+#ifndef ZIGBEE_RADIO_COUNT
+#define ZIGBEE_RADIO_COUNT 1 // Số module Zigbee điều phối đang gắn vào gateway
+#endif
+
+struct RadioConfig
+{
+    HardwareSerial *serial;
+    int8_t rxPin;
+    int8_t txPin;
+    uint32_t baudRate;
+    BaseType_t core;
 };
 
-struct Attribute {
-    std::string name;
-    std::string value;
+// Thay đổi chân RX/TX theo cấu hình của bạn; các task Zigbee chạy trên core 0, MQTT trên core 1
+static const RadioConfig radioConfigs[] = {
+    {&Serial1, 16, 17, ZIGBEE_DEFAULT_BAUD, 0},
+    {&Serial2, 25, 26, ZIGBEE_DEFAULT_BAUD, 0},
 };
+static_assert(ZIGBEE_RADIO_COUNT <= sizeof(radioConfigs) / sizeof(radioConfigs[0]), "Missing RadioConfig");
 
-// Khai báo queue để lưu trữ các metric
-std::queue<Metric> metricQueue;
-std::vector<Attribute> attributes; // Khai báo vector attributes
-SemaphoreHandle_t metricQueueMutex; // Mutex để bảo vệ truy cập vào hàng đợi
+ZigbeeRouter zigbeeRouter; // Gửi lệnh tới radio đang quản lý thiết bị
+// Các radio cùng ghi vào một luồng metric: decode, intern, lọc và push vào hàng đợi phải tuần tự
+SemaphoreHandle_t producerLock;
+
+// Các thông số đã biết trong trường DATA; thông số khác được đọc như số thực
+static const DataField dataSchema[] = {
+    {"temp", DATA_NUMBER, 1.0f, "C"},
+    {"hum", DATA_NUMBER, 1.0f, "%"},
+    {"bat", DATA_NUMBER, 1.0f, "%"},
+    {"volt", DATA_NUMBER, 1.0f, "V"},
+    {"rssi", DATA_INT, 1.0f, "dBm"},
+    {"lqi", DATA_INT, 1.0f, ""},
+    {"state", DATA_BOOL, 1.0f, ""},
+    {"led", DATA_BOOL, 1.0f, ""},
+};
+DataDecoder dataDecoder(dataSchema, sizeof(dataSchema) / sizeof(dataSchema[0])); // Chỉ dùng khi giữ producerLock
+void led1Callback(const RpcValue &value);
+void onDeviceRpc(const char *key, const char *deviceId, const RpcValue &value);
+void sendAttributes();
+void buildDeviceList(String &deviceIds);
+void publishMembershipChanges(ZigbeeServer &radio);
+void onCollectData(ZigbeeServer &radio, const char *id, const char *data);
+void onCollectReading(ZigbeeServer &radio, const char *id, const char *key, double value);
+uint64_t frameTimestamp(const ZigbeeServer &radio, uint8_t &flags);
+void onDeviceStatus(const char *id, DeviceStatus status);
+void onPollInterval(const RpcValue &value);
+void onPollIntervalFor(const char *key, const char *deviceId, const RpcValue &value);
+void enqueueMetric(const char *key, const char *id, double value, uint64_t timestamp, uint8_t flags);
+void sendTelemetry();
+uint64_t trustedTimestamp(uint64_t timestamp, uint8_t &flags);
+bool replayMetric(const StoredMetric &record);
+void syncShadow();
+void onShadowRequest(const PEClient::Request &request);
+void publishSummary(MetricHandle handle, const MetricSummary &summary);
+void deliverMetric(uint64_t timestamp, const char *name, float value, uint8_t flags);
+void onAggregateWindow(const RpcValue &value);
+void onAggregateWindowFor(const char *key, const char *match, const RpcValue &value);
+bool parseDeadband(const RpcValue &value, DeadbandConfig &config);
+void onDeadband(const RpcValue &value);
+void onDeadbandFor(const char *key, const char *match, const RpcValue &value);
+
+#define METRIC_RING_SIZE 512
+#define METRIC_REPLAY_PER_TICK 5 // Số metric đọc lại từ flash mỗi 10 ms khi có kết nối
+#define TELEMETRY_PUBLISH_INTERVAL_MS 60000
+#define TELEMETRY_DOC_ARENA_SIZE 3072 // Gói thuộc tính chứa mọi bộ đếm, trên stack của sendMetricsTask
+#define METRIC_AGGREGATE_POLL_MS 100 // Chu kỳ đóng các cửa sổ gom đã hết hạn
+#define HEAP_WARMUP_MS 120000 // Sau thời gian này, cấp phát trong luồng dữ liệu được HeapTracker đếm
+#define SHADOW_SYNC_INTERVAL_MS 30000 // Chu kỳ gửi các giá trị shadow đã đổi
+#define SHADOW_SYNC_BATCH 16          // Số thuộc tính tối đa trong một gói đồng bộ
+#define SHADOW_RESPONSE_MAX_KEYS 64   // Số metric tối đa trong một câu trả lời, còn nữa thì có "more": true
+#define SHADOW_RPC_METHOD "getShadow"
+#define DEVICES_RPC_METHOD "getDevices"
+#define DEVICE_CHANGE_QUIET_MS 2000       // Gửi thay đổi vào/rời mạng khi không có thay đổi mới trong 2 giây
+#define DEVICE_CHANGE_MAX_DELAY_MS 10000  // hoặc muộn nhất 10 giây sau thay đổi đầu tiên
+#define DEVICE_CHANGE_BUFFER_SIZE 256     // Độ dài tối đa danh sách ID trong một gói thay đổi
+#define DEVICE_LIST_INTERVAL_MS 3600000   // Chu kỳ gửi lại toàn bộ danh sách thiết bị
+
+// Hàng đợi vòng không khóa: các task Zigbee ghi (tuần tự qua producerLock), core 1 (MQTT) đọc
+SpscRing<Metric, METRIC_RING_SIZE> metricQueue;
+MetricNames metricNames; // (thiết bị, thông số) -> handle, chỉ intern khi giữ producerLock
+MetricStore metricStore("/littlefs/metrics"); // Lưu metric khi mất kết nối hoặc gửi không kịp, chỉ dùng trong sendMetricsTask
+MetricAggregator metricAggregator(metricNames); // Gom metric theo cửa sổ trong sendMetricsTask
+DeadbandFilter deadbandFilter(metricNames); // Bỏ các mẫu không đổi, chỉ dùng khi giữ producerLock (enqueueMetric)
+DeviceShadow deviceShadow(metricNames); // Giá trị gần nhất của mọi metric, ghi khi giữ producerLock, đọc từ task MQTT
 
 /**
  * @name sendMetricsTask
@@ -61,16 +132,47 @@ SemaphoreHandle_t metricQueueMutex; // Mutex để bảo vệ truy cập vào h
  * @return None
  */
 void sendMetricsTask(void *pvParameters) {
+    Metric metric;
+    unsigned long lastTelemetry = 0;
+    unsigned long lastAggregatePoll = 0;
+    unsigned long lastShadowSync = 0;
+    unsigned long lastDeviceList = millis(); // Danh sách đầy đủ đã được gửi khi kết nối
+    HeapTracker::track(xTaskGetCurrentTaskHandle());
     while (true) {
+        if (!HeapTracker::steadyState() && millis() >= HEAP_WARMUP_MS) {
+            HeapTracker::markSteadyState();
+        }
+        Telemetry::set(TELEMETRY_QUEUE_DEPTH, metricQueue.size());
+        // Gửi ngoài mọi khóa, core 0 vẫn ghi tiếp vào hàng đợi trong lúc MQTT chậm
+        while (metricQueue.pop(metric)) {
+            metricAggregator.add(metric, millis());
+        }
+        if (millis() - lastAggregatePoll >= METRIC_AGGREGATE_POLL_MS) {
+            lastAggregatePoll = millis();
+            metricAggregator.poll(lastAggregatePoll);
+        }
+        // Dữ liệu trực tiếp được ưu tiên, dữ liệu cũ chỉ gửi lại với tốc độ giới hạn
+        if (peClient.connected() && !metricStore.empty()) {
+            metricStore.replay(METRIC_REPLAY_PER_TICK, replayMetric);
+        }
+        peClient.pollMetrics();
+        if (peClient.connected() && millis() - lastTelemetry >= TELEMETRY_PUBLISH_INTERVAL_MS) {
+            lastTelemetry = millis();
+            sendTelemetry();
+        }
+        if (peClient.connected() && millis() - lastShadowSync >= SHADOW_SYNC_INTERVAL_MS) {
+            lastShadowSync = millis();
+            syncShadow();
+        }
         if (peClient.connected()) {
-            if (xSemaphoreTake(metricQueueMutex, portMAX_DELAY) == pdTRUE) {
-                while (!metricQueue.empty()) {
-                    Metric metric = metricQueue.front();
-                    ESP_LOGI("Main", "Sending metric %s: %f - %llu", metric.name.c_str(), metric.value, metric.ts);
-                    peClient.sendMetric(metric.ts, metric.name.c_str(), metric.value);
-                    metricQueue.pop();
+            for (size_t i = 0; i < zigbeeRouter.size(); i++) {
+                if (zigbeeRouter.at(i).membershipChanges().ready(millis(), DEVICE_CHANGE_QUIET_MS, DEVICE_CHANGE_MAX_DELAY_MS)) {
+                    publishMembershipChanges(zigbeeRouter.at(i));
                 }
-                xSemaphoreGive(metricQueueMutex);
+            }
+            if (millis() - lastDeviceList >= DEVICE_LIST_INTERVAL_MS) {
+                lastDeviceList = millis();
+                sendAttributes();
             }
         }
         vTaskDelay(10 / portTICK_PERIOD_MS); // Delay 1 giây giữa các lần gửi
@@ -87,25 +189,49 @@ void sendMetricsTask(void *pvParameters) {
  */
 void setup()
 {
-    zigbeeServer.begin();
-
-    peClient.begin();
-    peClient.on("led1", led1Callback);
+    if (!LittleFS.begin(true) || !metricStore.begin())
+    {
+        ESP_LOGE("Main", "Cannot open metric store");
+    }
 
-    while (!peClient.connected())
+    producerLock = xSemaphoreCreateMutex();
+    for (int i = 0; i < ZIGBEE_RADIO_COUNT; i++)
     {
-        ESP_LOGI("Main", "Waiting for MQTT connection...");
-        delay(1000);
+        const RadioConfig &config = radioConfigs[i];
+        ZigbeeServer *radio = new ZigbeeServer(*config.serial, config.rxPin, config.txPin);
+        radio->setBinaryFraming(true);
+        radio->onMessage([radio](const char *id, const char *data)
+        {
+            onCollectData(*radio, id, data);
+        });
+        radio->onReading([radio](const char *id, const char *key, double value)
+        {
+            onCollectReading(*radio, id, key, value);
+        });
+        radio->onStatus(onDeviceStatus);
+        radio->begin(config.baudRate, config.core);
+        HeapTracker::track(radio->task());
+        zigbeeRouter.add(*radio);
     }
 
     pinMode(LED1_PIN, OUTPUT);
     digitalWrite(LED1_PIN, LOW);
-    sendAttributes();
 
-    metricQueueMutex = xSemaphoreCreateMutex(); // Tạo mutex
+    // Không chờ kết nối: dữ liệu vẫn được thu và lưu tạm trong lúc uplink đang kết nối
+    peClient.onConnect(sendAttributes);
+    peClient.on("led1", led1Callback);
+    peClient.onDevice("*", onDeviceRpc);
+    peClient.on("aggWindow", onAggregateWindow);
+    peClient.onDevice("aggWindow", onAggregateWindowFor);
+    peClient.on("deadband", onDeadband);
+    peClient.onDevice("deadband", onDeadbandFor);
+    peClient.on("pollInterval", onPollInterval);
+    peClient.onDevice("pollInterval", onPollIntervalFor);
+    peClient.onRequest(onShadowRequest);
+    metricAggregator.onSummary(publishSummary);
+    peClient.begin();
 
-    timeClient.begin(); // Bắt đầu NTP client
-    timeClient.update(); // Cập nhật thời gian ngay lập tức
+    timeService.begin(); // Sau peClient.begin(): cần stack TCP/IP của WiFi
 
     // Tạo task sendMetricsTask chạy trên Core 1
     xTaskCreatePinnedToCore(
@@ -117,8 +243,6 @@ void setup()
         NULL,
         1 // Chạy trên core 1
     );
-    zigbeeServer.onChange(sendAttributes);
-    zigbeeServer.onMessage(onCollectData);
 }
 
 /**
@@ -131,40 +255,67 @@ void setup()
  */
 void loop()
 {
-    timeClient.update(); // Cập nhật thời gian mỗi chu kỳ loop
-    ESP_LOGI("Main", "NTP Time: %s", timeClient.getFormattedTime().c_str());
-    delay(1000);
+    // Mọi việc chạy trong các task riêng
+    vTaskDelete(NULL);
 }
 
 /**
- * @name stringToBool
- * @brief Chuyển đổi chuỗi thành boolean
+ * @name led1Callback
+ * @brief Callback khi có dữ liệu đến từ MQTT
  * 
- * @param {const String &} value - Chuỗi cần chuyển đổi
+ * @param {const RpcValue &} value - Dữ liệu nhận được
  * 
- * @return {bool} - Giá trị boolean
+ * @return None
  */
-bool stringToBool(const String &value)
+void led1Callback(const RpcValue &value)
 {
-    return value.equalsIgnoreCase("true") || value == "1";
+    digitalWrite(LED1_PIN, value.asBool());
 }
 
 /**
- * @name led1Callback
- * @brief Callback khi có dữ liệu đến từ MQTT
+ * @name onDeviceRpc
+ * @brief Chuyển thông số "<key>_<deviceId>" từ MQTT thành lệnh Zigbee "key:value"
  * 
- * @param {String} value - Dữ liệu nhận được
+ * @param {const char*} key - Tên thông số
+ * @param {const char*} deviceId - ID thiết bị
+ * @param {const RpcValue &} value - Giá trị
  * 
  * @return None
  */
-void led1Callback(String value)
+void onDeviceRpc(const char *key, const char *deviceId, const RpcValue &value)
 {
-    digitalWrite(LED1_PIN, stringToBool(value));
+    if (zigbeeRouter.owner(deviceId) == nullptr)
+    {
+        ESP_LOGW("Main", "RPC %s for unknown device %s", key, deviceId);
+        return;
+    }
+
+    char cmd[ZIGBEE_COMMAND_MAX_SIZE / 2];
+    switch (value.type)
+    {
+    case RpcValue::RPC_BOOL:
+        snprintf(cmd, sizeof(cmd), "%s:%d", key, value.boolean ? 1 : 0);
+        break;
+    case RpcValue::RPC_NUMBER:
+        snprintf(cmd, sizeof(cmd), "%s:%g", key, value.number);
+        break;
+    case RpcValue::RPC_STRING:
+        snprintf(cmd, sizeof(cmd), "%s:%s", key, value.str);
+        break;
+    default:
+        return;
+    }
+
+    if (zigbeeRouter.sendCommand(deviceId, cmd, CMD_PRIORITY_HIGH) == 0)
+    {
+        ESP_LOGW("Main", "Command queue full, dropped %s for %s", cmd, deviceId);
+    }
 }
 
 /**
  * @name sendAttributes
- * @brief Gửi thông số lên MQTT
+ * @brief Gửi thông số và toàn bộ danh sách thiết bị lên MQTT, chỉ khi kết nối
+ *        hoặc theo chu kỳ DEVICE_LIST_INTERVAL_MS
  * 
  * @param None
  * 
@@ -172,92 +323,642 @@ void led1Callback(String value)
  */
 void sendAttributes()
 {
-    attributes.clear();
-    Attribute attr;
-    attr.name = "localIP";
-    attr.value = WiFi.localIP().toString().c_str();
-    attributes.push_back(attr);
-    attr.name = "devices";
-    String deviceIds = "";
-    for (size_t i = 0; i < zigbeeServer.deviceList.size(); ++i)
+    char localIP[16];
+    IPAddress ip = WiFi.localIP();
+    snprintf(localIP, sizeof(localIP), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    peClient.sendAttribute("localIP", localIP);
+
+    // Thiết bị vào/rời mạng được gửi riêng bằng publishMembershipChanges
+    String deviceIds;
+    buildDeviceList(deviceIds);
+    peClient.sendAttribute("devices", deviceIds.c_str());
+}
+
+/**
+ * @name buildDeviceList
+ * @brief Nối ID các thiết bị chưa offline trên mọi radio, cách nhau bằng dấu phẩy
+ * 
+ * @param {String &} deviceIds - Danh sách nhận được
+ * 
+ * @return None
+ */
+void buildDeviceList(String &deviceIds)
+{
+    deviceIds.reserve(zigbeeRouter.deviceCount() * 8);
+    zigbeeRouter.forEachDevice([&deviceIds](const Device &device)
     {
-        deviceIds += zigbeeServer.deviceList[i].id.c_str();
-        if (i < zigbeeServer.deviceList.size() - 1)
+        if (device.status == DEVICE_OFFLINE)
+        {
+            return;
+        }
+        if (deviceIds.length() > 0)
         {
             deviceIds += ","; // Thêm dấu phẩy giữa các ID, trừ ID cuối cùng
         }
-    }
-    attr.value = deviceIds.c_str();
-    attributes.push_back(attr);
-    for (Attribute attr : attributes)
+        deviceIds += device.id;
+    });
+}
+
+/**
+ * @name publishMembershipChanges
+ * @brief Gửi các thiết bị vừa vào/rời mạng của một radio dưới dạng thuộc tính
+ *        "devicesJoined"/"devicesLeft" (ID cách nhau bằng dấu phẩy), gom nhiều
+ *        thay đổi vào một gói tin thay vì gửi lại toàn bộ danh sách
+ * 
+ * @param {ZigbeeServer &} radio - Radio có thay đổi
+ * 
+ * @return None
+ */
+void publishMembershipChanges(ZigbeeServer &radio)
+{
+    char joined[DEVICE_CHANGE_BUFFER_SIZE];
+    char left[DEVICE_CHANGE_BUFFER_SIZE];
+    size_t joinedLength = 0;
+    size_t leftLength = 0;
+
+    auto flush = [&]()
     {
-        peClient.sendAttribute(attr.name.c_str(), attr.value.c_str());
-    }
+        if (joinedLength == 0 && leftLength == 0)
+        {
+            return;
+        }
+        JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+        JsonDocument doc(&arena);
+        JsonObject attributes = doc["attributes"].to<JsonObject>();
+        if (joinedLength > 0)
+        {
+            attributes["devicesJoined"] = static_cast<const char *>(joined);
+        }
+        if (leftLength > 0)
+        {
+            attributes["devicesLeft"] = static_cast<const char *>(left);
+        }
+        attributes["deviceCount"] = zigbeeRouter.deviceCount();
+        if (!peClient.sendAttributes(doc))
+        {
+            // Danh sách đầy đủ được gửi lại khi kết nối lại
+            ESP_LOGW("Main", "Cannot publish device changes");
+        }
+        joinedLength = 0;
+        leftLength = 0;
+    };
+
+    radio.membershipChanges().drain([&](size_t index)
+    {
+        const Device &device = radio.devices().at(index);
+        // Trạng thái được ghi trước khi thiết bị vào tập thay đổi (xem ZigbeeServer::setStatus)
+        bool isOffline = __atomic_load_n(&device.status, __ATOMIC_ACQUIRE) == DEVICE_OFFLINE;
+        char *list = isOffline ? left : joined;
+        size_t &length = isOffline ? leftLength : joinedLength;
+        size_t idLength = strlen(device.id);
+        if (length + idLength + 2 > DEVICE_CHANGE_BUFFER_SIZE)
+        {
+            flush();
+        }
+        if (length > 0)
+        {
+            list[length++] = ',';
+        }
+        memcpy(list + length, device.id, idLength + 1);
+        length += idLength;
+    });
+    flush();
 }
 
 /**
  * @name onCollectData
  * @brief Hàm thu thập dữ liệu từ thiết bị
  * 
+ * @param {ZigbeeServer &} radio - Radio nhận khung tin
  * @param {const char*} id - ID của thiết bị
  * @param {const char*} data - Dữ liệu từ thiết bị
  * 
  * @return None
  */
-void onCollectData(const char *id, const char *data)
+void onCollectData(ZigbeeServer &radio, const char *id, const char *data)
 {
     ESP_LOGI("Main", "Collect data from device %s: %s", id, data);
-    std::istringstream dataStream(data);
-    std::string item;
-    bool hasComma = strchr(data, ',') != nullptr; // Kiểm tra xem chuỗi có chứa dấu phẩy không
-
-    if (hasComma) {
-        while (std::getline(dataStream, item, ',')) {
-            std::istringstream itemStream(item);
-            std::string key;
-            std::string valueStr;
-            if (std::getline(itemStream, key, ':') && std::getline(itemStream, valueStr)) {
-                std::string metricName = key + "_" + id;
-                double value = std::stod(valueStr);
-                uint64_t timestamp = timeClient.getEpochTime(); // Lấy thời gian từ NTP client
-                timestamp *= 1000; // Chuyển đổi sang milliseconds
-                ESP_LOGI("Main", "Collected metric %s: %f - %llu", metricName.c_str(), value, timestamp);
-                Metric metric = {metricName, value, timestamp};
-
-                // Thêm metric vào hàng đợi
-                if (xSemaphoreTake(metricQueueMutex, portMAX_DELAY) == pdTRUE) {
-                    metricQueue.push(metric);
-                    xSemaphoreGive(metricQueueMutex);
-                }
+    uint8_t flags;
+    uint64_t timestamp = frameTimestamp(radio, flags);
+
+    xSemaphoreTake(producerLock, portMAX_DELAY);
+    uint32_t errors = dataDecoder.errors();
+    dataDecoder.decode(data, [&](const DataValue &value) {
+        enqueueMetric(value.key, id, value.value, timestamp, flags);
+    });
+    if (dataDecoder.errors() != errors) {
+        Telemetry::count(TELEMETRY_PARSE_ERRORS, dataDecoder.errors() - errors);
+        ESP_LOGW("Main", "Invalid data from device %s: %s", id, data);
+    }
+    xSemaphoreGive(producerLock);
+}
+
+/**
+ * @name onCollectReading
+ * @brief Hàm thu thập một giá trị đo từ khung nhị phân
+ * 
+ * @param {ZigbeeServer &} radio - Radio nhận khung tin
+ * @param {const char*} id - ID của thiết bị
+ * @param {const char*} key - Tên thông số
+ * @param {double} value - Giá trị
+ * 
+ * @return None
+ */
+void onCollectReading(ZigbeeServer &radio, const char *id, const char *key, double value)
+{
+    uint8_t flags;
+    uint64_t timestamp = frameTimestamp(radio, flags);
+    xSemaphoreTake(producerLock, portMAX_DELAY);
+    enqueueMetric(key, id, value, timestamp, flags);
+    xSemaphoreGive(producerLock);
+}
+
+/**
+ * @name onDeviceStatus
+ * @brief Gửi sự kiện online/offline của thiết bị thành metric "online_<id>" (1 hoặc 0)
+ * 
+ * @param {const char*} id - ID của thiết bị
+ * @param {DeviceStatus} status - Trạng thái mới
+ * 
+ * @return None
+ */
+void onDeviceStatus(const char *id, DeviceStatus status)
+{
+    ESP_LOGI("Main", "Device %s status %d", id, status);
+    if (status != DEVICE_ONLINE && status != DEVICE_OFFLINE)
+    {
+        return;
+    }
+    bool trusted;
+    uint64_t timestamp = timeService.toEpochMs(esp_timer_get_time(), &trusted);
+    xSemaphoreTake(producerLock, portMAX_DELAY);
+    enqueueMetric("online", id, status == DEVICE_ONLINE ? 1 : 0, timestamp, trusted ? 0 : METRIC_FLAG_UNTRUSTED_TIME);
+    xSemaphoreGive(producerLock);
+}
+
+/**
+ * @name frameTimestamp
+ * @brief Thời gian (ms) của khung tin đang xử lý, lấy lúc ZigbeeServer nhận byte kết thúc
+ * 
+ * @param {const ZigbeeServer &} radio - Radio nhận khung tin
+ * @param {uint8_t &} flags - Nhận METRIC_FLAG_UNTRUSTED_TIME nếu chưa đồng bộ NTP
+ * 
+ * @return uint64_t - Thời gian epoch (ms), hoặc thời gian kể từ khi khởi động
+ */
+uint64_t frameTimestamp(const ZigbeeServer &radio, uint8_t &flags)
+{
+    bool trusted;
+    uint64_t timestamp = timeService.toEpochMs(radio.frameTimeUs(), &trusted);
+    flags = trusted ? 0 : METRIC_FLAG_UNTRUSTED_TIME;
+    return timestamp;
+}
+
+/**
+ * @name enqueueMetric
+ * @brief Đưa một metric vào hàng đợi gửi, bỏ metric nếu hàng đợi đầy (gọi khi giữ producerLock)
+ * 
+ * @param {const char*} key - Tên thông số
+ * @param {const char*} id - ID của thiết bị
+ * @param {double} value - Giá trị
+ * @param {uint64_t} timestamp - Thời gian (ms)
+ * @param {uint8_t} flags - Cờ của metric (METRIC_FLAG_*)
+ * 
+ * @return None
+ */
+void enqueueMetric(const char *key, const char *id, double value, uint64_t timestamp, uint8_t flags)
+{
+    Metric metric;
+    metric.handle = metricNames.intern(id, key);
+    if (metric.handle == MetricNames::kInvalid) {
+        ESP_LOGE("Main", "Cannot intern metric %s_%s", key, id);
+        return;
+    }
+    bool changed = deadbandFilter.accept(metric.handle, static_cast<float>(value), millis());
+    // Shadow giữ mọi mẫu, nhưng chỉ đồng bộ lại các thay đổi vượt ngưỡng lọc
+    deviceShadow.update(metric.handle, static_cast<float>(value), timestamp, flags, changed);
+    // Metric được gom cần mọi mẫu để min/max/mean/count của cửa sổ đúng, ngưỡng lọc
+    // chỉ áp dụng cho metric gửi thẳng
+    if (!changed && !metricAggregator.aggregates(metric.handle)) {
+        Telemetry::count(TELEMETRY_METRICS_SUPPRESSED);
+        return;
+    }
+    metric.value = static_cast<float>(value);
+    metric.ts = timestamp;
+    metric.flags = flags;
+    metric.reserved = 0;
+    ESP_LOGI("Main", "Collected metric %s: %f - %llu", metricNames.name(metric.handle), value, timestamp);
+
+    if (!metricQueue.push(metric)) {
+        Telemetry::count(TELEMETRY_METRICS_DROPPED);
+        ESP_LOGW("Main", "Metric queue full, dropped %u metrics", metricQueue.dropped());
+        return;
+    }
+    Telemetry::max(TELEMETRY_QUEUE_HIGH_WATER, metricQueue.size());
+}
+
+/**
+ * @name sendTelemetry
+ * @brief Gửi bộ đếm sức khỏe gateway lên MQTT dưới dạng thuộc tính "gw_<tên>"
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void sendTelemetry()
+{
+    Telemetry::Snapshot snapshot;
+    Telemetry::snapshot(snapshot);
+
+    // Mọi bộ đếm trong một gói thuộc tính
+    JsonArena<TELEMETRY_DOC_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
+    JsonObject attributes = doc["attributes"].to<JsonObject>();
+    char key[40];
+    for (int i = 0; i < TELEMETRY_COUNTER_COUNT; i++)
+    {
+        snprintf(key, sizeof(key), "gw_%s", Telemetry::counterName(static_cast<TelemetryCounter>(i)));
+        attributes[key] = snapshot.counters[i];
+    }
+    for (int i = 0; i < TELEMETRY_GAUGE_COUNT; i++)
+    {
+        snprintf(key, sizeof(key), "gw_%s", Telemetry::gaugeName(static_cast<TelemetryGauge>(i)));
+        attributes[key] = snapshot.gauges[i];
+    }
+    if (doc.overflowed() || !peClient.sendAttributes(doc))
+    {
+        // Gửi lại ở chu kỳ sau
+        ESP_LOGW("Main", "Cannot publish telemetry");
+    }
+}
+
+/**
+ * @name trustedTimestamp
+ * @brief Đổi thời gian của mẫu thu trước khi đồng bộ NTP (cùng lần khởi động)
+ *        sang epoch khi có thể
+ * 
+ * @param {uint64_t} timestamp - Thời gian (ms)
+ * @param {uint8_t &} flags - Cờ của metric, bỏ METRIC_FLAG_UNTRUSTED_TIME nếu đổi được
+ * 
+ * @return uint64_t - Thời gian (ms)
+ */
+uint64_t trustedTimestamp(uint64_t timestamp, uint8_t &flags)
+{
+    if ((flags & METRIC_FLAG_UNTRUSTED_TIME) && timeService.synced()) {
+        flags &= ~METRIC_FLAG_UNTRUSTED_TIME;
+        return timeService.toEpochMs(static_cast<int64_t>(timestamp) * 1000);
+    }
+    return timestamp;
+}
+
+/**
+ * @name replayMetric
+ * @brief Gửi lại một metric đã lưu trên flash. Thời gian tính từ lúc khởi động chỉ
+ *        đổi được sang epoch nếu bản ghi thuộc lần khởi động này; bản ghi chưa đồng
+ *        bộ NTP của lần khởi động trước không còn mốc thời gian nên bị bỏ
+ * 
+ * @param {const StoredMetric &} record - Bản ghi
+ * 
+ * @return bool - False nếu chưa gửi được (cửa sổ QoS1 đầy hoặc chờ đồng bộ NTP),
+ *         bản ghi được đọc lại ở lần sau
+ */
+bool replayMetric(const StoredMetric &record)
+{
+    uint8_t flags = record.flags;
+    uint64_t timestamp = record.ts;
+    if (flags & METRIC_FLAG_UNTRUSTED_TIME)
+    {
+        if (!metricStore.fromThisBoot(record))
+        {
+            Telemetry::count(TELEMETRY_METRICS_UNDATED);
+            return true;
+        }
+        timestamp = trustedTimestamp(timestamp, flags);
+        if (flags & METRIC_FLAG_UNTRUSTED_TIME)
+        {
+            return false;
+        }
+    }
+    return peClient.addMetric(timestamp, record.name, record.value);
+}
+
+/**
+ * @name deliverMetric
+ * @brief Gửi một giá trị lên MQTT, hoặc lưu vào flash nếu đang mất kết nối hoặc
+ *        cửa sổ gửi QoS1 đang đầy
+ * 
+ * @param {uint64_t} timestamp - Thời gian (ms)
+ * @param {const char*} name - Tên metric
+ * @param {float} value - Giá trị
+ * @param {uint8_t} flags - Cờ của metric
+ * 
+ * @return None
+ */
+void deliverMetric(uint64_t timestamp, const char *name, float value, uint8_t flags)
+{
+    timestamp = trustedTimestamp(timestamp, flags);
+    // Cửa sổ QoS1 đầy (broker chậm) thì metric được lưu vào flash thay vì bị bỏ
+    if (peClient.connected() && peClient.addMetric(timestamp, name, value)) {
+        ESP_LOGI("Main", "Sending metric %s: %f - %llu", name, value, timestamp);
+    } else if (!metricStore.append(timestamp, name, value, flags)) {
+        ESP_LOGE("Main", "Cannot store metric %s", name);
+    }
+}
+
+/**
+ * @name publishSummary
+ * @brief Gửi tóm tắt một cửa sổ: "<key>_<id>" là giá trị trung bình, kèm
+ *        "<key>_min_<id>", "<key>_max_<id>", "<key>_last_<id>", "<key>_count_<id>"
+ * 
+ * @param {MetricHandle} handle - Handle của metric
+ * @param {const MetricSummary &} summary - Tóm tắt cửa sổ
+ * 
+ * @return None
+ */
+void publishSummary(MetricHandle handle, const MetricSummary &summary)
+{
+    const char *name = metricNames.name(handle);
+    if (summary.windowMs == 0) {
+        deliverMetric(summary.ts, name, summary.last, summary.flags);
+        return;
+    }
+
+    int keyLength = metricNames.keyLength(handle);
+    const char *device = metricNames.device(handle);
+    char field[METRIC_NAME_SIZE + 8];
+
+    deliverMetric(summary.ts, name, summary.mean, summary.flags);
+    snprintf(field, sizeof(field), "%.*s_min_%s", keyLength, name, device);
+    deliverMetric(summary.ts, field, summary.min, summary.flags);
+    snprintf(field, sizeof(field), "%.*s_max_%s", keyLength, name, device);
+    deliverMetric(summary.ts, field, summary.max, summary.flags);
+    snprintf(field, sizeof(field), "%.*s_last_%s", keyLength, name, device);
+    deliverMetric(summary.ts, field, summary.last, summary.flags);
+    snprintf(field, sizeof(field), "%.*s_count_%s", keyLength, name, device);
+    deliverMetric(summary.ts, field, summary.count, summary.flags);
+}
+
+/**
+ * @name onAggregateWindow
+ * @brief Shared attribute "aggWindow": cửa sổ gom mặc định (giây), 0 để không gom
+ * 
+ * @param {const RpcValue &} value - Số giây
+ * 
+ * @return None
+ */
+void onAggregateWindow(const RpcValue &value)
+{
+    double seconds = value.asNumber();
+    metricAggregator.setDefaultWindow(seconds > 0 ? static_cast<uint32_t>(seconds * 1000) : 0);
+}
+
+/**
+ * @name onAggregateWindowFor
+ * @brief Shared attribute "aggWindow_<key hoặc id>": cửa sổ gom (giây) cho một
+ *        thông số hoặc một thiết bị
+ * 
+ * @param {const char*} key - "aggWindow"
+ * @param {const char*} match - Tên thông số hoặc ID thiết bị
+ * @param {const RpcValue &} value - Số giây
+ * 
+ * @return None
+ */
+void onAggregateWindowFor(const char *key, const char *match, const RpcValue &value)
+{
+    double seconds = value.asNumber();
+    if (!metricAggregator.setWindow(match, seconds > 0 ? static_cast<uint32_t>(seconds * 1000) : 0)) {
+        ESP_LOGW("Main", "Cannot set %s for %s", key, match);
+    }
+}
+
+/**
+ * @name parseDeadband
+ * @brief Đọc ngưỡng lọc từ shared attribute: một số (ngưỡng tuyệt đối) hoặc
+ *        chuỗi "abs:<giá trị>,pct:<phần trăm>,hb:<giây>" (có thể bỏ bớt trường)
+ * 
+ * @param {const RpcValue &} value - Giá trị nhận được
+ * @param {DeadbandConfig &} config - Ngưỡng đọc được
+ * 
+ * @return bool - False nếu không đọc được
+ */
+bool parseDeadband(const RpcValue &value, DeadbandConfig &config)
+{
+    config.absolute = 0;
+    config.percent = 0;
+    config.heartbeatMs = 0;
+    if (value.type == RpcValue::RPC_NUMBER) {
+        config.absolute = value.number;
+        return true;
+    }
+    if (value.type != RpcValue::RPC_STRING) {
+        return false;
+    }
+
+    const char *p = value.str;
+    while (*p) {
+        const char *colon = strchr(p, ':');
+        if (colon == nullptr) {
+            return false;
+        }
+        char *end;
+        float number = strtof(colon + 1, &end);
+        if (end == colon + 1 || number < 0) {
+            return false;
+        }
+        size_t nameLength = colon - p;
+        if (nameLength == 3 && strncmp(p, "abs", 3) == 0) {
+            config.absolute = number;
+        } else if (nameLength == 3 && strncmp(p, "pct", 3) == 0) {
+            config.percent = number;
+        } else if (nameLength == 2 && strncmp(p, "hb", 2) == 0) {
+            config.heartbeatMs = static_cast<uint32_t>(number * 1000);
+        } else {
+            return false;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+/**
+ * @name onDeadband
+ * @brief Shared attribute "deadband": ngưỡng lọc mặc định
+ * 
+ * @param {const RpcValue &} value - Ngưỡng (xem parseDeadband)
+ * 
+ * @return None
+ */
+void onDeadband(const RpcValue &value)
+{
+    DeadbandConfig config;
+    if (!parseDeadband(value, config)) {
+        ESP_LOGW("Main", "Invalid deadband");
+        return;
+    }
+    deadbandFilter.setDefault(config);
+}
+
+/**
+ * @name onDeadbandFor
+ * @brief Shared attribute "deadband_<key hoặc id>": ngưỡng lọc cho một thông số
+ *        hoặc một thiết bị
+ * 
+ * @param {const char*} key - "deadband"
+ * @param {const char*} match - Tên thông số hoặc ID thiết bị
+ * @param {const RpcValue &} value - Ngưỡng (xem parseDeadband)
+ * 
+ * @return None
+ */
+void onDeadbandFor(const char *key, const char *match, const RpcValue &value)
+{
+    DeadbandConfig config;
+    if (!parseDeadband(value, config) || !deadbandFilter.setRule(match, config)) {
+        ESP_LOGW("Main", "Cannot set %s for %s", key, match);
+    }
+}
+
+/**
+ * @name syncShadow
+ * @brief Gửi các giá trị shadow đã đổi từ lần đồng bộ trước dưới dạng thuộc tính
+ *        "<key>_<id>", theo từng gói SHADOW_SYNC_BATCH thuộc tính
+ * 
+ * @param None
+ * 
+ * @return None
+ */
+void syncShadow()
+{
+    while (deviceShadow.changedCount() > 0)
+    {
+        JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+        JsonDocument doc(&arena);
+        JsonObject attributes = doc["attributes"].to<JsonObject>();
+        MetricHandle handles[SHADOW_SYNC_BATCH];
+        size_t count = 0;
+
+        deviceShadow.collectChanged([&](MetricHandle handle, const ShadowValue &value)
+        {
+            if (count == SHADOW_SYNC_BATCH || !attributes[metricNames.name(handle)].set(value.value))
+            {
+                return false;
             }
+            handles[count++] = handle;
+            return true;
+        });
+        if (count == 0)
+        {
+            return;
         }
-    } else {
-        std::istringstream itemStream(data);
-        std::string key;
-        std::string valueStr;
-        if (std::getline(itemStream, key, ':') && std::getline(itemStream, valueStr)) {
-            std::string metricName = key + "_" + id;
-            double value = std::stod(valueStr);
-            uint64_t timestamp = timeClient.getEpochTime(); // Lấy thời gian từ NTP client
-            timestamp *= 1000; // Chuyển đổi sang milliseconds
-            ESP_LOGI("Main", "Collected metric %s: %f - %lld", metricName.c_str(), value, timestamp);
-            Metric metric = {metricName, value, timestamp};
-
-            // Thêm metric vào hàng đợi
-            if (xSemaphoreTake(metricQueueMutex, portMAX_DELAY) == pdTRUE) {
-                metricQueue.push(metric);
-                xSemaphoreGive(metricQueueMutex);
+        if (!peClient.sendAttributes(doc))
+        {
+            // Đồng bộ lại ở lần sau
+            for (size_t i = 0; i < count; i++)
+            {
+                deviceShadow.markChanged(handles[i]);
             }
+            return;
         }
     }
+}
 
-    if (metricQueue.size() > 100) {
-      ESP_LOGI("Main", "Clearing metric queue");
-        if (xSemaphoreTake(metricQueueMutex, portMAX_DELAY) == pdTRUE) {
-            while (metricQueue.size() > 100) {
-                metricQueue.pop();
-            }
-            xSemaphoreGive(metricQueueMutex);
+/**
+ * @name onShadowRequest
+ * @brief Trả lời yêu cầu đọc thuộc tính (hoặc RPC "getShadow") từ shadow, không hỏi lại
+ *        thiết bị. Mỗi metric có dạng "<key>_<id>": {"value", "ts", "quality"}.
+ *        RPC "getDevices" trả về toàn bộ danh sách thiết bị
+ * 
+ * @param {const PEClient::Request &} request - Yêu cầu, keys là tên metric hoặc ID thiết bị
+ * 
+ * @return None
+ */
+void onShadowRequest(const PEClient::Request &request)
+{
+    JsonDocument doc; // Chỉ dùng khi có yêu cầu, không nằm trong luồng dữ liệu
+    if (request.rpc && request.method != nullptr && strcmp(request.method, DEVICES_RPC_METHOD) == 0)
+    {
+        String deviceIds;
+        buildDeviceList(deviceIds);
+        doc["devices"] = deviceIds;
+        doc["deviceCount"] = zigbeeRouter.deviceCount();
+        peClient.respond(request, doc);
+        return;
+    }
+    if (request.rpc && (request.method == nullptr || strcmp(request.method, SHADOW_RPC_METHOD) != 0))
+    {
+        ESP_LOGW("Main", "Unknown RPC method %s", request.method ? request.method : "");
+        doc["error"] = "unknown method";
+        peClient.respond(request, doc);
+        return;
+    }
+
+    // Trả lời thuộc tính theo dạng {"client": {...}}, RPC trả thẳng object
+    JsonObject values = request.rpc ? doc.to<JsonObject>() : doc["client"].to<JsonObject>();
+    unsigned long now = millis();
+    size_t count = 0;
+    deviceShadow.query(request.keys, [&](MetricHandle handle, const ShadowValue &value)
+    {
+        if (count == SHADOW_RESPONSE_MAX_KEYS)
+        {
+            doc["more"] = true;
+            return false;
         }
+        uint8_t flags = value.flags;
+        ShadowValue trusted = value;
+        trusted.ts = trustedTimestamp(value.ts, flags);
+        trusted.flags = flags;
+
+        JsonObject entry = values[metricNames.name(handle)].to<JsonObject>();
+        entry["value"] = trusted.value;
+        entry["ts"] = trusted.ts;
+        entry["quality"] = DeviceShadow::qualityName(deviceShadow.quality(trusted, now));
+        count++;
+        return true;
+    });
+    if (!peClient.respond(request, doc))
+    {
+        ESP_LOGW("Main", "Cannot respond to request %s", request.id);
+    }
+}
+
+/**
+ * @name onPollInterval
+ * @brief Shared attribute "pollInterval": thiết bị im lặng lâu hơn số giây này sẽ được kiểm tra
+ * 
+ * @param {const RpcValue &} value - Số giây
+ * 
+ * @return None
+ */
+void onPollInterval(const RpcValue &value)
+{
+    double seconds = value.asNumber();
+    if (seconds <= 0) {
+        ESP_LOGW("Main", "Invalid pollInterval");
+        return;
+    }
+    for (size_t i = 0; i < zigbeeRouter.size(); i++) {
+        zigbeeRouter.at(i).setPollInterval(static_cast<uint32_t>(seconds * 1000));
+    }
+}
+
+/**
+ * @name onPollIntervalFor
+ * @brief Shared attribute "pollInterval_<id>": chu kỳ kiểm tra (giây) của một thiết bị,
+ *        0 để dùng chu kỳ mặc định
+ * 
+ * @param {const char*} key - "pollInterval"
+ * @param {const char*} deviceId - ID thiết bị
+ * @param {const RpcValue &} value - Số giây
+ * 
+ * @return None
+ */
+void onPollIntervalFor(const char *key, const char *deviceId, const RpcValue &value)
+{
+    double seconds = value.asNumber();
+    uint32_t intervalMs = seconds > 0 ? static_cast<uint32_t>(seconds * 1000) : 0;
+    bool found = false;
+    for (size_t i = 0; i < zigbeeRouter.size(); i++) {
+        found = zigbeeRouter.at(i).setPollInterval(deviceId, intervalMs) || found;
+    }
+    if (!found) {
+        ESP_LOGW("Main", "Cannot set %s for %s", key, deviceId);
     }
 }
@@ -0,0 +1,160 @@
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+/**
+ * Arduino-ESP32 giả cho env native (xem test/README): đủ để biên dịch các thư viện
+ * trong lib/ trên máy tính. Thời gian lấy từ đồng hồ giả trong esp_timer.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define IRAM_ATTR
+
+inline unsigned long millis() { return static_cast<unsigned long>(esp_timer_get_time() / 1000); }
+inline unsigned long micros() { return static_cast<unsigned long>(esp_timer_get_time()); }
+inline void delay(uint32_t ms) { vTaskDelay(ms); }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+namespace fake {
+
+inline uint32_t &randomState() {
+    static uint32_t state = 0x12345678;
+    return state;
+}
+
+// Đặt lại chuỗi số ngẫu nhiên để test lặp lại được
+inline void seedRandom(uint32_t seed) { randomState() = seed != 0 ? seed : 1; }
+
+} // namespace fake
+
+// xorshift32, tất định theo fake::seedRandom()
+inline uint32_t esp_random() {
+    uint32_t &x = fake::randomState();
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t written = 0;
+        while (size-- > 0 && write(*buffer++) == 1) {
+            written++;
+        }
+        return written;
+    }
+    size_t write(const char *str) { return write(reinterpret_cast<const uint8_t *>(str), strlen(str)); }
+    size_t print(const char *str) { return write(str); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t println(const char *str) { return print(str) + print("\r\n"); }
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    // Không chờ: chỉ đọc các byte đang có
+    size_t readBytes(uint8_t *buffer, size_t length) {
+        size_t count = 0;
+        while (count < length && available() > 0) {
+            buffer[count++] = static_cast<uint8_t>(read());
+        }
+        return count;
+    }
+    size_t readBytes(char *buffer, size_t length) { return readBytes(reinterpret_cast<uint8_t *>(buffer), length); }
+
+protected:
+    unsigned long _timeout;
+};
+
+class String
+{
+public:
+    String() {}
+    String(const char *str) : _s(str != nullptr ? str : "") {}
+    String(const std::string &str) : _s(str) {}
+    explicit String(int value) : _s(std::to_string(value)) {}
+    explicit String(unsigned int value) : _s(std::to_string(value)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return static_cast<unsigned int>(_s.size()); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    String &operator+=(const char *str) { _s += str; return *this; }
+    String &operator+=(char c) { _s += c; return *this; }
+    String &operator+=(const String &str) { _s += str._s; return *this; }
+    String &operator=(const char *str) { _s = str != nullptr ? str : ""; return *this; }
+    bool operator==(const char *str) const { return _s == str; }
+    bool operator==(const String &str) const { return _s == str._s; }
+    bool operator<(const String &str) const { return _s < str._s; }
+    char operator[](unsigned int index) const { return _s[index]; }
+
+private:
+    std::string _s;
+};
+
+class IPAddress
+{
+public:
+    IPAddress() { memset(_bytes, 0, sizeof(_bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    explicit IPAddress(uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+
+    operator uint32_t() const {
+        uint32_t address;
+        memcpy(&address, _bytes, sizeof(address));
+        return address;
+    }
+    bool operator==(const IPAddress &other) const { return memcmp(_bytes, other._bytes, sizeof(_bytes)) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t &operator[](int index) { return _bytes[index]; }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(text);
+    }
+
+private:
+    uint8_t _bytes[4];
+};
+
+#include "HardwareSerial.h"
+
+#endif // FAKE_ARDUINO_H
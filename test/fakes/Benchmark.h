@@ -0,0 +1,202 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * Đo hiệu năng trong env native: thời gian (ns/op) theo đồng hồ thật của máy và số
+ * lần cấp phát (allocs/op) theo HeapTracker. Cần HeapCounting.h trong cùng test.
+ *
+ * Kết quả của một bộ đo được ghi vào $BENCH_OUT_DIR/<bộ đo>.txt (mặc định
+ * .pio/bench) và so với test/bench_baseline/<bộ đo>.txt:
+ * - chưa có baseline: finish() trả về false, trừ khi đang ghi baseline mới;
+ * - allocs/op tăng so với baseline: finish() trả về false (test thất bại);
+ * - ns/op chậm hơn baseline quá BENCH_TIME_TOLERANCE_PERCENT: chỉ cảnh báo, vì
+ *   thời gian phụ thuộc máy chạy.
+ * Chạy với BENCH_SAVE_BASELINE=1 để ghi kết quả hiện tại làm baseline mới. Số đo
+ * ghi bằng report() chỉ có trong kết quả, không vào baseline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <HeapTracker.h>
+
+#ifndef BENCH_TIME_TOLERANCE_PERCENT
+#define BENCH_TIME_TOLERANCE_PERCENT 20
+#endif
+
+namespace bench {
+
+// Ngăn trình biên dịch bỏ phép tính có kết quả không được dùng
+template <typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+class Suite
+{
+public:
+    explicit Suite(const char *name) : _name(name) {}
+
+    /**
+     * Chạy fn() iterations lần sau một lượt làm nóng, ghi "<name> ns/op" và
+     * "<name> allocs/op".
+     */
+    template <typename F>
+    double run(const char *name, uint32_t iterations, F fn) {
+        for (uint32_t i = 0; i < iterations / 10 + 1; i++) {
+            fn();
+        }
+        uint32_t allocations = HeapTracker::totalAllocations();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            fn();
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        allocations = HeapTracker::totalAllocations() - allocations;
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        record(name, "ns/op", ns);
+        record(name, "allocs/op", static_cast<double>(allocations) / iterations);
+        return ns;
+    }
+
+    // Số đo khác (vd. byte/metric, MB/s), chỉ ghi lại để so sánh
+    void record(const char *name, const char *unit, double value) { add(name, unit, value, true); }
+
+    // Số đo phụ thuộc máy chạy (vd. tăng tốc theo số core): không ghi vào baseline
+    void report(const char *name, const char *unit, double value) { add(name, unit, value, false); }
+
+    /**
+     * Ghi kết quả, so với baseline và ghi baseline mới nếu được yêu cầu
+     *
+     * @return bool - False nếu chưa có baseline hoặc số lần cấp phát tăng so với baseline
+     */
+    bool finish() {
+        std::string outDir = env("BENCH_OUT_DIR", ".pio/bench");
+        std::string baselineDir = env("BENCH_BASELINE_DIR", "test/bench_baseline");
+        writeFile(outDir, fileName(), false);
+
+        std::map<std::string, double> baseline;
+        bool hasBaseline = readFile(baselineDir + "/" + fileName(), baseline);
+        bool ok = true;
+        for (size_t i = 0; i < _entries.size() && hasBaseline; i++) {
+            const Entry &entry = _entries[i];
+            std::map<std::string, double>::const_iterator previous = baseline.find(key(entry));
+            if (previous == baseline.end()) {
+                continue;
+            }
+            if (entry.unit == "allocs/op" && entry.value > previous->second + 1e-6) {
+                printf("[bench] REGRESSION %s: %.3f allocs/op (baseline %.3f)\n", entry.name.c_str(), entry.value,
+                       previous->second);
+                ok = false;
+            } else if (entry.unit == "ns/op" &&
+                       entry.value > previous->second * (100 + BENCH_TIME_TOLERANCE_PERCENT) / 100) {
+                printf("[bench] WARNING %s: %.1f ns/op (baseline %.1f)\n", entry.name.c_str(), entry.value,
+                       previous->second);
+            }
+        }
+
+        const char *save = getenv("BENCH_SAVE_BASELINE");
+        bool saving = save != nullptr && strcmp(save, "1") == 0;
+        if (!hasBaseline && !saving) {
+            // Không có gì để so: allocs/op tăng sẽ không bị phát hiện
+            printf("[bench] FAIL no baseline %s/%s, run with BENCH_SAVE_BASELINE=1 to create one\n",
+                   baselineDir.c_str(), fileName().c_str());
+            ok = false;
+        }
+        if (saving) {
+            writeFile(baselineDir, fileName(), true);
+        }
+        return ok;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string unit;
+        double value;
+        bool baseline; // Ghi vào baseline
+    };
+
+    void add(const char *name, const char *unit, double value, bool baseline) {
+        Entry entry;
+        entry.name = name;
+        entry.unit = unit;
+        entry.value = value;
+        entry.baseline = baseline;
+        _entries.push_back(entry);
+        printf("[bench] %-40s %14.2f %s\n", name, value, unit);
+    }
+
+    static std::string env(const char *name, const char *fallback) {
+        const char *value = getenv(name);
+        return value != nullptr && value[0] != '\0' ? value : fallback;
+    }
+
+    static std::string key(const Entry &entry) { return entry.name + " " + entry.unit; }
+
+    std::string fileName() const { return _name + ".txt"; }
+
+    // Tạo thư mục và các thư mục cha còn thiếu
+    static bool makeDirs(const std::string &path) {
+        for (size_t i = 1; i <= path.size(); i++) {
+            if (i == path.size() || path[i] == '/') {
+                std::string part = path.substr(0, i);
+                if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Mỗi dòng: <tên> <giá trị> <đơn vị>
+    bool writeFile(const std::string &dir, const std::string &file, bool baselineOnly) const {
+        if (!makeDirs(dir)) {
+            return false;
+        }
+        std::string path = dir + "/" + file;
+        FILE *f = fopen(path.c_str(), "w");
+        if (f == nullptr) {
+            printf("[bench] cannot write %s\n", path.c_str());
+            return false;
+        }
+        for (size_t i = 0; i < _entries.size(); i++) {
+            if (baselineOnly && !_entries[i].baseline) {
+                continue;
+            }
+            fprintf(f, "%s %.3f %s\n", _entries[i].name.c_str(), _entries[i].value, _entries[i].unit.c_str());
+        }
+        fclose(f);
+        printf("[bench] results written to %s\n", path.c_str());
+        return true;
+    }
+
+    static bool readFile(const std::string &path, std::map<std::string, double> &entries) {
+        FILE *f = fopen(path.c_str(), "r");
+        if (f == nullptr) {
+            return false;
+        }
+        char name[128];
+        char unit[32];
+        double value;
+        while (fscanf(f, "%127s %lf %31s", name, &value, unit) == 3) {
+            entries[std::string(name) + " " + unit] = value;
+        }
+        fclose(f);
+        return true;
+    }
+
+    std::string _name;
+    std::vector<Entry> _entries;
+};
+
+} // namespace bench
+
+#endif // BENCHMARK_H
@@ -0,0 +1,355 @@
+#ifndef FAKE_BROKER_H
+#define FAKE_BROKER_H
+
+#include "Arduino.h"
+#include "Client.h"
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Broker MQTT giả đóng vai socket (Client): phân tích mọi byte client ghi vào,
+ * trả lời CONNACK/SUBACK/PINGRESP và PUBACK cho gói QoS1 ngay trong write().
+ *
+ * - holdAcks(true): giữ PUBACK lại tới khi releaseAcks(); dropAcks(true): bỏ hẳn.
+ * - holdConnack(true): giữ CONNACK lại tới khi releaseConnack().
+ * - acceptBytes(n): chỉ nhận thêm n byte, các lần ghi sau trả về ít hơn yêu cầu
+ *   (socket đầy/ghi dở).
+ * - Gói không hợp lệ (vd. hai task ghi xen kẽ vào cùng socket, CONNECT thứ hai
+ *   trên cùng kết nối) được đếm trong malformed() và kết nối bị đóng như broker thật.
+ *
+ * An toàn khi nhiều luồng cùng ghi: mỗi lời gọi write() được xử lý nguyên khối.
+ */
+class FakeBroker : public Client
+{
+public:
+    struct Publish {
+        std::string topic;
+        std::string payload;
+        uint8_t qos;
+        bool dup;
+        uint16_t packetId;
+    };
+
+    FakeBroker()
+        : _connected(false), _session(false), _refuse(false), _holdAcks(false), _dropAcks(false), _holdConnack(false),
+          _connackHeld(false), _budget(-1), _connects(0), _malformed(0), _pings(0) {}
+
+    // Client
+    int connect(IPAddress, uint16_t port) override { return open(port); }
+    int connect(const char *, uint16_t port) override { return open(port); }
+    int connect(IPAddress, uint16_t port, int32_t) override { return open(port); }
+    int connect(const char *, uint16_t port, int32_t) override { return open(port); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (!_connected) {
+            return 0;
+        }
+        size_t accepted = size;
+        if (_budget >= 0) {
+            accepted = static_cast<size_t>(_budget) < size ? static_cast<size_t>(_budget) : size;
+            _budget -= static_cast<long>(accepted);
+        }
+        _inbound.append(reinterpret_cast<const char *>(buffer), accepted);
+        _written.append(reinterpret_cast<const char *>(buffer), accepted);
+        parse();
+        return accepted;
+    }
+
+    int available() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return static_cast<int>(_outbound.size());
+    }
+    int read() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_outbound.empty()) {
+            return -1;
+        }
+        int c = _outbound.front();
+        _outbound.pop_front();
+        return c;
+    }
+    int read(uint8_t *buffer, size_t size) override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        size_t count = 0;
+        while (count < size && !_outbound.empty()) {
+            buffer[count++] = _outbound.front();
+            _outbound.pop_front();
+        }
+        return static_cast<int>(count);
+    }
+    int peek() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _outbound.empty() ? -1 : _outbound.front();
+    }
+    void flush() override {}
+    void stop() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        close();
+    }
+    uint8_t connected() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _connected;
+    }
+    operator bool() override { return connected(); }
+
+    // Phía test
+    void refuseConnections(bool refuse) { _refuse = refuse; }
+    void holdAcks(bool hold) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _holdAcks = hold;
+    }
+    void dropAcks(bool drop) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _dropAcks = drop;
+    }
+    void holdConnack(bool hold) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _holdConnack = hold;
+    }
+    // Gửi CONNACK đang giữ, trả về false nếu không có
+    bool releaseConnack() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (!_connackHeld) {
+            return false;
+        }
+        _connackHeld = false;
+        send(0x20, std::string("\x00\x00", 2));
+        return true;
+    }
+    // Gửi các PUBACK đang giữ, trả về số PUBACK đã gửi
+    size_t releaseAcks() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        size_t count = _heldAcks.size();
+        for (size_t i = 0; i < count; i++) {
+            sendAck(_heldAcks[i]);
+        }
+        _heldAcks.clear();
+        return count;
+    }
+    void acceptBytes(long bytes) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _budget = bytes;
+    }
+    // Broker chủ động đóng kết nối
+    void disconnectClient() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        close();
+    }
+    // Gửi một PUBLISH QoS0 tới client (vd. yêu cầu RPC)
+    void publishToClient(const char *topic, const char *payload) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        std::string body;
+        size_t topicLength = strlen(topic);
+        body += static_cast<char>(topicLength >> 8);
+        body += static_cast<char>(topicLength & 0xff);
+        body += topic;
+        body += payload;
+        send(0x30, body);
+    }
+
+    std::vector<Publish> publishes() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _publishes;
+    }
+    size_t publishCount() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _publishes.size();
+    }
+    void clearPublishes() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _publishes.clear();
+    }
+    std::vector<std::string> subscriptions() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _subscriptions;
+    }
+    size_t heldAcks() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _heldAcks.size();
+    }
+    // Mọi byte đã nhận kể từ lần connect() gần nhất
+    size_t bytesWritten() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _written.size();
+    }
+    uint32_t connects() const { return _connects; }
+    uint32_t malformed() const { return _malformed; }
+    uint32_t pings() const { return _pings; }
+
+private:
+    int open(uint16_t) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_refuse) {
+            return 0;
+        }
+        close();
+        _connected = true;
+        _connects++;
+        return 1;
+    }
+
+    void close() {
+        _connected = false;
+        _session = false;
+        _connackHeld = false;
+        _inbound.clear();
+        _written.clear();
+        _outbound.clear();
+        _heldAcks.clear();
+        _budget = -1;
+    }
+
+    void send(uint8_t type, const std::string &body) {
+        _outbound.push_back(type);
+        size_t length = body.size();
+        do {
+            uint8_t digit = length % 128;
+            length /= 128;
+            _outbound.push_back(length > 0 ? digit | 0x80 : digit);
+        } while (length > 0);
+        _outbound.insert(_outbound.end(), body.begin(), body.end());
+    }
+
+    void sendAck(uint16_t packetId) {
+        std::string body;
+        body += static_cast<char>(packetId >> 8);
+        body += static_cast<char>(packetId & 0xff);
+        send(0x40, body);
+    }
+
+    void reject() {
+        _malformed++;
+        close();
+    }
+
+    // Xử lý mọi gói đã nhận đủ trong _inbound
+    void parse() {
+        while (_connected && !_inbound.empty()) {
+            size_t length = 0;
+            size_t multiplier = 1;
+            size_t position = 1;
+            bool complete = false;
+            while (position < _inbound.size() && position <= 4) {
+                uint8_t digit = static_cast<uint8_t>(_inbound[position++]);
+                length += (digit & 0x7f) * multiplier;
+                multiplier *= 128;
+                if ((digit & 0x80) == 0) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete) {
+                if (position > 4) {
+                    reject();
+                }
+                return;
+            }
+            if (_inbound.size() < position + length) {
+                return;
+            }
+            uint8_t type = static_cast<uint8_t>(_inbound[0]);
+            std::string body = _inbound.substr(position, length);
+            _inbound.erase(0, position + length);
+            handle(type, body);
+        }
+    }
+
+    static uint16_t readShort(const std::string &body, size_t offset) {
+        return static_cast<uint16_t>((static_cast<uint8_t>(body[offset]) << 8) | static_cast<uint8_t>(body[offset + 1]));
+    }
+
+    void handle(uint8_t type, const std::string &body) {
+        switch (type >> 4) {
+        case 1: // CONNECT
+            if (type != 0x10 || body.size() < 10 || body.compare(2, 4, "MQTT") != 0 || _session) {
+                reject();
+                return;
+            }
+            _session = true;
+            if (_holdConnack) {
+                _connackHeld = true;
+            } else {
+                send(0x20, std::string("\x00\x00", 2));
+            }
+            return;
+        case 3: { // PUBLISH
+            uint8_t qos = (type >> 1) & 0x03;
+            if (qos > 1 || body.size() < 2) {
+                reject();
+                return;
+            }
+            size_t topicLength = readShort(body, 0);
+            size_t offset = 2 + topicLength + (qos > 0 ? 2 : 0);
+            if (topicLength == 0 || offset > body.size()) {
+                reject();
+                return;
+            }
+            Publish publish;
+            publish.topic = body.substr(2, topicLength);
+            for (size_t i = 0; i < publish.topic.size(); i++) {
+                // Topic lẫn byte nhị phân: luồng gói tin đã bị ghi xen kẽ
+                if (publish.topic[i] < 0x20 || publish.topic[i] > 0x7e) {
+                    reject();
+                    return;
+                }
+            }
+            publish.payload = body.substr(offset);
+            publish.qos = qos;
+            publish.dup = (type & 0x08) != 0;
+            publish.packetId = qos > 0 ? readShort(body, 2 + topicLength) : 0;
+            _publishes.push_back(publish);
+            if (qos > 0 && !_dropAcks) {
+                if (_holdAcks) {
+                    _heldAcks.push_back(publish.packetId);
+                } else {
+                    sendAck(publish.packetId);
+                }
+            }
+            return;
+        }
+        case 8: // SUBSCRIBE
+            if (type != 0x82 || body.size() < 5) {
+                reject();
+                return;
+            }
+            _subscriptions.push_back(body.substr(4, readShort(body, 2)));
+            send(0x90, body.substr(0, 2) + std::string("\x00", 1));
+            return;
+        case 12: // PINGREQ
+            _pings++;
+            send(0xd0, std::string());
+            return;
+        case 14: // DISCONNECT
+            close();
+            return;
+        default:
+            reject();
+            return;
+        }
+    }
+
+    std::mutex _mutex;
+    bool _connected;
+    bool _session; // Đã nhận CONNECT trên kết nối này
+    bool _refuse;
+    bool _holdAcks;
+    bool _dropAcks;
+    bool _holdConnack;
+    bool _connackHeld;
+    long _budget;
+    uint32_t _connects;
+    uint32_t _malformed;
+    uint32_t _pings;
+    std::string _inbound;
+    std::string _written;
+    std::deque<uint8_t> _outbound;
+    std::vector<uint16_t> _heldAcks;
+    std::vector<Publish> _publishes;
+    std::vector<std::string> _subscriptions;
+};
+
+#endif // FAKE_BROKER_H
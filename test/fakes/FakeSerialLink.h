@@ -0,0 +1,89 @@
+#ifndef FAKE_SERIALLINK_H
+#define FAKE_SERIALLINK_H
+
+#include "SerialLink.h"
+#include "Crc32.h"
+#include <stdio.h>
+#include <mutex>
+#include <string>
+
+/**
+ * SerialLink giả phát lại một luồng byte đã ghi từ module Zigbee. Mỗi lần read()
+ * trả tối đa chunkSize byte, giống FIFO UART được đọc theo từng đợt; các byte
+ * ZigbeeServer gửi đi được giữ trong sent().
+ */
+class FakeSerialLink : public SerialLink
+{
+public:
+    explicit FakeSerialLink(size_t chunkSize = 64) : _chunkSize(chunkSize), _position(0), _baudRate(0) {}
+
+    void begin(uint32_t baudRate) override { _baudRate = baudRate; }
+    size_t available() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _stream.size() - _position;
+    }
+    size_t read(uint8_t *buffer, size_t length) override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        size_t count = _stream.size() - _position;
+        count = count < length ? count : length;
+        count = count < _chunkSize ? count : _chunkSize;
+        memcpy(buffer, _stream.data() + _position, count);
+        _position += count;
+        return count;
+    }
+    size_t write(const uint8_t *data, size_t length) override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _sent.append(reinterpret_cast<const char *>(data), length);
+        return length;
+    }
+    void onReceive(std::function<void()> callback) override { _onReceive = callback; }
+
+    // Phía test
+    void feed(const void *data, size_t length) {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            // Bỏ phần đã đọc để luồng không lớn mãi khi phát lại nhiều lần
+            _stream.erase(0, _position);
+            _position = 0;
+            _stream.append(static_cast<const char *>(data), length);
+        }
+        if (_onReceive) {
+            _onReceive();
+        }
+    }
+    void feed(const std::string &data) { feed(data.data(), data.size()); }
+    void feed(const char *text) { feed(text, strlen(text)); }
+    std::string sent() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _sent;
+    }
+    void clearSent() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _sent.clear();
+    }
+    uint32_t baudRate() const { return _baudRate; }
+
+private:
+    std::mutex _mutex;
+    size_t _chunkSize;
+    std::string _stream;
+    size_t _position;
+    std::string _sent;
+    uint32_t _baudRate;
+    std::function<void()> _onReceive;
+};
+
+namespace fake {
+
+// Khung ASCII "ID:<id>,DATA:<data>,CRC:<8 chữ số hex in hoa>\n" như module Zigbee gửi
+inline std::string asciiFrame(const char *id, const char *data) {
+    char line[300];
+    int length = snprintf(line, sizeof(line), "ID:%s,DATA:%s", id, data);
+    uint32_t crc = Crc32::calculate(line, length);
+    snprintf(line + length, sizeof(line) - length, ",CRC:%08X\n", static_cast<unsigned>(crc));
+    return line;
+}
+
+} // namespace fake
+
+#endif // FAKE_SERIALLINK_H
@@ -0,0 +1,95 @@
+#ifndef FAKE_HARDWARESERIAL_H
+#define FAKE_HARDWARESERIAL_H
+
+#include "Arduino.h"
+#include <deque>
+#include <mutex>
+
+#define SERIAL_8N1 0x800001c
+
+/**
+ * UART giả: test đẩy byte vào bằng inject() (gọi callback onReceive như sự kiện
+ * UART thật), byte gửi đi được giữ trong sent().
+ */
+class HardwareSerial : public Stream
+{
+public:
+    explicit HardwareSerial(int uart) : _uart(uart), _baudRate(0), _rxBufferSize(256) {}
+
+    void begin(unsigned long baud, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) { _baudRate = baud; }
+    void end() {}
+    size_t setRxBufferSize(size_t size) { _rxBufferSize = size; return size; }
+    void onReceive(std::function<void(void)> callback, bool = false) { _onReceive = callback; }
+
+    int available() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return static_cast<int>(_rx.size());
+    }
+    int read() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_rx.empty()) {
+            return -1;
+        }
+        int c = _rx.front();
+        _rx.pop_front();
+        return c;
+    }
+    int peek() override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _rx.empty() ? -1 : _rx.front();
+    }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t length) override {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _tx.append(reinterpret_cast<const char *>(data), length);
+        return length;
+    }
+
+    // Phía test
+    void inject(const uint8_t *data, size_t length) {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _rx.insert(_rx.end(), data, data + length);
+        }
+        if (_onReceive) {
+            _onReceive();
+        }
+    }
+    void inject(const char *text) { inject(reinterpret_cast<const uint8_t *>(text), strlen(text)); }
+    std::string sent() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _tx;
+    }
+    void clearSent() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _tx.clear();
+    }
+    unsigned long baudRate() const { return _baudRate; }
+    size_t rxBufferSize() const { return _rxBufferSize; }
+
+private:
+    int _uart;
+    unsigned long _baudRate;
+    size_t _rxBufferSize;
+    std::mutex _mutex;
+    std::deque<uint8_t> _rx;
+    std::string _tx;
+    std::function<void(void)> _onReceive;
+};
+
+namespace fake {
+
+inline HardwareSerial &serial(int uart) {
+    static HardwareSerial serial0(0);
+    static HardwareSerial serial1(1);
+    static HardwareSerial serial2(2);
+    return uart == 1 ? serial1 : uart == 2 ? serial2 : serial0;
+}
+
+} // namespace fake
+
+#define Serial (fake::serial(0))
+#define Serial1 (fake::serial(1))
+#define Serial2 (fake::serial(2))
+
+#endif // FAKE_HARDWARESERIAL_H
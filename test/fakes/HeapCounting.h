@@ -0,0 +1,32 @@
+#ifndef HEAP_COUNTING_H
+#define HEAP_COUNTING_H
+
+/**
+ * Cho HeapTracker đếm cả new/delete trong env native: operator new của libstdc++
+ * nằm trong thư viện động nên không bị -Wl,--wrap=malloc bọc. Các hàm thay thế
+ * dưới đây gọi malloc/free của chương trình test.
+ *
+ * Chỉ include trong đúng một file .cpp của mỗi test (test_main.cpp).
+ */
+
+#include <new>
+#include <stdlib.h>
+#include <HeapTracker.h>
+
+void *operator new(size_t size) {
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return malloc(size > 0 ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return malloc(size > 0 ? size : 1); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+
+#endif // HEAP_COUNTING_H
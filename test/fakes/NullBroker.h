@@ -0,0 +1,95 @@
+#ifndef NULL_BROKER_H
+#define NULL_BROKER_H
+
+#include "Arduino.h"
+#include "Client.h"
+#include <atomic>
+
+/**
+ * Broker tối giản cho benchmark và test cấp phát: trả lời CONNACK và PUBACK,
+ * chỉ đếm gói và byte, không giữ lại nội dung nên không cấp phát. Mỗi lời gọi
+ * write() phải chứa trọn một gói (MqttPublisher ghi cả gói một lần); với
+ * PubSubClient chỉ header PUBLISH được nhận dạng, payload ghi sau được đếm byte.
+ */
+class NullBroker : public Client
+{
+public:
+    NullBroker() : _connected(false), _head(0), _tail(0), _bytes(0), _publishes(0) {}
+
+    int connect(IPAddress, uint16_t) override { return open(); }
+    int connect(const char *, uint16_t) override { return open(); }
+    int connect(IPAddress, uint16_t, int32_t) override { return open(); }
+    int connect(const char *, uint16_t, int32_t) override { return open(); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        if (!_connected) {
+            return 0;
+        }
+        _bytes += size;
+        uint8_t type = buffer[0] & 0xf0;
+        if (type == 0x10) {
+            reply(0x20, 0, 0);
+        } else if (type == 0x30 && size > 4) {
+            _publishes++;
+            if ((buffer[0] & 0x06) == 0x02) {
+                // Bỏ qua độ dài còn lại (1-4 byte) và topic để lấy packet id
+                size_t p = 1;
+                while (p < size && (buffer[p] & 0x80) != 0) {
+                    p++;
+                }
+                p++;
+                size_t topicLength = (buffer[p] << 8) | buffer[p + 1];
+                p += 2 + topicLength;
+                if (p + 1 < size) {
+                    reply(0x40, buffer[p], buffer[p + 1]);
+                }
+            }
+        }
+        return size;
+    }
+
+    int available() override { return static_cast<int>(_tail - _head); }
+    int read() override { return _head < _tail ? _outbound[_head++ % sizeof(_outbound)] : -1; }
+    int read(uint8_t *buffer, size_t size) override {
+        size_t count = 0;
+        while (count < size && _head < _tail) {
+            buffer[count++] = _outbound[_head++ % sizeof(_outbound)];
+        }
+        return static_cast<int>(count);
+    }
+    int peek() override { return _head < _tail ? _outbound[_head % sizeof(_outbound)] : -1; }
+    void flush() override {}
+    void stop() override { _connected = false; }
+    uint8_t connected() override { return _connected; }
+    operator bool() override { return _connected; }
+
+    uint64_t bytes() const { return _bytes; }
+    uint32_t publishes() const { return _publishes; }
+
+private:
+    int open() {
+        _connected = true;
+        _head = _tail = 0;
+        return 1;
+    }
+
+    void reply(uint8_t type, uint8_t a, uint8_t b) {
+        if (_tail - _head + 4 > sizeof(_outbound)) {
+            return;
+        }
+        _outbound[_tail++ % sizeof(_outbound)] = type;
+        _outbound[_tail++ % sizeof(_outbound)] = 2;
+        _outbound[_tail++ % sizeof(_outbound)] = a;
+        _outbound[_tail++ % sizeof(_outbound)] = b;
+    }
+
+    std::atomic<bool> _connected;
+    uint8_t _outbound[256];
+    size_t _head;
+    size_t _tail;
+    uint64_t _bytes;
+    uint32_t _publishes;
+};
+
+#endif // NULL_BROKER_H
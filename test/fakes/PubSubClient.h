@@ -0,0 +1,244 @@
+#ifndef FAKE_PUBSUBCLIENT_H
+#define FAKE_PUBSUBCLIENT_H
+
+#include "Arduino.h"
+#include "Client.h"
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+/**
+ * PubSubClient thu gọn cho env native: ghi/đọc gói MQTT 3.1.1 thật qua Client
+ * (QoS0 khi gửi, như thư viện gốc), để test chạy được với FakeBroker. Không
+ * chờ: connect() đọc CONNACK ngay sau khi ghi CONNECT, loop() chỉ xử lý các
+ * byte đang có.
+ */
+class PubSubClient : public Print
+{
+public:
+    explicit PubSubClient(Client &client)
+        : _client(&client), _host(nullptr), _port(1883), _state(MQTT_DISCONNECTED), _nextId(1), _keepAlive(15) {}
+
+    PubSubClient &setServer(const char *host, uint16_t port) {
+        _host = host;
+        _port = port;
+        return *this;
+    }
+    PubSubClient &setServer(IPAddress ip, uint16_t port) {
+        _host = nullptr;
+        _ip = ip;
+        _port = port;
+        return *this;
+    }
+    PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE) {
+        _callback = callback;
+        return *this;
+    }
+    PubSubClient &setSocketTimeout(uint16_t) { return *this; }
+    PubSubClient &setKeepAlive(uint16_t keepAlive) {
+        _keepAlive = keepAlive;
+        return *this;
+    }
+    bool setBufferSize(uint16_t) { return true; }
+
+    bool connect(const char *id, const char *user = nullptr, const char *pass = nullptr) {
+        // Như thư viện gốc: dùng lại kết nối TCP nếu Client đã kết nối
+        int ok = _client->connected() ? 1 : _host != nullptr ? _client->connect(_host, _port) : _client->connect(_ip, _port);
+        if (!ok) {
+            _state = MQTT_CONNECT_FAILED;
+            return false;
+        }
+
+        std::string body;
+        appendString(body, "MQTT");
+        body += static_cast<char>(4);
+        body += static_cast<char>(0x02 | (user != nullptr ? 0x80 : 0) | (pass != nullptr ? 0x40 : 0));
+        body += static_cast<char>(_keepAlive >> 8);
+        body += static_cast<char>(_keepAlive & 0xff);
+        appendString(body, id);
+        if (user != nullptr) {
+            appendString(body, user);
+        }
+        if (pass != nullptr) {
+            appendString(body, pass);
+        }
+        if (!writePacket(0x10, body)) {
+            _state = MQTT_CONNECTION_LOST;
+            return false;
+        }
+
+        uint8_t type;
+        std::string reply;
+        if (!readPacket(type, reply) || (type & 0xf0) != 0x20 || reply.size() != 2) {
+            _client->stop();
+            _state = MQTT_CONNECTION_TIMEOUT;
+            return false;
+        }
+        if (reply[1] != 0) {
+            _client->stop();
+            _state = static_cast<uint8_t>(reply[1]);
+            return false;
+        }
+        _state = MQTT_CONNECTED;
+        return true;
+    }
+
+    void disconnect() {
+        if (_state == MQTT_CONNECTED) {
+            writePacket(0xe0, std::string());
+        }
+        _client->stop();
+        _state = MQTT_DISCONNECTED;
+    }
+
+    boolean connected() {
+        if (_state == MQTT_CONNECTED && !_client->connected()) {
+            _state = MQTT_CONNECTION_LOST;
+        }
+        return _state == MQTT_CONNECTED;
+    }
+
+    int state() const { return _state; }
+
+    boolean subscribe(const char *topic, uint8_t qos = 0) {
+        if (!connected()) {
+            return false;
+        }
+        std::string body;
+        uint16_t id = _nextId++;
+        body += static_cast<char>(id >> 8);
+        body += static_cast<char>(id & 0xff);
+        appendString(body, topic);
+        body += static_cast<char>(qos);
+        return writePacket(0x82, body);
+    }
+
+    boolean loop() {
+        if (!connected()) {
+            return false;
+        }
+        while (_client->available() > 0) {
+            uint8_t type;
+            std::string body;
+            if (!readPacket(type, body)) {
+                break;
+            }
+            if ((type & 0xf0) == 0x30 && body.size() >= 2) {
+                size_t topicLength = (static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1]);
+                size_t offset = 2 + topicLength + (((type >> 1) & 0x03) > 0 ? 2 : 0);
+                if (offset > body.size()) {
+                    continue;
+                }
+                // Như thư viện gốc: topic kết thúc bằng '\0' trong bộ đệm, payload đứng sau
+                std::string topic = body.substr(2, topicLength);
+                std::string payload = body.substr(offset);
+                if (_callback) {
+                    _callback(&topic[0], reinterpret_cast<uint8_t *>(&payload[0]), static_cast<unsigned int>(payload.size()));
+                }
+            }
+        }
+        return connected();
+    }
+
+    boolean publish(const char *topic, const char *payload) {
+        size_t length = strlen(payload);
+        return beginPublish(topic, length, false) && write(reinterpret_cast<const uint8_t *>(payload), length) == length && endPublish();
+    }
+
+    boolean beginPublish(const char *topic, unsigned int length, boolean retained) {
+        if (!connected()) {
+            return false;
+        }
+        // Như thư viện gốc: header được dựng trong bộ đệm cố định, không cấp phát
+        size_t topicLength = strlen(topic);
+        if (topicLength + 7 > sizeof(_header)) {
+            return false;
+        }
+        size_t position = 0;
+        _header[position++] = 0x30 | (retained ? 1 : 0);
+        size_t remaining = 2 + topicLength + length;
+        do {
+            uint8_t digit = remaining % 128;
+            remaining /= 128;
+            _header[position++] = remaining > 0 ? digit | 0x80 : digit;
+        } while (remaining > 0);
+        _header[position++] = topicLength >> 8;
+        _header[position++] = topicLength & 0xff;
+        memcpy(_header + position, topic, topicLength);
+        position += topicLength;
+        return _client->write(_header, position) == position;
+    }
+
+    int endPublish() { return connected() ? 1 : 0; }
+
+    size_t write(uint8_t c) override { return _client->write(c); }
+    size_t write(const uint8_t *buffer, size_t size) override { return _client->write(buffer, size); }
+
+private:
+    static void appendString(std::string &out, const char *text) {
+        size_t length = strlen(text);
+        out += static_cast<char>(length >> 8);
+        out += static_cast<char>(length & 0xff);
+        out.append(text, length);
+    }
+
+    static void appendLength(std::string &out, size_t length) {
+        do {
+            uint8_t digit = length % 128;
+            length /= 128;
+            out += static_cast<char>(length > 0 ? digit | 0x80 : digit);
+        } while (length > 0);
+    }
+
+    bool writePacket(uint8_t type, const std::string &body) {
+        std::string packet;
+        packet += static_cast<char>(type);
+        appendLength(packet, body.size());
+        packet += body;
+        return _client->write(reinterpret_cast<const uint8_t *>(packet.data()), packet.size()) == packet.size();
+    }
+
+    bool readPacket(uint8_t &type, std::string &body) {
+        int c = _client->read();
+        if (c < 0) {
+            return false;
+        }
+        type = static_cast<uint8_t>(c);
+        size_t length = 0;
+        size_t multiplier = 1;
+        do {
+            c = _client->read();
+            if (c < 0) {
+                return false;
+            }
+            length += (c & 0x7f) * multiplier;
+            multiplier *= 128;
+        } while ((c & 0x80) != 0);
+        body.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            c = _client->read();
+            if (c < 0) {
+                return false;
+            }
+            body[i] = static_cast<char>(c);
+        }
+        return true;
+    }
+
+    Client *_client;
+    const char *_host;
+    IPAddress _ip;
+    uint16_t _port;
+    int _state;
+    uint16_t _nextId;
+    uint16_t _keepAlive;
+    uint8_t _header[256];
+    std::function<void(char *, uint8_t *, unsigned int)> _callback;
+};
+
+#endif // FAKE_PUBSUBCLIENT_H
@@ -0,0 +1,103 @@
+#ifndef FAKE_WIFI_H
+#define FAKE_WIFI_H
+
+#include "Arduino.h"
+#include "Client.h"
+#include "lwip/sockets.h"
+#include <atomic>
+
+#define WIFI_STA 1
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+    WL_NO_SHIELD = 255
+} wl_status_t;
+
+/**
+ * WiFi giả: begin() kết nối ngay (trừ khi test đặt status khác). DNS giả nằm
+ * trong lwip/dns.h.
+ */
+class WiFiClass
+{
+public:
+    WiFiClass() : _status(WL_DISCONNECTED), _connectOnBegin(true) {}
+
+    bool mode(int) { return true; }
+    wl_status_t begin(const char *, const char *) {
+        _status = _connectOnBegin ? WL_CONNECTED : WL_DISCONNECTED;
+        return _status;
+    }
+    bool disconnect(bool = false) {
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+    wl_status_t status() const { return _status; }
+    IPAddress localIP() const { return IPAddress(10, 0, 0, 100); }
+
+    // Phía test
+    void setStatus(wl_status_t status) { _status = status; }
+    void setConnectOnBegin(bool connect) { _connectOnBegin = connect; }
+
+private:
+    std::atomic<wl_status_t> _status;
+    bool _connectOnBegin;
+};
+
+namespace fake {
+
+inline WiFiClass &wifi() {
+    static WiFiClass instance;
+    return instance;
+}
+
+} // namespace fake
+
+#define WiFi (fake::wifi())
+
+/**
+ * WiFiClient giả: chuyển mọi thao tác cho fake::network() sau khi connect(), hoặc
+ * khi nhận một socket lwIP giả đã kết nối (WiFiClient(fd)).
+ */
+class WiFiClient : public Client
+{
+public:
+    WiFiClient() : _endpoint(nullptr) {}
+    explicit WiFiClient(int fd) : _endpoint(fake::takeSocket(fd) ? fake::network() : nullptr) {}
+
+    int connect(IPAddress ip, uint16_t port) override { return attach(fake::network() != nullptr && fake::network()->connect(ip, port)); }
+    int connect(const char *host, uint16_t port) override { return attach(fake::network() != nullptr && fake::network()->connect(host, port)); }
+    int connect(IPAddress ip, uint16_t port, int32_t) override { return connect(ip, port); }
+    int connect(const char *host, uint16_t port, int32_t) override { return connect(host, port); }
+    size_t write(uint8_t c) override { return _endpoint != nullptr ? _endpoint->write(c) : 0; }
+    size_t write(const uint8_t *buffer, size_t size) override { return _endpoint != nullptr ? _endpoint->write(buffer, size) : 0; }
+    int available() override { return _endpoint != nullptr ? _endpoint->available() : 0; }
+    int read() override { return _endpoint != nullptr ? _endpoint->read() : -1; }
+    int read(uint8_t *buffer, size_t size) override { return _endpoint != nullptr ? _endpoint->read(buffer, size) : -1; }
+    int peek() override { return _endpoint != nullptr ? _endpoint->peek() : -1; }
+    void flush() override {}
+    void stop() override {
+        if (_endpoint != nullptr) {
+            _endpoint->stop();
+            _endpoint = nullptr;
+        }
+    }
+    uint8_t connected() override { return _endpoint != nullptr && _endpoint->connected(); }
+    operator bool() override { return connected(); }
+    void setTimeout(uint32_t) {}
+
+private:
+    int attach(bool ok) {
+        _endpoint = ok ? fake::network() : nullptr;
+        return ok ? 1 : 0;
+    }
+
+    Client *_endpoint;
+};
+
+#endif // FAKE_WIFI_H
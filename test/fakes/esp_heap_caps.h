@@ -0,0 +1,13 @@
+#ifndef FAKE_ESP_HEAP_CAPS_H
+#define FAKE_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+// Heap của máy tính không đo được theo cách của ESP32: trả về giá trị cố định
+inline size_t heap_caps_get_free_size(unsigned) { return 200 * 1024; }
+inline size_t heap_caps_get_largest_free_block(unsigned) { return 100 * 1024; }
+inline size_t heap_caps_get_minimum_free_size(unsigned) { return 150 * 1024; }
+
+#endif // FAKE_ESP_HEAP_CAPS_H
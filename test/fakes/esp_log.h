@@ -0,0 +1,37 @@
+#ifndef FAKE_ESP_LOG_H
+#define FAKE_ESP_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+namespace fake {
+
+// Mặc định không in gì để kết quả test gọn; đặt biến môi trường FAKE_LOG=1 để xem log
+inline bool logEnabled() {
+    static const bool enabled = getenv("FAKE_LOG") != nullptr;
+    return enabled;
+}
+
+inline void log(char level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+inline void log(char level, const char *tag, const char *format, ...) {
+    if (!logEnabled()) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+} // namespace fake
+
+#define ESP_LOGE(tag, format, ...) fake::log('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fake::log('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fake::log('I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) fake::log('D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) fake::log('V', tag, format, ##__VA_ARGS__)
+
+#endif // FAKE_ESP_LOG_H
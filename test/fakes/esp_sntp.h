@@ -0,0 +1,32 @@
+#ifndef FAKE_ESP_SNTP_H
+#define FAKE_ESP_SNTP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+namespace fake {
+
+inline sntp_sync_time_cb_t &sntpCallback() {
+    static sntp_sync_time_cb_t callback = nullptr;
+    return callback;
+}
+
+// Giả lập một lần SNTP đồng bộ xong với thời gian epoch (ms)
+inline void sntpSync(uint64_t epochMs) {
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(epochMs / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(epochMs % 1000 * 1000);
+    if (sntpCallback() != nullptr) {
+        sntpCallback()(&tv);
+    }
+}
+
+} // namespace fake
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) { fake::sntpCallback() = callback; }
+inline void sntp_set_sync_interval(uint32_t) {}
+inline void configTime(long, int, const char *, const char * = nullptr, const char * = nullptr) {}
+
+#endif // FAKE_ESP_SNTP_H
@@ -0,0 +1,27 @@
+#ifndef FAKE_ESP_TIMER_H
+#define FAKE_ESP_TIMER_H
+
+#include <stdint.h>
+#include <atomic>
+
+namespace fake {
+
+/**
+ * Đồng hồ giả dùng chung cho millis(), micros(), esp_timer_get_time() và tick của
+ * FreeRTOS giả. Thời gian chỉ tiến khi test gọi advanceMs()/setMs(), hoặc khi
+ * một task giả ngủ (vTaskDelay, ulTaskNotifyTake hết hạn).
+ */
+inline std::atomic<uint64_t> &clockUs() {
+    static std::atomic<uint64_t> us(0);
+    return us;
+}
+
+inline void advanceMs(uint32_t ms) { clockUs().fetch_add(static_cast<uint64_t>(ms) * 1000); }
+inline void advanceUs(uint64_t us) { clockUs().fetch_add(us); }
+inline void setMs(uint64_t ms) { clockUs().store(ms * 1000); }
+
+} // namespace fake
+
+inline int64_t esp_timer_get_time() { return static_cast<int64_t>(fake::clockUs().load()); }
+
+#endif // FAKE_ESP_TIMER_H
@@ -0,0 +1,52 @@
+#ifndef FAKE_FREERTOS_H
+#define FAKE_FREERTOS_H
+
+/**
+ * FreeRTOS giả cho env native: chỉ đủ các API mà thư viện trong lib/ dùng.
+ * Task, semaphore và hàng đợi chạy trên std::thread/std::mutex của máy tính.
+ * Đơn vị tick là 1 ms, trùng với đồng hồ giả trong esp_timer.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <condition_variable>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define portNUM_PROCESSORS 2
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+// Spinlock của ESP-IDF đệ quy trên cùng core; ở đây là mutex đệ quy theo luồng
+struct portMUX_TYPE {
+    std::recursive_mutex mutex;
+};
+
+inline void portMUX_INITIALIZE(portMUX_TYPE *) {}
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+
+namespace fake {
+
+// Core của luồng hiện tại, đặt bằng xTaskCreatePinnedToCore hoặc setCore()
+inline BaseType_t &currentCore() {
+    static thread_local BaseType_t core = 0;
+    return core;
+}
+
+inline void setCore(BaseType_t core) { currentCore() = core; }
+
+} // namespace fake
+
+inline BaseType_t xPortGetCoreID() { return fake::currentCore(); }
+
+#endif // FAKE_FREERTOS_H
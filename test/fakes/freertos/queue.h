@@ -0,0 +1,66 @@
+#ifndef FAKE_FREERTOS_QUEUE_H
+#define FAKE_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+/**
+ * Hàng đợi giả: sao chép phần tử kích thước cố định như FreeRTOS.
+ * Thời gian chờ tính theo thời gian thật (1 tick = 1 ms).
+ */
+struct FakeQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+
+    FakeQueue(UBaseType_t queueLength, UBaseType_t size)
+        : storage(queueLength * size), length(queueLength), itemSize(size), head(0), count(0) {}
+};
+
+typedef FakeQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) { return new FakeQueue(length, itemSize); }
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    auto ready = [queue]() { return queue->count < queue->length; };
+    if (ticks == portMAX_DELAY) {
+        queue->cv.wait(lock, ready);
+    } else if (!queue->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) {
+        return pdFALSE;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    auto ready = [queue]() { return queue->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        queue->cv.wait(lock, ready);
+    } else if (!queue->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->mutex);
+    return queue->count;
+}
+
+#endif // FAKE_FREERTOS_QUEUE_H
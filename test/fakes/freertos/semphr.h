@@ -0,0 +1,82 @@
+#ifndef FAKE_FREERTOS_SEMPHR_H
+#define FAKE_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+#include <chrono>
+#include <thread>
+
+/**
+ * Semaphore giả: mutex (có thể đệ quy), binary và counting dùng chung một cấu trúc.
+ * Thời gian chờ tính theo thời gian thật (1 tick = 1 ms).
+ */
+struct FakeSemaphore {
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    bool isMutex;
+    bool recursive;
+    std::thread::id owner;
+    UBaseType_t depth;
+
+    FakeSemaphore(UBaseType_t initial, UBaseType_t max, bool mutexType, bool recursiveType)
+        : count(initial), maxCount(max), isMutex(mutexType), recursive(recursiveType), depth(0) {}
+};
+
+typedef FakeSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new FakeSemaphore(1, 1, true, false); }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new FakeSemaphore(1, 1, true, true); }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new FakeSemaphore(0, 1, false, false); }
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+    return new FakeSemaphore(initial, max, false, false);
+}
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    std::thread::id self = std::this_thread::get_id();
+    if (semaphore->recursive && semaphore->depth > 0 && semaphore->owner == self) {
+        semaphore->depth++;
+        return pdTRUE;
+    }
+    auto ready = [semaphore]() { return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->cv.wait(lock, ready);
+    } else if (!semaphore->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    if (semaphore->isMutex) {
+        semaphore->owner = self;
+        semaphore->depth = 1;
+    }
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> guard(semaphore->mutex);
+    if (semaphore->isMutex) {
+        if (semaphore->depth == 0 || semaphore->owner != std::this_thread::get_id()) {
+            return pdFALSE;
+        }
+        if (--semaphore->depth > 0) {
+            return pdTRUE;
+        }
+        semaphore->owner = std::thread::id();
+    }
+    if (semaphore->count >= semaphore->maxCount) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xSemaphoreTake(semaphore, ticks);
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) { return xSemaphoreGive(semaphore); }
+
+#endif // FAKE_FREERTOS_SEMPHR_H
@@ -0,0 +1,101 @@
+#ifndef FAKE_FREERTOS_TASK_H
+#define FAKE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include "../esp_timer.h"
+#include <chrono>
+#include <thread>
+
+// Task giả: chỉ giữ bộ đếm notification. Hàm task KHÔNG được chạy; test gọi
+// loop() của đối tượng trực tiếp hoặc tự tạo std::thread.
+struct FakeTask {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifications;
+    BaseType_t core;
+    const char *name;
+
+    FakeTask() : notifications(0), core(0), name("") {}
+};
+
+typedef FakeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+namespace fake {
+
+// Thời gian thật tối đa một task giả chờ notification trước khi coi là hết hạn
+static const uint32_t kMaxRealWaitMs = 20;
+
+// Tạo lười và không giải phóng: HeapTracker gọi hàm này ngay trong malloc, nên
+// chỉ dùng biến thread_local khởi tạo hằng (không cần hàm khởi tạo TLS)
+inline TaskHandle_t &currentTask() {
+    static thread_local TaskHandle_t handle = nullptr;
+    static thread_local bool creating = false;
+    if (handle == nullptr && !creating) {
+        creating = true;
+        handle = new FakeTask();
+        creating = false;
+    }
+    return handle;
+}
+
+} // namespace fake
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *name, uint32_t, void *, UBaseType_t,
+                                          TaskHandle_t *handle, BaseType_t core) {
+    // Cố ý không giải phóng: handle có thể còn được dùng tới cuối test
+    FakeTask *task = new FakeTask();
+    task->name = name;
+    task->core = core;
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return fake::currentTask(); }
+
+inline TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(esp_timer_get_time() / 1000); }
+
+inline void vTaskDelay(TickType_t ticks) {
+    fake::advanceMs(ticks);
+    std::this_thread::yield();
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) {
+    if (task == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(task->mutex);
+    task->notifications++;
+    task->cv.notify_all();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    xTaskNotifyGive(task);
+    if (woken != nullptr) {
+        *woken = pdFALSE;
+    }
+}
+
+// Hết hạn mà không có notification thì đồng hồ giả tiến thêm ticks
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (task->notifications == 0 && ticks > 0) {
+        uint32_t realMs = ticks < fake::kMaxRealWaitMs ? ticks : fake::kMaxRealWaitMs;
+        task->cv.wait_for(lock, std::chrono::milliseconds(realMs), [task]() { return task->notifications > 0; });
+        if (task->notifications == 0) {
+            fake::advanceMs(ticks);
+        }
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+#endif // FAKE_FREERTOS_TASK_H
@@ -0,0 +1,76 @@
+#ifndef FAKE_LWIP_DNS_H
+#define FAKE_LWIP_DNS_H
+
+#include <stdint.h>
+#include <string.h>
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#define LWIP_DNS_ADDRTYPE_IPV4 0
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+namespace fake {
+
+/**
+ * DNS giả: mặc định trả lời ngay (như khi tên đã có trong cache) một địa chỉ cố
+ * định và đếm số lần tra. holdDns(true) giữ câu trả lời tới khi answerDns(),
+ * failDns(true) làm mọi lần tra thất bại.
+ */
+struct Dns {
+    uint32_t address; // Thứ tự byte mạng
+    uint32_t lookups;
+    bool fail;
+    bool hold;
+    dns_found_callback pending;
+    void *pendingArg;
+    const char *pendingName;
+};
+
+inline Dns &dns() {
+    static Dns state = {0x0200000a, 0, false, false, nullptr, nullptr, nullptr}; // 10.0.0.2
+    return state;
+}
+
+inline uint32_t dnsLookups() { return dns().lookups; }
+inline void failDns(bool fail) { dns().fail = fail; }
+inline void holdDns(bool hold) { dns().hold = hold; }
+
+// Trả lời lần tra đang giữ (từ "task tcpip"), trả về false nếu không có
+inline bool answerDns() {
+    Dns &state = dns();
+    dns_found_callback callback = state.pending;
+    if (callback == nullptr) {
+        return false;
+    }
+    state.pending = nullptr;
+    ip_addr_t address;
+    memset(&address, 0, sizeof(address));
+    address.type = IPADDR_TYPE_V4;
+    address.u_addr.ip4.addr = state.address;
+    callback(state.pendingName, state.fail ? nullptr : &address, state.pendingArg);
+    return true;
+}
+
+} // namespace fake
+
+inline err_t dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *addr, dns_found_callback found,
+                                        void *callback_arg, uint8_t) {
+    fake::Dns &state = fake::dns();
+    state.lookups++;
+    if (state.hold) {
+        state.pending = found;
+        state.pendingArg = callback_arg;
+        state.pendingName = hostname;
+        return ERR_INPROGRESS;
+    }
+    if (state.fail) {
+        return ERR_ARG;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->type = IPADDR_TYPE_V4;
+    addr->u_addr.ip4.addr = state.address;
+    return ERR_OK;
+}
+
+#endif // FAKE_LWIP_DNS_H
@@ -0,0 +1,31 @@
+#ifndef FAKE_LWIP_IP_ADDR_H
+#define FAKE_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+// Như lwIP của ESP32 (bật IPv6): địa chỉ IPv4 nằm trong u_addr.ip4, thứ tự byte mạng
+typedef struct ip4_addr {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef struct ip6_addr {
+    uint32_t addr[4];
+    uint8_t zone;
+} ip6_addr_t;
+
+typedef struct ip_addr {
+    union {
+        ip6_addr_t ip6;
+        ip4_addr_t ip4;
+    } u_addr;
+    uint8_t type;
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_TYPE_V6 6U
+
+#define ip_2_ip4(ipaddr) (&((ipaddr)->u_addr.ip4))
+#define ip4_addr_get_u32(src_ipaddr) ((src_ipaddr)->addr)
+#define IP_IS_V4(ipaddr) ((ipaddr)->type == IPADDR_TYPE_V4)
+
+#endif // FAKE_LWIP_IP_ADDR_H
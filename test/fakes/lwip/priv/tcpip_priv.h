@@ -0,0 +1,18 @@
+#ifndef FAKE_LWIP_TCPIP_PRIV_H
+#define FAKE_LWIP_TCPIP_PRIV_H
+
+#include "lwip/err.h"
+
+struct tcpip_api_call_data {
+    err_t err;
+};
+
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data *call);
+
+// Không có task tcpip: lời gọi chạy ngay trong task gọi
+inline err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call) {
+    call->err = fn(call);
+    return call->err;
+}
+
+#endif // FAKE_LWIP_TCPIP_PRIV_H
@@ -0,0 +1,167 @@
+#ifndef FAKE_LWIP_SOCKETS_H
+#define FAKE_LWIP_SOCKETS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "Arduino.h"
+#include "Client.h"
+
+#define FAKE_SOCKET_COUNT 8
+#define FAKE_SOCKET_OFFSET 54 // Như LWIP_SOCKET_OFFSET của ESP32
+
+namespace fake {
+
+// Client mà mọi kết nối TCP tới (vd. FakeBroker), nullptr: không có mạng
+inline Client *&network() {
+    static Client *endpoint = nullptr;
+    return endpoint;
+}
+
+/**
+ * Socket lwIP giả trên fake::network(): connect() luôn trả về EINPROGRESS (như
+ * socket không chờ), kết quả có ngay ở select()/SO_ERROR trừ khi test gọi
+ * holdTcpConnect(true). Socket đã kết nối được WiFiClient(fd) nhận lại.
+ */
+struct Socket {
+    bool open;
+    bool connected; // Kết nối tới fake::network() thành công
+    bool nonBlocking;
+};
+
+inline Socket *socketAt(int fd) {
+    static Socket table[FAKE_SOCKET_COUNT];
+    int index = fd - FAKE_SOCKET_OFFSET;
+    return index >= 0 && index < FAKE_SOCKET_COUNT ? &table[index] : nullptr;
+}
+
+inline bool &tcpConnectHeld() {
+    static bool held = false;
+    return held;
+}
+
+inline void holdTcpConnect(bool hold) { tcpConnectHeld() = hold; }
+
+inline uint32_t openSockets() {
+    uint32_t count = 0;
+    for (int fd = FAKE_SOCKET_OFFSET; fd < FAKE_SOCKET_OFFSET + FAKE_SOCKET_COUNT; fd++) {
+        count += socketAt(fd)->open;
+    }
+    return count;
+}
+
+// WiFiClient(fd) nhận socket: true nếu socket đã kết nối
+inline bool takeSocket(int fd) {
+    Socket *socket = socketAt(fd);
+    if (socket == nullptr || !socket->open) {
+        return false;
+    }
+    socket->open = false;
+    return socket->connected;
+}
+
+} // namespace fake
+
+inline int lwip_socket(int, int, int) {
+    for (int fd = FAKE_SOCKET_OFFSET; fd < FAKE_SOCKET_OFFSET + FAKE_SOCKET_COUNT; fd++) {
+        fake::Socket *socket = fake::socketAt(fd);
+        if (!socket->open) {
+            socket->open = true;
+            socket->connected = false;
+            socket->nonBlocking = false;
+            return fd;
+        }
+    }
+    errno = ENFILE;
+    return -1;
+}
+
+inline int lwip_fcntl(int s, int cmd, int val) {
+    fake::Socket *socket = fake::socketAt(s);
+    if (socket == nullptr || !socket->open) {
+        errno = EBADF;
+        return -1;
+    }
+    if (cmd == F_GETFL) {
+        return socket->nonBlocking ? O_NONBLOCK : 0;
+    }
+    if (cmd == F_SETFL) {
+        socket->nonBlocking = (val & O_NONBLOCK) != 0;
+    }
+    return 0;
+}
+
+inline int lwip_setsockopt(int s, int, int, const void *, socklen_t) {
+    fake::Socket *socket = fake::socketAt(s);
+    return socket != nullptr && socket->open ? 0 : -1;
+}
+
+inline int lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen) {
+    fake::Socket *socket = fake::socketAt(s);
+    if (socket == nullptr || !socket->open) {
+        errno = EBADF;
+        return -1;
+    }
+    if (level == SOL_SOCKET && optname == SO_ERROR && *optlen >= sizeof(int)) {
+        *static_cast<int *>(optval) = socket->connected ? 0 : ECONNREFUSED;
+        *optlen = sizeof(int);
+    }
+    return 0;
+}
+
+inline int lwip_connect(int s, const struct sockaddr *name, socklen_t) {
+    fake::Socket *socket = fake::socketAt(s);
+    if (socket == nullptr || !socket->open) {
+        errno = EBADF;
+        return -1;
+    }
+    const struct sockaddr_in *address = reinterpret_cast<const struct sockaddr_in *>(name);
+    IPAddress ip(static_cast<uint32_t>(address->sin_addr.s_addr));
+    socket->connected = fake::network() != nullptr && fake::network()->connect(ip, ntohs(address->sin_port));
+    errno = EINPROGRESS;
+    return -1;
+}
+
+// Chỉ kiểm tra ghi được (kết nối xong); không bao giờ chờ
+inline int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *) {
+    int ready = 0;
+    for (int fd = 0; fd < maxfdp1; fd++) {
+        if (readset != nullptr) {
+            FD_CLR(fd, readset);
+        }
+        if (exceptset != nullptr) {
+            FD_CLR(fd, exceptset);
+        }
+        if (writeset == nullptr || !FD_ISSET(fd, writeset)) {
+            continue;
+        }
+        fake::Socket *socket = fake::socketAt(fd);
+        if (socket != nullptr && socket->open && !fake::tcpConnectHeld()) {
+            ready++;
+        } else {
+            FD_CLR(fd, writeset);
+        }
+    }
+    return ready;
+}
+
+inline int lwip_close(int s) {
+    fake::Socket *socket = fake::socketAt(s);
+    if (socket == nullptr || !socket->open) {
+        errno = EBADF;
+        return -1;
+    }
+    socket->open = false;
+    if (socket->connected && fake::network() != nullptr) {
+        fake::network()->stop();
+    }
+    return 0;
+}
+
+#endif // FAKE_LWIP_SOCKETS_H
@@ -0,0 +1,149 @@
+/**
+ * CRC32 của khung tin: bảng tra slice-by-4 (Crc32) so với cách tính từng bit của
+ * bản gốc, và kiểm tra chuỗi CRC nhận được đúng như giao thức ("%08X").
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <Benchmark.h>
+#include <FakeSerialLink.h>
+#include "Crc32.h"
+#include "ZigbeeServer.h"
+
+static bench::Suite suite("crc32");
+
+// Cách tính của bản gốc (từng bit), dùng làm chuẩn so sánh
+static uint32_t bitwiseCrc32(const char *data, size_t length) {
+    uint32_t crc = 0xffffffff;
+    while (length--) {
+        uint8_t c = *data++;
+        for (uint32_t i = 0x80; i > 0; i >>= 1) {
+            bool bit = crc & 0x80000000;
+            if (c & i) {
+                bit = !bit;
+            }
+            crc <<= 1;
+            if (bit) {
+                crc ^= 0x04c11db7;
+            }
+        }
+    }
+    return ~crc;
+}
+
+static std::string randomBytes(size_t length) {
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; i++) {
+        data[i] = static_cast<char>(esp_random());
+    }
+    return data;
+}
+
+void setUp() { fake::seedRandom(1); }
+void tearDown() {}
+
+void test_table_matches_bitwise() {
+    for (size_t length = 0; length < 300; length += 7) {
+        std::string data = randomBytes(length);
+        uint32_t expected = bitwiseCrc32(data.data(), data.size());
+        TEST_ASSERT_EQUAL_HEX32(expected, Crc32::calculate(data.data(), data.size()));
+
+        // Cập nhật từng byte như khi nhận UART, cắt ở vị trí bất kỳ
+        Crc32 crc;
+        size_t split = length / 3;
+        for (size_t i = 0; i < split; i++) {
+            crc.update(static_cast<uint8_t>(data[i]));
+        }
+        crc.update(data.data() + split, length - split);
+        TEST_ASSERT_EQUAL_HEX32(expected, crc.value());
+    }
+}
+
+void test_matches_hex_requires_eight_uppercase_digits() {
+    uint32_t crc = 0x0a1b2c3d;
+    TEST_ASSERT_TRUE(Crc32::matchesHex("0A1B2C3D", 8, crc));
+    // Ký tự sau ký tự thứ 8 bị bỏ qua như bản gốc (substr(0, 8))
+    TEST_ASSERT_TRUE(Crc32::matchesHex("0A1B2C3D\r", 9, crc));
+    TEST_ASSERT_FALSE(Crc32::matchesHex("0a1b2c3d", 8, crc));
+    TEST_ASSERT_FALSE(Crc32::matchesHex("A1B2C3D", 7, 0x0a1b2c3d));
+    TEST_ASSERT_FALSE(Crc32::matchesHex("", 0, 0));
+    TEST_ASSERT_FALSE(Crc32::matchesHex("0A1B2C3E", 8, crc));
+}
+
+void test_server_rejects_lowercase_and_short_crc() {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    uint32_t messages = 0;
+    server.onMessage([&](const char *, const char *) { messages++; });
+
+    std::string valid = fake::asciiFrame("dev1", "temp:21.5");
+    size_t crc = valid.find(",CRC:") + 5;
+    std::string lower = valid;
+    for (size_t i = crc; i < crc + 8; i++) {
+        lower[i] = tolower(lower[i]);
+    }
+    std::string shortCrc = valid.substr(0, crc) + valid.substr(crc + 1);
+    TEST_ASSERT_TRUE(lower != valid); // CRC của khung này có chữ A-F
+
+    link.feed(lower);
+    link.feed(shortCrc);
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, messages);
+
+    link.feed(valid);
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(1, messages);
+}
+
+static void compare(const char *name, size_t length, uint32_t iterations) {
+    std::string data = randomBytes(length);
+    char label[64];
+
+    snprintf(label, sizeof(label), "bitwise.%s", name);
+    double bitwiseNs = suite.run(label, iterations, [&]() { bench::keep(bitwiseCrc32(data.data(), data.size())); });
+    snprintf(label, sizeof(label), "bitwise.%s_MBps", name);
+    suite.record(label, "MB/s", length * 1e3 / bitwiseNs);
+
+    snprintf(label, sizeof(label), "table.%s", name);
+    double tableNs = suite.run(label, iterations, [&]() { bench::keep(Crc32::calculate(data.data(), data.size())); });
+    snprintf(label, sizeof(label), "table.%s_MBps", name);
+    suite.record(label, "MB/s", length * 1e3 / tableNs);
+    snprintf(label, sizeof(label), "table.%s_speedup", name);
+    suite.record(label, "x", bitwiseNs / tableNs);
+
+    TEST_ASSERT_TRUE(tableNs < bitwiseNs);
+}
+
+void test_bench_frame_sized() { compare("frame_64B", 64, 100000); }
+
+void test_bench_block() { compare("block_4KB", 4096, 2000); }
+
+void test_bench_frames_per_second() {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    std::string frame = fake::asciiFrame("0x00124B0001A2B3C4", "temp:21.5,hum:40.2,bat:87");
+    std::string burst;
+    for (int i = 0; i < 16; i++) {
+        burst += frame;
+    }
+    double ns = suite.run("server.burst_16_frames", 2000, [&]() {
+        link.feed(burst);
+        server.loop();
+    });
+    suite.record("server.frames_per_second", "frames/s", 16e9 / ns);
+}
+
+void test_compare_baseline() { TEST_ASSERT_TRUE_MESSAGE(suite.finish(), "no baseline or allocs/op regressed, see [bench] lines"); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_bitwise);
+    RUN_TEST(test_matches_hex_requires_eight_uppercase_digits);
+    RUN_TEST(test_server_rejects_lowercase_and_short_crc);
+    RUN_TEST(test_bench_frame_sized);
+    RUN_TEST(test_bench_block);
+    RUN_TEST(test_bench_frames_per_second);
+    RUN_TEST(test_compare_baseline);
+    return UNITY_END();
+}
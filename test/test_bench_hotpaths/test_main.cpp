@@ -0,0 +1,179 @@
+/**
+ * Benchmark các đường xử lý nóng trên máy tính (env native): kiểm tra CRC32 của
+ * khung tin, xử lý khung tin trong ZigbeeServer, giải mã trường DATA, mã hóa
+ * metric trong PEClient và kích thước một gói metric khi mã hóa JSON so với
+ * MessagePack. Kết quả và so sánh baseline: xem test/README.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <Benchmark.h>
+#include <FakeSerialLink.h>
+#include <NullBroker.h>
+#include <WiFi.h>
+#include "Crc32.h"
+#include "DataDecoder.h"
+#include "ZigbeeServer.h"
+#include "PEClient.h"
+
+#define BENCH_ITERATIONS 20000
+
+static const DataField dataSchema[] = {
+    {"temp", DATA_NUMBER, 1.0f, "C"},
+    {"hum", DATA_NUMBER, 1.0f, "%"},
+    {"bat", DATA_NUMBER, 1.0f, "%"},
+    {"volt", DATA_NUMBER, 1.0f, "V"},
+    {"rssi", DATA_INT, 1.0f, "dBm"},
+    {"lqi", DATA_INT, 1.0f, ""},
+    {"state", DATA_BOOL, 1.0f, ""},
+    {"led", DATA_BOOL, 1.0f, ""},
+};
+
+static const char *kData = "temp:21.5,hum:40.2,bat:87,volt:3.01,rssi:-67,lqi:180,state:on";
+
+static bench::Suite suite("hotpaths");
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc32_frame() {
+    std::string frame = fake::asciiFrame("0x00124B0001A2B3C4", kData);
+    size_t covered = frame.find(",CRC:");
+    uint32_t crc = 0;
+    suite.run("crc32.calculate_frame", BENCH_ITERATIONS, [&]() {
+        crc = Crc32::calculate(frame.data(), covered);
+        bench::keep(crc);
+    });
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08X", static_cast<unsigned>(crc));
+    TEST_ASSERT_EQUAL_STRING(hex, frame.substr(covered + 5, 8).c_str());
+}
+
+static void runFrames(const char *name, bool validCrc) {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    uint32_t messages = 0;
+    server.onMessage([&](const char *, const char *) { messages++; });
+    server.begin();
+    server.loop();
+
+    std::string frame = fake::asciiFrame("0x00124B0001A2B3C4", kData);
+    if (!validCrc) {
+        frame[frame.size() - 2] = frame[frame.size() - 2] == '0' ? '1' : '0';
+    }
+    // Đếm trong từng lần lặp để không phụ thuộc số lần làm nóng của Benchmark.h
+    uint32_t expected = validCrc ? 1 : 0;
+    uint32_t mismatches = 0;
+    suite.run(name, BENCH_ITERATIONS, [&]() {
+        uint32_t before = messages;
+        link.feed(frame);
+        server.loop();
+        mismatches += messages - before != expected;
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+}
+
+void test_handle_incoming_message() { runFrames("zigbee.handle_frame", true); }
+
+void test_handle_bad_crc() { runFrames("zigbee.handle_bad_crc", false); }
+
+void test_collect_data_decode() {
+    DataDecoder decoder(dataSchema, sizeof(dataSchema) / sizeof(dataSchema[0]));
+    double sum = 0;
+    size_t decoded = 0;
+    suite.run("decoder.collect_data", BENCH_ITERATIONS, [&]() {
+        decoded = decoder.decode(kData, [&](const DataValue &value) { sum += value.value; });
+    });
+    bench::keep(sum);
+    TEST_ASSERT_EQUAL_UINT32(7, decoded);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.errors());
+}
+
+static void runSendMetric(PEClient::PayloadCodec codec, const char *name) {
+    NullBroker broker;
+    fake::network() = &broker;
+    PEClient client("ssid", "pass", "broker.local", 1883, "gw", "user", "token");
+    client.setCodec(codec);
+    client.begin();
+    client.loop();
+    client.loop();
+    TEST_ASSERT_TRUE(client.connected());
+
+    uint64_t ts = 1718000000000ULL;
+    uint32_t unsent = 0;
+    suite.run(name, BENCH_ITERATIONS, [&]() {
+        uint32_t before = broker.publishes();
+        client.sendMetric(ts++, "temp_0x00124B0001A2B3C4", 21.5);
+        unsent += broker.publishes() - before != 1;
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, unsent);
+    fake::network() = nullptr;
+}
+
+void test_send_metric_json() { runSendMetric(PEClient::CODEC_JSON, "peclient.send_metric_json"); }
+
+void test_send_metric_msgpack() { runSendMetric(PEClient::CODEC_MSGPACK, "peclient.send_metric_msgpack"); }
+
+// Gói metric điển hình: 4 thiết bị, mỗi khung tin 5 thông số cùng ts
+static void buildBatch(JsonDocument &doc) {
+    static const char *devices[] = {"0x00124B0001A2B3C4", "0x00124B0001A2B3C5", "0x00124B0001A2B3C6", "0x00124B0001A2B3C7"};
+    static const char *keys[] = {"temp", "hum", "bat", "volt", "rssi"};
+    static const double values[] = {21.5, 40.2, 87, 3.01, -67};
+    JsonArray groups = doc.to<JsonArray>();
+    for (int d = 0; d < 4; d++) {
+        JsonObject group = groups.add<JsonObject>();
+        group["ts"] = 1718000000000ULL + d * 250;
+        JsonObject metrics = group["metrics"].to<JsonObject>();
+        for (int k = 0; k < 5; k++) {
+            char name[48];
+            snprintf(name, sizeof(name), "%s_%s", keys[k], devices[d]);
+            metrics[name] = values[k] + d;
+        }
+    }
+}
+
+static size_t measureBatch(PEClient::PayloadCodec codec, const char *name) {
+    PEClient client("ssid", "pass", "broker.local", 1883, "gw", "user", "token");
+    client.setCodec(codec);
+    JsonArena<PECLIENT_BATCH_ARENA_SIZE> arena;
+    JsonDocument doc(&arena);
+    buildBatch(doc);
+    TEST_ASSERT_FALSE(doc.overflowed());
+
+    size_t length = client.measureDocument(doc);
+    char label[64];
+    snprintf(label, sizeof(label), "%s.batch_bytes_per_metric", name);
+    suite.record(label, "B", length / 20.0);
+
+    char payload[1024];
+    TEST_ASSERT_TRUE(length < sizeof(payload));
+    snprintf(label, sizeof(label), "%s.encode_batch", name);
+    suite.run(label, BENCH_ITERATIONS, [&]() {
+        client.serializeDocument(doc, payload, length + 1);
+        bench::keep(payload);
+    });
+    return length;
+}
+
+void test_payload_size() {
+    size_t json = measureBatch(PEClient::CODEC_JSON, "json");
+    size_t msgpack = measureBatch(PEClient::CODEC_MSGPACK, "msgpack");
+    suite.record("msgpack.batch_size_ratio", "x", static_cast<double>(msgpack) / json);
+    TEST_ASSERT_TRUE(msgpack < json);
+}
+
+void test_compare_baseline() { TEST_ASSERT_TRUE_MESSAGE(suite.finish(), "no baseline or allocs/op regressed, see [bench] lines"); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_frame);
+    RUN_TEST(test_handle_incoming_message);
+    RUN_TEST(test_handle_bad_crc);
+    RUN_TEST(test_collect_data_decode);
+    RUN_TEST(test_send_metric_json);
+    RUN_TEST(test_send_metric_msgpack);
+    RUN_TEST(test_payload_size);
+    RUN_TEST(test_compare_baseline);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+/**
+ * Khung nhị phân trên UART: COBS, TLV/CRC của BinaryFrame, luồng trộn ASCII và
+ * nhị phân trong FrameParser, và so sánh kích thước/tốc độ xử lý một khung dữ
+ * liệu giữa hai định dạng.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <Benchmark.h>
+#include <FakeSerialLink.h>
+#include "BinaryFrame.h"
+#include "DataDecoder.h"
+#include "FrameParser.h"
+#include "ZigbeeServer.h"
+
+#define BENCH_ITERATIONS 20000
+
+static const char *kDeviceId = "0x00124B0001A2B3C4";
+static const char *kData = "temp:21.5,hum:40.2,bat:87,volt:3.01";
+
+static const DataField dataSchema[] = {
+    {"temp", DATA_NUMBER, 1.0f, "C"},
+    {"hum", DATA_NUMBER, 1.0f, "%"},
+    {"bat", DATA_NUMBER, 1.0f, "%"},
+    {"volt", DATA_NUMBER, 1.0f, "V"},
+};
+
+static bench::Suite suite("binary_frame");
+
+// Khung nhị phân TYPE_DATA với cùng các giá trị như kData
+static std::string binaryFrame(const char *id) {
+    uint8_t payload[128];
+    uint8_t wire[160];
+    BinaryFrame::Writer writer(payload, sizeof(payload), BinaryFrame::TYPE_DATA);
+    writer.addString(BinaryFrame::TAG_DEVICE_ID, id);
+    writer.addReading("temp", 21.5f);
+    writer.addReading("hum", 40.2f);
+    writer.addReading("bat", 87.0f);
+    writer.addReading("volt", 3.01f);
+    size_t length = writer.finish(wire, sizeof(wire));
+    return std::string(reinterpret_cast<const char *>(wire), length);
+}
+
+void setUp() { fake::seedRandom(1); }
+void tearDown() {}
+
+void test_cobs_round_trip() {
+    uint8_t input[600];
+    uint8_t encoded[610];
+    for (size_t length = 0; length <= sizeof(input); length += 13) {
+        for (size_t i = 0; i < length; i++) {
+            // Một phần ba số byte là 0x00, có cả các đoạn dài hơn 254 byte không có 0x00
+            uint32_t r = esp_random();
+            input[i] = length > 300 && i < 280 ? static_cast<uint8_t>(r | 1) : r % 3 == 0 ? 0 : static_cast<uint8_t>(r);
+        }
+        size_t encodedLength = BinaryFrame::cobsEncode(input, length, encoded);
+        TEST_ASSERT_TRUE(encodedLength <= length + length / 254 + 1);
+        TEST_ASSERT_TRUE(memchr(encoded, 0, encodedLength) == nullptr);
+
+        size_t decodedLength = 0;
+        TEST_ASSERT_TRUE(BinaryFrame::cobsDecode(encoded, encodedLength, decodedLength));
+        TEST_ASSERT_EQUAL_UINT32(length, decodedLength);
+        TEST_ASSERT_TRUE(memcmp(input, encoded, length) == 0);
+    }
+
+    uint8_t invalid[] = {0x05, 'a', 'b'};
+    size_t decodedLength = 0;
+    TEST_ASSERT_FALSE(BinaryFrame::cobsDecode(invalid, sizeof(invalid), decodedLength));
+}
+
+void test_writer_reader_round_trip() {
+    std::string wire = binaryFrame("dev1");
+    TEST_ASSERT_EQUAL_UINT8(BinaryFrame::kDelimiter, wire[0]);
+    TEST_ASSERT_EQUAL_UINT8(BinaryFrame::kDelimiter, wire[wire.size() - 1]);
+
+    uint8_t buffer[160];
+    memcpy(buffer, wire.data() + 1, wire.size() - 2);
+    size_t length = 0;
+    TEST_ASSERT_TRUE(BinaryFrame::cobsDecode(buffer, wire.size() - 2, length));
+
+    BinaryFrame::Reader reader(buffer, length);
+    TEST_ASSERT_TRUE(reader.valid());
+    TEST_ASSERT_EQUAL_UINT8(BinaryFrame::TYPE_DATA, reader.type());
+
+    uint8_t tag;
+    const uint8_t *value;
+    uint8_t valueLength;
+    TEST_ASSERT_TRUE(reader.next(tag, value, valueLength));
+    TEST_ASSERT_EQUAL_UINT8(BinaryFrame::TAG_DEVICE_ID, tag);
+    TEST_ASSERT_EQUAL_UINT8(4, valueLength);
+    TEST_ASSERT_TRUE(memcmp(value, "dev1", 4) == 0);
+
+    const char *keys[] = {"temp", "hum", "bat", "volt"};
+    const float values[] = {21.5f, 40.2f, 87.0f, 3.01f};
+    for (int i = 0; i < 4; i++) {
+        const char *key;
+        uint8_t keyLength;
+        float reading;
+        TEST_ASSERT_TRUE(reader.next(tag, value, valueLength));
+        TEST_ASSERT_EQUAL_UINT8(BinaryFrame::TAG_READING, tag);
+        TEST_ASSERT_TRUE(BinaryFrame::Reader::parseReading(value, valueLength, key, keyLength, reading));
+        TEST_ASSERT_EQUAL_UINT8(strlen(keys[i]), keyLength);
+        TEST_ASSERT_TRUE(memcmp(key, keys[i], keyLength) == 0);
+        TEST_ASSERT_TRUE(reading == values[i]);
+    }
+    TEST_ASSERT_FALSE(reader.next(tag, value, valueLength));
+
+    // Một bit sai trong payload: CRC không khớp
+    buffer[3] ^= 0x01;
+    TEST_ASSERT_FALSE(BinaryFrame::Reader(buffer, length).valid());
+}
+
+void test_parser_mixed_stream() {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    uint32_t messages = 0;
+    uint32_t readings = 0;
+    server.onMessage([&](const char *, const char *) { messages++; });
+    server.onReading([&](const char *id, const char *, double) {
+        TEST_ASSERT_EQUAL_STRING("dev2", id);
+        readings++;
+    });
+
+    std::string ascii = fake::asciiFrame("dev1", kData);
+    std::string binary = binaryFrame("dev2");
+    link.feed(ascii + binary + ascii + binary + binary + ascii);
+    server.loop();
+
+    TEST_ASSERT_EQUAL_UINT32(3, messages);
+    TEST_ASSERT_EQUAL_UINT32(3 * 4, readings);
+    TEST_ASSERT_EQUAL_UINT32(0, server.truncatedLines());
+    TEST_ASSERT_EQUAL_UINT8(WIRE_ASCII, server.devices().at(server.devices().find("dev1")).wireFormat);
+    TEST_ASSERT_EQUAL_UINT8(WIRE_BINARY, server.devices().at(server.devices().find("dev2")).wireFormat);
+}
+
+void test_stray_zero_returns_to_ascii() {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    uint32_t messages = 0;
+    server.onMessage([&](const char *, const char *) { messages++; });
+
+    std::string frame = fake::asciiFrame("dev1", "temp:21.5");
+    link.feed(frame);
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(1, messages);
+
+    // Một byte 0x00 nhiễu (UART break) giữa các dòng ASCII
+    link.feed(std::string(1, '\0'));
+    for (int i = 0; i < 50; i++) {
+        link.feed(frame);
+        server.loop();
+    }
+
+    // Chỉ các dòng nằm trong khung nhị phân giả bị mất, các dòng sau nhận bình thường
+    uint32_t lost = FrameParser::kMaxLineLength / frame.size() + 1;
+    TEST_ASSERT_EQUAL_UINT32(1 + 50 - lost, messages);
+    TEST_ASSERT_EQUAL_UINT32(1, server.binaryOverruns());
+    TEST_ASSERT_EQUAL_UINT32(1, server.truncatedLines());
+
+    // Khung nhị phân thật vẫn được nhận sau đó
+    uint32_t readings = 0;
+    server.onReading([&](const char *, const char *, double) { readings++; });
+    link.feed(binaryFrame("dev2"));
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(4, readings);
+}
+
+void test_bench_ascii_vs_binary() {
+    std::string ascii = fake::asciiFrame(kDeviceId, kData);
+    std::string binary = binaryFrame(kDeviceId);
+    suite.record("ascii.frame_bytes", "B", ascii.size());
+    suite.record("binary.frame_bytes", "B", binary.size());
+    TEST_ASSERT_TRUE(binary.size() < ascii.size());
+
+    // ASCII: tách khung, kiểm tra CRC hex rồi giải mã trường DATA thành số
+    FakeSerialLink asciiLink;
+    ZigbeeServer asciiServer(asciiLink);
+    DataDecoder decoder(dataSchema, sizeof(dataSchema) / sizeof(dataSchema[0]));
+    uint32_t asciiValues = 0;
+    asciiServer.onMessage([&](const char *, const char *data) {
+        asciiValues += decoder.decode(data, [](const DataValue &) {});
+    });
+    double asciiNs = suite.run("ascii.handle_frame", BENCH_ITERATIONS, [&]() {
+        asciiLink.feed(ascii);
+        asciiServer.loop();
+    });
+
+    // Nhị phân: giải mã COBS, kiểm tra CRC, giá trị float có sẵn trong TLV
+    FakeSerialLink binaryLink;
+    ZigbeeServer binaryServer(binaryLink);
+    uint32_t binaryValues = 0;
+    binaryServer.onReading([&](const char *, const char *, double) { binaryValues++; });
+    double binaryNs = suite.run("binary.handle_frame", BENCH_ITERATIONS, [&]() {
+        binaryLink.feed(binary);
+        binaryServer.loop();
+    });
+
+    suite.record("ascii.frames_per_second", "frames/s", 1e9 / asciiNs);
+    suite.record("binary.frames_per_second", "frames/s", 1e9 / binaryNs);
+    suite.record("binary.speedup", "x", asciiNs / binaryNs);
+    TEST_ASSERT_TRUE(asciiValues > 0);
+    TEST_ASSERT_EQUAL_UINT32(asciiValues, binaryValues);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.errors());
+}
+
+void test_compare_baseline() { TEST_ASSERT_TRUE_MESSAGE(suite.finish(), "no baseline or allocs/op regressed, see [bench] lines"); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_cobs_round_trip);
+    RUN_TEST(test_writer_reader_round_trip);
+    RUN_TEST(test_parser_mixed_stream);
+    RUN_TEST(test_stray_zero_returns_to_ascii);
+    RUN_TEST(test_bench_ascii_vs_binary);
+    RUN_TEST(test_compare_baseline);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+/**
+ * Thiết bị vào/rời mạng: DeviceChangeSet gom thay đổi (debounce theo quietMs và
+ * maxDelayMs) và ZigbeeServer đánh dấu đúng thiết bị, với trạng thái cuối cùng
+ * khi drain().
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <FakeSerialLink.h>
+#include <vector>
+#include "DeviceChangeSet.h"
+#include "ZigbeeServer.h"
+
+#define QUIET_MS 2000
+#define MAX_DELAY_MS 10000
+
+void setUp() {}
+void tearDown() {}
+
+void test_waits_for_quiet_period() {
+    DeviceChangeSet changes(64);
+    TEST_ASSERT_FALSE(changes.ready(0, QUIET_MS, MAX_DELAY_MS));
+
+    changes.mark(3, 1000);
+    TEST_ASSERT_FALSE(changes.ready(2000, QUIET_MS, MAX_DELAY_MS));
+    // Thay đổi mới lùi thời điểm gửi
+    changes.mark(40, 2500);
+    TEST_ASSERT_FALSE(changes.ready(4000, QUIET_MS, MAX_DELAY_MS));
+    TEST_ASSERT_TRUE(changes.ready(4500, QUIET_MS, MAX_DELAY_MS));
+
+    std::vector<size_t> seen;
+    TEST_ASSERT_EQUAL_UINT32(2, changes.drain([&](size_t index) { seen.push_back(index); }));
+    TEST_ASSERT_EQUAL_UINT32(3, seen[0]);
+    TEST_ASSERT_EQUAL_UINT32(40, seen[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, changes.pending());
+    TEST_ASSERT_FALSE(changes.ready(100000, QUIET_MS, MAX_DELAY_MS));
+}
+
+void test_max_delay_bounds_continuous_changes() {
+    DeviceChangeSet changes(64);
+    // Một thay đổi mỗi giây: không bao giờ im lặng đủ QUIET_MS
+    unsigned long now = 1000;
+    for (; now < 1000 + MAX_DELAY_MS; now += 1000) {
+        changes.mark(now / 1000 % 8, now);
+        TEST_ASSERT_FALSE(changes.ready(now, QUIET_MS, MAX_DELAY_MS));
+    }
+    changes.mark(0, now);
+    TEST_ASSERT_TRUE(changes.ready(now, QUIET_MS, MAX_DELAY_MS));
+
+    // Cùng thiết bị đổi nhiều lần chỉ được báo một lần
+    TEST_ASSERT_EQUAL_UINT32(8, changes.pending());
+    TEST_ASSERT_EQUAL_UINT32(8, changes.drain([](size_t) {}));
+
+    // Sau khi gửi, đợt thay đổi mới tính lại từ đầu
+    changes.mark(5, now + 100);
+    TEST_ASSERT_FALSE(changes.ready(now + 1000, QUIET_MS, MAX_DELAY_MS));
+    TEST_ASSERT_TRUE(changes.ready(now + 100 + QUIET_MS, QUIET_MS, MAX_DELAY_MS));
+}
+
+void test_server_reports_join_and_leave() {
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    server.setPollInterval(1000);
+    server.begin();
+
+    link.feed(fake::asciiFrame("dev1", "temp:21.5"));
+    link.feed(fake::asciiFrame("dev2", "temp:22.5"));
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(2, server.membershipChanges().pending());
+
+    // dev1 vẫn gửi dữ liệu, dev2 im lặng đến khi offline
+    std::string alive = fake::asciiFrame("dev1", "temp:21.6");
+    for (int i = 0; i < 120 && server.devices().at(server.devices().find("dev2")).status != DEVICE_OFFLINE; i++) {
+        fake::advanceMs(1000);
+        link.feed(alive);
+        server.loop();
+    }
+    TEST_ASSERT_EQUAL_UINT8(DEVICE_OFFLINE, server.devices().at(server.devices().find("dev2")).status);
+
+    // Vào rồi rời mạng trong cùng một đợt: một mục, trạng thái cuối cùng
+    uint32_t joined = 0;
+    uint32_t left = 0;
+    TEST_ASSERT_EQUAL_UINT32(2, server.membershipChanges().drain([&](size_t index) {
+        const Device &device = server.devices().at(index);
+        if (device.status == DEVICE_OFFLINE) {
+            TEST_ASSERT_EQUAL_STRING("dev2", device.id);
+            left++;
+        } else {
+            TEST_ASSERT_EQUAL_STRING("dev1", device.id);
+            joined++;
+        }
+    }));
+    TEST_ASSERT_EQUAL_UINT32(1, joined);
+    TEST_ASSERT_EQUAL_UINT32(1, left);
+
+    // dev2 quay lại: vào mạng lần nữa
+    link.feed(fake::asciiFrame("dev2", "temp:22.5"));
+    server.loop();
+    TEST_ASSERT_EQUAL_UINT32(1, server.membershipChanges().pending());
+    server.membershipChanges().drain([&](size_t index) {
+        TEST_ASSERT_EQUAL_STRING("dev2", server.devices().at(index).id);
+        TEST_ASSERT_EQUAL_UINT8(DEVICE_ONLINE, server.devices().at(index).status);
+    });
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_waits_for_quiet_period);
+    RUN_TEST(test_max_delay_bounds_continuous_changes);
+    RUN_TEST(test_server_reports_join_and_leave);
+    return UNITY_END();
+}
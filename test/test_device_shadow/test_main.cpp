@@ -0,0 +1,112 @@
+/**
+ * DeviceShadow: đánh dấu metric đã đổi, collectChanged() khi update() chạy xen
+ * vào giữa lúc lấy giá trị và lúc gửi, và khi task ghi chạy song song với task
+ * đồng bộ.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "DeviceShadow.h"
+#include "MetricNames.h"
+
+#define METRIC_COUNT 16
+#define UPDATE_ROUNDS 20000
+
+void setUp() {}
+void tearDown() {}
+
+void test_collect_clears_and_stops() {
+    MetricNames names(METRIC_COUNT);
+    DeviceShadow shadow(names);
+    MetricHandle temp = names.intern("dev1", "temp");
+    MetricHandle hum = names.intern("dev1", "hum");
+    shadow.update(temp, 21.5f, 1000, 0, true);
+    shadow.update(hum, 40.0f, 1000, 0, true);
+    TEST_ASSERT_EQUAL_UINT32(2, shadow.changedCount());
+
+    // fn trả về false: metric đó vẫn được đánh dấu
+    TEST_ASSERT_EQUAL_UINT32(0, shadow.collectChanged([](MetricHandle, const ShadowValue &) { return false; }));
+    TEST_ASSERT_EQUAL_UINT32(2, shadow.changedCount());
+
+    TEST_ASSERT_EQUAL_UINT32(2, shadow.collectChanged([](MetricHandle, const ShadowValue &) { return true; }));
+    TEST_ASSERT_EQUAL_UINT32(0, shadow.changedCount());
+
+    // Mẫu nằm trong deadband không cần đồng bộ lại
+    shadow.update(temp, 21.6f, 2000, 0, false);
+    TEST_ASSERT_EQUAL_UINT32(0, shadow.changedCount());
+}
+
+void test_update_during_collect_is_not_lost() {
+    MetricNames names(METRIC_COUNT);
+    DeviceShadow shadow(names);
+    MetricHandle temp = names.intern("dev1", "temp");
+    shadow.update(temp, 21.5f, 1000, 0, true);
+
+    // Task ghi cập nhật metric khi task đồng bộ đang gửi giá trị cũ
+    float sent = 0;
+    TEST_ASSERT_EQUAL_UINT32(1, shadow.collectChanged([&](MetricHandle handle, const ShadowValue &value) {
+        sent = value.value;
+        shadow.update(handle, 25.0f, 2000, 0, true);
+        return true;
+    }));
+    TEST_ASSERT_TRUE(sent == 21.5f);
+
+    // Giá trị mới vẫn được gửi ở lần đồng bộ sau
+    TEST_ASSERT_EQUAL_UINT32(1, shadow.changedCount());
+    TEST_ASSERT_EQUAL_UINT32(1, shadow.collectChanged([&](MetricHandle, const ShadowValue &value) {
+        sent = value.value;
+        return true;
+    }));
+    TEST_ASSERT_TRUE(sent == 25.0f);
+    TEST_ASSERT_EQUAL_UINT32(0, shadow.changedCount());
+}
+
+void test_concurrent_update_and_collect() {
+    MetricNames names(METRIC_COUNT);
+    DeviceShadow shadow(names);
+    MetricHandle handles[METRIC_COUNT];
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "k%d", i);
+        handles[i] = names.intern("dev1", key);
+    }
+
+    // Giá trị gần nhất task đồng bộ đã gửi của từng metric
+    float synced[METRIC_COUNT] = {};
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+            for (int i = 0; i < METRIC_COUNT; i++) {
+                shadow.update(handles[i], static_cast<float>(round), round, 0, true);
+            }
+        }
+        done = true;
+    });
+    auto sync = [&]() {
+        shadow.collectChanged([&](MetricHandle handle, const ShadowValue &value) {
+            synced[handle] = value.value;
+            return true;
+        });
+    };
+    while (!done) {
+        sync();
+    }
+    writer.join();
+    sync();
+
+    // Mẫu cuối cùng của mọi metric đã được đồng bộ
+    TEST_ASSERT_EQUAL_UINT32(0, shadow.changedCount());
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        TEST_ASSERT_TRUE(synced[handles[i]] == static_cast<float>(UPDATE_ROUNDS));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_collect_clears_and_stops);
+    RUN_TEST(test_update_during_collect_is_not_lost);
+    RUN_TEST(test_concurrent_update_and_collect);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/**
+ * Luồng dữ liệu ở trạng thái ổn định không cấp phát heap: nhận khung tin, giải
+ * mã DATA, intern tên metric, qua SpscRing, gom bằng addMetric()/flushMetrics()
+ * và gửi QoS1 tới broker. Đếm bằng HeapTracker (env native build với HEAP_TRACKING).
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <FakeSerialLink.h>
+#include <NullBroker.h>
+#include <WiFi.h>
+#include "DataDecoder.h"
+#include "Metric.h"
+#include "MetricNames.h"
+#include "SpscRing.h"
+#include "ZigbeeServer.h"
+#include "PEClient.h"
+
+#define FRAME_COUNT 2000
+#define DEVICE_COUNT 8
+
+static const DataField dataSchema[] = {
+    {"temp", DATA_NUMBER, 1.0f, "C"},
+    {"hum", DATA_NUMBER, 1.0f, "%"},
+    {"bat", DATA_NUMBER, 1.0f, "%"},
+    {"rssi", DATA_INT, 1.0f, "dBm"},
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_tracking_enabled() {
+    TEST_ASSERT_TRUE(HeapTracker::enabled());
+    uint32_t before = HeapTracker::totalAllocations();
+    // volatile: trình biên dịch không được bỏ cặp malloc/free
+    void *volatile p = malloc(16);
+    free(p);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, HeapTracker::totalAllocations());
+}
+
+void test_frames_and_metrics_do_not_allocate() {
+    NullBroker broker;
+    fake::network() = &broker;
+    PEClient client("ssid", "pass", "broker.local", 1883, "gw", "user", "token");
+    client.begin();
+    client.loop();
+    client.loop();
+    TEST_ASSERT_TRUE(client.connected());
+
+    FakeSerialLink link;
+    ZigbeeServer server(link);
+    DataDecoder decoder(dataSchema, sizeof(dataSchema) / sizeof(dataSchema[0]));
+    MetricNames names(64);
+    SpscRing<Metric, 64> ring;
+    uint64_t ts = 1718000000000ULL;
+    server.onMessage([&](const char *id, const char *data) {
+        decoder.decode(data, [&](const DataValue &value) {
+            Metric metric;
+            metric.handle = names.intern(id, value.key);
+            metric.value = static_cast<float>(value.value);
+            metric.ts = ts;
+            metric.flags = 0;
+            metric.reserved = 0;
+            ring.push(metric);
+        });
+    });
+    server.begin();
+
+    // Khung tin đã dựng sẵn: việc dựng chuỗi trong test không được tính
+    std::string frames[DEVICE_COUNT];
+    for (int d = 0; d < DEVICE_COUNT; d++) {
+        char id[24];
+        snprintf(id, sizeof(id), "0x00124B0001A2B3%02X", d);
+        frames[d] = fake::asciiFrame(id, "temp:21.5,hum:40.2,bat:87,rssi:-67");
+    }
+
+    uint32_t published = 0;
+    uint32_t rejected = 0;
+    auto step = [&](int i) {
+        link.feed(frames[i % DEVICE_COUNT]);
+        server.loop();
+        Metric metric;
+        while (ring.pop(metric)) {
+            published++;
+            rejected += !client.addMetric(metric.ts, names.name(metric.handle), metric.value);
+        }
+        rejected += !client.flushMetrics();
+        client.loop();
+        ts += 100;
+    };
+
+    // Khởi động: thêm thiết bị, intern tên metric lần đầu
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        step(i);
+    }
+    published = 0;
+
+    uint32_t allocations = HeapTracker::totalAllocations();
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        step(i);
+    }
+    allocations = HeapTracker::totalAllocations() - allocations;
+
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+    TEST_ASSERT_EQUAL_UINT32(FRAME_COUNT * 4, published);
+    TEST_ASSERT_EQUAL_UINT32(0, rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.errors());
+    TEST_ASSERT_TRUE(broker.publishes() >= FRAME_COUNT);
+    fake::network() = nullptr;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tracking_enabled);
+    RUN_TEST(test_frames_and_metrics_do_not_allocate);
+    return UNITY_END();
+}
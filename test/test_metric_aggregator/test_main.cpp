@@ -0,0 +1,93 @@
+/**
+ * MetricAggregator cùng DeadbandFilter như enqueueMetric() trong main.cpp: ngưỡng
+ * lọc chỉ bỏ mẫu của metric gửi thẳng, metric được gom nhận mọi mẫu nên
+ * min/max/mean/count của cửa sổ không bị lệch.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "DeadbandFilter.h"
+#include "Metric.h"
+#include "MetricAggregator.h"
+#include "MetricNames.h"
+
+#define WINDOW_MS 10000
+
+static std::vector<MetricSummary> summaries;
+
+// Phần lọc của enqueueMetric(), hàng đợi được rút ngay vào bộ gom
+static void collect(DeadbandFilter &deadband, MetricAggregator &aggregator, MetricHandle handle, float value,
+                    unsigned long now) {
+    bool changed = deadband.accept(handle, value, now);
+    if (!changed && !aggregator.aggregates(handle)) {
+        return;
+    }
+    Metric metric;
+    metric.handle = handle;
+    metric.value = value;
+    metric.ts = now;
+    metric.flags = 0;
+    metric.reserved = 0;
+    aggregator.add(metric, now);
+}
+
+void setUp() { summaries.clear(); }
+void tearDown() {}
+
+void test_deadband_skips_aggregated_metrics() {
+    MetricNames names(8);
+    DeadbandFilter deadband(names);
+    MetricAggregator aggregator(names);
+    aggregator.onSummary([](MetricHandle, const MetricSummary &summary) { summaries.push_back(summary); });
+    DeadbandConfig config = {1.0f, 0, 0};
+    deadband.setDefault(config);
+
+    MetricHandle temp = names.intern("dev1", "temp");
+    TEST_ASSERT_FALSE(aggregator.aggregates(temp));
+    TEST_ASSERT_TRUE(aggregator.setWindow("temp", WINDOW_MS));
+    TEST_ASSERT_TRUE(aggregator.aggregates(temp));
+
+    // Các mẫu lệch nhau ít hơn ngưỡng lọc vẫn được tính vào cửa sổ
+    const float samples[] = {20.0f, 20.4f, 20.8f, 19.6f, 20.2f};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        collect(deadband, aggregator, temp, samples[i], 1000 + i * 1000);
+    }
+    aggregator.poll(1000 + WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, summaries.size());
+    TEST_ASSERT_EQUAL_UINT32(5, summaries[0].count);
+    TEST_ASSERT_TRUE(summaries[0].min == 19.6f);
+    TEST_ASSERT_TRUE(summaries[0].max == 20.8f);
+    TEST_ASSERT_TRUE(fabsf(summaries[0].mean - 20.2f) < 0.001f);
+    TEST_ASSERT_TRUE(summaries[0].last == 20.2f);
+}
+
+void test_deadband_filters_direct_metrics() {
+    MetricNames names(8);
+    DeadbandFilter deadband(names);
+    MetricAggregator aggregator(names);
+    aggregator.onSummary([](MetricHandle, const MetricSummary &summary) { summaries.push_back(summary); });
+    DeadbandConfig config = {1.0f, 0, 0};
+    deadband.setDefault(config);
+    aggregator.setWindow("dev2", WINDOW_MS);
+
+    // Không có cửa sổ: chỉ mẫu vượt ngưỡng được gửi
+    MetricHandle hum = names.intern("dev1", "hum");
+    collect(deadband, aggregator, hum, 40.0f, 1000);
+    collect(deadband, aggregator, hum, 40.5f, 2000);
+    collect(deadband, aggregator, hum, 41.0f, 3000);
+    TEST_ASSERT_EQUAL_UINT32(2, summaries.size());
+    TEST_ASSERT_EQUAL_UINT32(0, summaries[1].windowMs);
+    TEST_ASSERT_TRUE(summaries[1].last == 41.0f);
+
+    // Luật theo ID thiết bị cũng tính là được gom
+    TEST_ASSERT_TRUE(aggregator.aggregates(names.intern("dev2", "hum")));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_deadband_skips_aggregated_metrics);
+    RUN_TEST(test_deadband_filters_direct_metrics);
+    return UNITY_END();
+}
@@ -0,0 +1,265 @@
+/**
+ * MetricStore trên một thư mục tạm của máy tính: ghi thêm, chuyển segment, bỏ
+ * segment cũ nhất khi đầy, đọc lại sau khi mở lại và bản ghi cuối bị ghi dở.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "MetricStore.h"
+
+static char directory[64];
+
+// Xóa mọi tệp trong thư mục tạm của test
+static void clearDirectory() {
+    DIR *dir = opendir(directory);
+    if (dir == nullptr) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] != '.') {
+            remove((std::string(directory) + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+static size_t segmentFiles() {
+    DIR *dir = opendir(directory);
+    size_t count = 0;
+    struct dirent *entry;
+    while (dir != nullptr && (entry = readdir(dir)) != nullptr) {
+        const char *dot = strrchr(entry->d_name, '.');
+        count += dot != nullptr && strcmp(dot, ".seg") == 0;
+    }
+    if (dir != nullptr) {
+        closedir(dir);
+    }
+    return count;
+}
+
+static std::string segmentPath(uint32_t seq) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%08lu.seg", directory, static_cast<unsigned long>(seq));
+    return path;
+}
+
+static void appendRecords(MetricStore &store, uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "temp_dev%u", static_cast<unsigned>(i % 3));
+        TEST_ASSERT_TRUE(store.append(1000 + i, name, i * 0.5f, 0));
+    }
+}
+
+// Đọc lại toàn bộ, trả về ts - 1000 của các bản ghi theo thứ tự đọc
+static std::vector<uint32_t> replayAll(MetricStore &store) {
+    std::vector<uint32_t> order;
+    store.replay(1000, [&](const StoredMetric &record) {
+        order.push_back(static_cast<uint32_t>(record.ts - 1000));
+        TEST_ASSERT_TRUE(record.value == order.back() * 0.5f);
+        return true;
+    });
+    return order;
+}
+
+void setUp() { clearDirectory(); }
+void tearDown() { clearDirectory(); }
+
+void test_append_and_replay_in_order() {
+    MetricStore store(directory, 4, 8);
+    TEST_ASSERT_TRUE(store.begin());
+    TEST_ASSERT_TRUE(store.empty());
+
+    appendRecords(store, 0, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, store.pending());
+    TEST_ASSERT_EQUAL_UINT32(10, store.appended());
+
+    // Handler trả về false: bản ghi đó được đọc lại ở lần sau
+    uint32_t seen = 0;
+    TEST_ASSERT_EQUAL_UINT32(3, store.replay(1000, [&](const StoredMetric &record) {
+        TEST_ASSERT_EQUAL_STRING(seen % 3 == 0 ? "temp_dev0" : seen % 3 == 1 ? "temp_dev1" : "temp_dev2", record.name);
+        return seen++ < 3;
+    }));
+    TEST_ASSERT_EQUAL_UINT32(7, store.pending());
+
+    std::vector<uint32_t> order = replayAll(store);
+    TEST_ASSERT_EQUAL_UINT32(7, order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(3 + i, order[i]);
+    }
+    TEST_ASSERT_TRUE(store.empty());
+    TEST_ASSERT_EQUAL_UINT32(10, store.replayed());
+}
+
+void test_segment_rollover() {
+    MetricStore store(directory, 4, 8);
+    TEST_ASSERT_TRUE(store.begin());
+
+    appendRecords(store, 0, 4);
+    TEST_ASSERT_EQUAL_UINT32(1, segmentFiles());
+    appendRecords(store, 4, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, segmentFiles());
+    appendRecords(store, 5, 5);
+    TEST_ASSERT_EQUAL_UINT32(3, segmentFiles());
+
+    // Segment đã đọc xong bị xóa, segment đang ghi được giữ để ghi tiếp
+    TEST_ASSERT_EQUAL_UINT32(10, replayAll(store).size());
+    TEST_ASSERT_EQUAL_UINT32(1, segmentFiles());
+    TEST_ASSERT_EQUAL_UINT32(0, store.pending());
+
+    appendRecords(store, 10, 2);
+    std::vector<uint32_t> order = replayAll(store);
+    TEST_ASSERT_EQUAL_UINT32(2, order.size());
+    TEST_ASSERT_EQUAL_UINT32(10, order[0]);
+    TEST_ASSERT_EQUAL_UINT32(11, order[1]);
+
+    // Segment 2 đầy (bản ghi 8-11) và đã đọc xong
+    appendRecords(store, 12, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, replayAll(store).size());
+    TEST_ASSERT_EQUAL_UINT32(1, segmentFiles());
+    TEST_ASSERT_TRUE(access(segmentPath(3).c_str(), F_OK) == 0);
+}
+
+void test_replay_keeps_up_without_new_segments() {
+    MetricStore store(directory, 64, 8);
+    TEST_ASSERT_TRUE(store.begin());
+
+    // Mỗi tick ghi một ít và đọc lại hết, như khi gửi bị nghẽn rồi thông
+    uint32_t next = 0;
+    for (int tick = 0; tick < 20; tick++) {
+        appendRecords(store, next, 3);
+        std::vector<uint32_t> order = replayAll(store);
+        TEST_ASSERT_EQUAL_UINT32(3, order.size());
+        TEST_ASSERT_EQUAL_UINT32(next, order[0]);
+        next += 3;
+        TEST_ASSERT_EQUAL_UINT32(1, segmentFiles());
+    }
+    // 60 bản ghi vẫn nằm trong segment đầu tiên
+    TEST_ASSERT_TRUE(access(segmentPath(0).c_str(), F_OK) == 0);
+    TEST_ASSERT_EQUAL_UINT32(60, store.replayed());
+    TEST_ASSERT_EQUAL_UINT32(0, store.pending());
+
+    // Handler dừng giữa chừng: bản ghi đó được đọc lại ở lần sau
+    appendRecords(store, next, 2);
+    TEST_ASSERT_EQUAL_UINT32(0, store.replay(10, [](const StoredMetric &) { return false; }));
+    TEST_ASSERT_EQUAL_UINT32(2, replayAll(store).size());
+    TEST_ASSERT_EQUAL_UINT32(0, store.corrupted());
+}
+
+void test_evicts_oldest_segment_when_full() {
+    MetricStore store(directory, 4, 3);
+    TEST_ASSERT_TRUE(store.begin());
+
+    // 5 segment, tối đa 3: segment 0 và 1 (bản ghi 0-7) bị bỏ
+    appendRecords(store, 0, 20);
+    TEST_ASSERT_EQUAL_UINT32(8, store.evicted());
+    TEST_ASSERT_EQUAL_UINT32(12, store.pending());
+    TEST_ASSERT_EQUAL_UINT32(3, segmentFiles());
+
+    std::vector<uint32_t> order = replayAll(store);
+    TEST_ASSERT_EQUAL_UINT32(12, order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(8 + i, order[i]);
+    }
+}
+
+void test_replay_after_reopen() {
+    uint16_t previousBoot;
+    {
+        MetricStore store(directory, 4, 8);
+        TEST_ASSERT_TRUE(store.begin());
+        appendRecords(store, 0, 6);
+        previousBoot = store.bootId();
+    }
+
+    MetricStore store(directory, 4, 8);
+    TEST_ASSERT_TRUE(store.begin());
+    TEST_ASSERT_EQUAL_UINT32(6, store.pending());
+    TEST_ASSERT_TRUE(store.bootId() != previousBoot);
+
+    // Bản ghi mới nằm sau các bản ghi của lần chạy trước, và chỉ chúng thuộc lần khởi động này
+    appendRecords(store, 6, 3);
+    std::vector<uint32_t> order;
+    std::vector<bool> thisBoot;
+    store.replay(1000, [&](const StoredMetric &record) {
+        order.push_back(static_cast<uint32_t>(record.ts - 1000));
+        thisBoot.push_back(store.fromThisBoot(record));
+        return true;
+    });
+    TEST_ASSERT_EQUAL_UINT32(9, order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(i, order[i]);
+        TEST_ASSERT_TRUE(thisBoot[i] == (i >= 6));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, store.corrupted());
+}
+
+void test_truncated_last_record() {
+    {
+        MetricStore store(directory, 4, 8);
+        TEST_ASSERT_TRUE(store.begin());
+        appendRecords(store, 0, 6);
+    }
+
+    // Mất điện khi đang ghi: nửa bản ghi ở cuối segment 1
+    FILE *file = fopen(segmentPath(1).c_str(), "ab");
+    TEST_ASSERT_TRUE(file != nullptr);
+    uint8_t partial[sizeof(StoredMetric) / 2];
+    memset(partial, 0x5a, sizeof(partial));
+    TEST_ASSERT_EQUAL_UINT32(1, fwrite(partial, sizeof(partial), 1, file));
+    fclose(file);
+
+    MetricStore store(directory, 4, 8);
+    TEST_ASSERT_TRUE(store.begin());
+    TEST_ASSERT_EQUAL_UINT32(6, store.pending());
+    TEST_ASSERT_EQUAL_UINT32(6, replayAll(store).size());
+    TEST_ASSERT_TRUE(store.empty());
+}
+
+void test_corrupted_last_record() {
+    {
+        MetricStore store(directory, 4, 8);
+        TEST_ASSERT_TRUE(store.begin());
+        appendRecords(store, 0, 6);
+    }
+
+    // Bản ghi cuối đủ độ dài nhưng nội dung ghi dở: checksum không khớp
+    FILE *file = fopen(segmentPath(1).c_str(), "r+b");
+    TEST_ASSERT_TRUE(file != nullptr);
+    long valueOffset = static_cast<long>(offsetof(StoredMetric, value)) - static_cast<long>(sizeof(StoredMetric));
+    TEST_ASSERT_EQUAL_INT(0, fseek(file, valueOffset, SEEK_END));
+    uint32_t garbage = 0xdeadbeef;
+    TEST_ASSERT_EQUAL_UINT32(1, fwrite(&garbage, sizeof(garbage), 1, file));
+    fclose(file);
+
+    MetricStore store(directory, 4, 8);
+    TEST_ASSERT_TRUE(store.begin());
+    std::vector<uint32_t> order = replayAll(store);
+    TEST_ASSERT_EQUAL_UINT32(5, order.size());
+    TEST_ASSERT_EQUAL_UINT32(4, order[4]);
+    TEST_ASSERT_EQUAL_UINT32(1, store.corrupted());
+    TEST_ASSERT_TRUE(store.empty());
+}
+
+int main() {
+    snprintf(directory, sizeof(directory), "/tmp/metricstoreXXXXXX");
+    if (mkdtemp(directory) == nullptr) {
+        return 1;
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_replay_in_order);
+    RUN_TEST(test_segment_rollover);
+    RUN_TEST(test_replay_keeps_up_without_new_segments);
+    RUN_TEST(test_evicts_oldest_segment_when_full);
+    RUN_TEST(test_replay_after_reopen);
+    RUN_TEST(test_truncated_last_record);
+    RUN_TEST(test_corrupted_last_record);
+    int failures = UNITY_END();
+    rmdir(directory);
+    return failures;
+}
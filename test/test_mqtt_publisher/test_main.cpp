@@ -0,0 +1,227 @@
+/**
+ * Gửi MQTT qua FakeBroker: cửa sổ QoS1 của MqttPublisher, PUBACK giải phóng slot,
+ * gửi lại với cờ DUP sau khi kết nối lại, kết nối lại từng bước mà loop() không
+ * chờ mạng, và task gửi cùng task PEClient ghi vào một socket mà gói tin không
+ * bị ghi xen kẽ.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <FakeBroker.h>
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "PEClient.h"
+
+#define CONCURRENT_ATTRIBUTES 2000
+#define CONCURRENT_REQUESTS 200
+
+static FakeBroker *broker;
+static PEClient *client;
+
+// Gói QoS1 (gói metric) broker đã nhận
+static std::vector<FakeBroker::Publish> metricPublishes() {
+    std::vector<FakeBroker::Publish> result;
+    std::vector<FakeBroker::Publish> all = broker->publishes();
+    for (size_t i = 0; i < all.size(); i++) {
+        if (all[i].qos == 1) {
+            result.push_back(all[i]);
+        }
+    }
+    return result;
+}
+
+// Mỗi lần gọi là một gói metric riêng (setBatchLimits(1, ...))
+static void queueBatches(int count) {
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(client->addMetric(1718000000000ULL + i, "temp", 20 + i));
+    }
+}
+
+void setUp() {
+    broker = new FakeBroker();
+    fake::network() = broker;
+    client = new PEClient("ssid", "pass", "broker.local", 1883, "gw", "user", "token");
+    client->setBatchLimits(1, 1024, 1000);
+    client->begin();
+    client->loop();
+    client->loop();
+    TEST_ASSERT_TRUE(client->connected());
+}
+
+void tearDown() {
+    fake::holdDns(false);
+    fake::holdTcpConnect(false);
+    delete client;
+    fake::network() = nullptr;
+    delete broker;
+}
+
+void test_window_limits_in_flight() {
+    client->setPublishWindow(2);
+    broker->holdAcks(true);
+    queueBatches(5);
+
+    client->loop();
+    client->loop();
+    TEST_ASSERT_EQUAL_UINT32(2, metricPublishes().size());
+    TEST_ASSERT_EQUAL_UINT32(2, client->publisher().inFlight());
+    TEST_ASSERT_EQUAL_UINT32(2, broker->heldAcks());
+
+    // PUBACK giải phóng slot, các gói đang chờ được gửi ở lần poll sau
+    TEST_ASSERT_EQUAL_UINT32(2, broker->releaseAcks());
+    client->loop();
+    TEST_ASSERT_EQUAL_UINT32(2, client->publisher().acked());
+    TEST_ASSERT_EQUAL_UINT32(4, metricPublishes().size());
+    TEST_ASSERT_EQUAL_UINT32(2, client->publisher().inFlight());
+
+    broker->holdAcks(false);
+    broker->releaseAcks();
+    client->loop();
+    client->loop();
+    std::vector<FakeBroker::Publish> publishes = metricPublishes();
+    TEST_ASSERT_EQUAL_UINT32(5, publishes.size());
+    TEST_ASSERT_EQUAL_UINT32(5, client->publisher().acked());
+    TEST_ASSERT_EQUAL_UINT32(0, client->publisher().inFlight());
+    TEST_ASSERT_EQUAL_UINT32(client->publisher().slots(), client->publisher().freeSlots());
+    for (size_t i = 0; i < publishes.size(); i++) {
+        TEST_ASSERT_FALSE(publishes[i].dup);
+        TEST_ASSERT_EQUAL_STRING("v1/devices/gw/metrics", publishes[i].topic.c_str());
+    }
+}
+
+void test_resend_after_reconnect() {
+    uint32_t lookups = fake::dnsLookups();
+    broker->holdAcks(true);
+    queueBatches(3);
+    client->loop();
+    std::vector<FakeBroker::Publish> sent = metricPublishes();
+    TEST_ASSERT_EQUAL_UINT32(3, sent.size());
+
+    // Mất kết nối trước khi có PUBACK
+    broker->disconnectClient();
+    broker->holdAcks(false);
+    client->loop();
+    TEST_ASSERT_FALSE(client->connected());
+    TEST_ASSERT_EQUAL_UINT32(1, client->reconnectCount());
+    client->loop();
+    TEST_ASSERT_TRUE(client->connected());
+    TEST_ASSERT_EQUAL_UINT32(2, broker->connects());
+    // Địa chỉ broker đã tra DNS được dùng lại
+    TEST_ASSERT_EQUAL_UINT32(lookups, fake::dnsLookups());
+
+    client->loop();
+    client->loop();
+    std::vector<FakeBroker::Publish> publishes = metricPublishes();
+    TEST_ASSERT_EQUAL_UINT32(6, publishes.size());
+    for (size_t i = 0; i < 3; i++) {
+        const FakeBroker::Publish &resent = publishes[3 + i];
+        TEST_ASSERT_TRUE(resent.dup);
+        TEST_ASSERT_EQUAL_UINT16(sent[i].packetId, resent.packetId);
+        TEST_ASSERT_EQUAL_STRING(sent[i].payload.c_str(), resent.payload.c_str());
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, client->publisher().resent());
+    TEST_ASSERT_EQUAL_UINT32(3, client->publisher().acked());
+    TEST_ASSERT_EQUAL_UINT32(client->publisher().slots(), client->publisher().freeSlots());
+}
+
+void test_reconnect_steps_do_not_block() {
+    uint32_t lookups = fake::dnsLookups();
+    broker->disconnectClient();
+    client->loop();
+    TEST_ASSERT_EQUAL(PEClient::STATE_MQTT_CONNECTING, client->state());
+
+    // Kết nối TCP chưa xong: loop() trả về, hết thời gian thì tra lại DNS ở lần sau
+    fake::holdTcpConnect(true);
+    for (int i = 0; i < 3; i++) {
+        client->loop();
+        TEST_ASSERT_EQUAL(PEClient::STATE_MQTT_CONNECTING, client->state());
+    }
+    fake::advanceMs(PECLIENT_TCP_CONNECT_TIMEOUT_MS);
+    client->loop();
+    fake::holdTcpConnect(false);
+    TEST_ASSERT_EQUAL_UINT32(0, fake::openSockets());
+
+    // DNS chưa trả lời
+    fake::holdDns(true);
+    fake::advanceMs(PECLIENT_BACKOFF_MIN_MS * 2);
+    client->loop();
+    client->loop();
+    TEST_ASSERT_EQUAL(PEClient::STATE_MQTT_CONNECTING, client->state());
+    TEST_ASSERT_EQUAL_UINT32(lookups + 1, fake::dnsLookups());
+
+    // Đã gửi CONNECT, CONNACK chưa tới
+    broker->holdConnack(true);
+    TEST_ASSERT_TRUE(fake::answerDns());
+    client->loop();
+    client->loop();
+    TEST_ASSERT_EQUAL(PEClient::STATE_MQTT_CONNECTING, client->state());
+    TEST_ASSERT_TRUE(broker->connected());
+
+    TEST_ASSERT_TRUE(broker->releaseConnack());
+    client->loop();
+    TEST_ASSERT_TRUE(client->connected());
+    TEST_ASSERT_EQUAL_UINT32(6, broker->subscriptions().size());
+    // PubSubClient không gửi CONNECT lần hai trên cùng kết nối
+    TEST_ASSERT_EQUAL_UINT32(0, broker->malformed());
+    TEST_ASSERT_EQUAL_UINT32(0, fake::openSockets());
+}
+
+void test_concurrent_writers_do_not_interleave() {
+    // Task PEClient trả lời yêu cầu ngay trong callback của _client.loop()
+    std::atomic<uint32_t> requests(0);
+    client->onRequest([&](const PEClient::Request &request) {
+        JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+        JsonDocument doc(&arena);
+        doc["request"] = request.id;
+        client->respond(request, doc);
+        requests++;
+    });
+
+    std::atomic<bool> done(false);
+    std::thread peClientTask([&]() {
+        fake::setCore(1);
+        while (!done) {
+            client->loop();
+        }
+    });
+
+    // Task gửi metric: thuộc tính QoS0 và gói metric QoS1 xen kẽ
+    uint32_t sentAttributes = 0;
+    for (int i = 0; i < CONCURRENT_ATTRIBUTES; i++) {
+        JsonArena<PECLIENT_DOC_ARENA_SIZE> arena;
+        JsonDocument doc(&arena);
+        doc["attributes"]["deviceCount"] = i;
+        doc["attributes"]["devicesJoined"] = "0x00124B0001A2B3C4,0x00124B0001A2B3C5";
+        sentAttributes += client->sendAttributes(doc);
+        client->addMetric(1718000000000ULL + i, "temp", i);
+        if (i % (CONCURRENT_ATTRIBUTES / CONCURRENT_REQUESTS) == 0) {
+            broker->publishToClient("v1/devices/gw/attributes/request/7", "{\"keys\":\"temp\"}");
+        }
+    }
+    // Gói bị ghi xen kẽ làm broker đóng kết nối: không chờ mãi
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (requests < CONCURRENT_REQUESTS && broker->connected() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    done = true;
+    peClientTask.join();
+    fake::setCore(0);
+
+    TEST_ASSERT_EQUAL_UINT32(0, broker->malformed());
+    TEST_ASSERT_EQUAL_UINT32(1, broker->connects());
+    TEST_ASSERT_EQUAL_UINT32(CONCURRENT_REQUESTS, requests.load());
+    TEST_ASSERT_EQUAL_UINT32(CONCURRENT_ATTRIBUTES, sentAttributes);
+    TEST_ASSERT_TRUE(metricPublishes().size() > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_limits_in_flight);
+    RUN_TEST(test_resend_after_reconnect);
+    RUN_TEST(test_reconnect_steps_do_not_block);
+    RUN_TEST(test_concurrent_writers_do_not_interleave);
+    return UNITY_END();
+}
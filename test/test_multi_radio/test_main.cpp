@@ -0,0 +1,232 @@
+/**
+ * Nhiều radio điều phối sau một luồng metric: ZigbeeRouter chọn radio quản lý
+ * thiết bị, và thông lượng khi hai radio cùng nhận khung tin trên hai luồng
+ * (mỗi luồng một FakeSerialLink, ghi chung qua producerLock như main.cpp) so với
+ * một radio trên một luồng.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <Benchmark.h>
+#include <FakeSerialLink.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "DataDecoder.h"
+#include "Metric.h"
+#include "MetricNames.h"
+#include "SpscRing.h"
+#include "ZigbeeRouter.h"
+#include "ZigbeeServer.h"
+
+#define FRAMES_PER_RADIO 40000
+#define FRAMES_PER_FEED 16
+#define DEVICE_COUNT 8
+
+static const DataField dataSchema[] = {
+    {"temp", DATA_NUMBER, 1.0f, "C"},
+    {"hum", DATA_NUMBER, 1.0f, "%"},
+    {"bat", DATA_NUMBER, 1.0f, "%"},
+    {"rssi", DATA_INT, 1.0f, "dBm"},
+};
+
+static bench::Suite suite("multi_radio");
+
+/**
+ * Phần dùng chung giữa các radio như trong main.cpp: giải mã, intern tên và
+ * push vào hàng đợi khi giữ producerLock. Hàng đợi được rút ngay trong lock để
+ * test không cần task MQTT.
+ */
+struct Pipeline {
+    SemaphoreHandle_t producerLock;
+    DataDecoder decoder;
+    MetricNames names;
+    SpscRing<Metric, 64> ring;
+    uint32_t metrics;
+
+    Pipeline()
+        : producerLock(xSemaphoreCreateMutex()), decoder(dataSchema, sizeof(dataSchema) / sizeof(dataSchema[0])),
+          names(64), metrics(0) {}
+    ~Pipeline() { vSemaphoreDelete(producerLock); }
+
+    void attach(ZigbeeServer &radio) {
+        radio.onMessage([this](const char *id, const char *data) {
+            xSemaphoreTake(producerLock, portMAX_DELAY);
+            decoder.decode(data, [&](const DataValue &value) {
+                Metric metric;
+                metric.handle = names.intern(id, value.key);
+                metric.value = static_cast<float>(value.value);
+                metric.ts = 0;
+                metric.flags = 0;
+                metric.reserved = 0;
+                ring.push(metric);
+            });
+            Metric metric;
+            while (ring.pop(metric)) {
+                metrics++;
+            }
+            xSemaphoreGive(producerLock);
+        });
+    }
+};
+
+// FRAMES_PER_FEED khung tin nối liền, từ DEVICE_COUNT thiết bị của một radio
+static std::string burst(int radio) {
+    std::string frames;
+    for (int i = 0; i < FRAMES_PER_FEED; i++) {
+        char id[24];
+        snprintf(id, sizeof(id), "0x00124B00%02X00%02X", radio, i % DEVICE_COUNT);
+        frames += fake::asciiFrame(id, "temp:21.5,hum:40.2,bat:87,rssi:-67");
+    }
+    return frames;
+}
+
+// Nhận frames khung tin trên một radio như task RX của nó
+static void receive(ZigbeeServer &radio, FakeSerialLink &link, const std::string &frames, uint32_t count,
+                    BaseType_t core) {
+    fake::setCore(core);
+    for (uint32_t i = 0; i < count; i += FRAMES_PER_FEED) {
+        link.feed(frames);
+        radio.loop();
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_router_picks_radio_that_heard_device_last() {
+    FakeSerialLink link0;
+    FakeSerialLink link1;
+    ZigbeeServer radio0(link0);
+    ZigbeeServer radio1(link1);
+    ZigbeeRouter router;
+    TEST_ASSERT_TRUE(router.add(radio0));
+    TEST_ASSERT_TRUE(router.add(radio1));
+
+    link0.feed(fake::asciiFrame("devA", "temp:21.5"));
+    radio0.loop();
+    link1.feed(fake::asciiFrame("devB", "temp:22.5"));
+    radio1.loop();
+    TEST_ASSERT_EQUAL_UINT32(2, router.deviceCount());
+    TEST_ASSERT_TRUE(router.owner("devA") == &radio0);
+    TEST_ASSERT_TRUE(router.owner("devB") == &radio1);
+    TEST_ASSERT_TRUE(router.owner("devC") == nullptr);
+
+    // devB chuyển sang mạng của radio 0: lệnh đi theo khung tin gần nhất
+    fake::advanceMs(1000);
+    link0.feed(fake::asciiFrame("devB", "temp:22.5"));
+    radio0.loop();
+    TEST_ASSERT_TRUE(router.owner("devB") == &radio0);
+
+    ZigbeeServer *owner = nullptr;
+    link0.clearSent();
+    link1.clearSent();
+    TEST_ASSERT_TRUE(router.sendCommand("devB", "LED:ON", CMD_PRIORITY_NORMAL, &owner) != 0);
+    TEST_ASSERT_TRUE(owner == &radio0);
+    radio0.loop();
+    radio1.loop();
+    TEST_ASSERT_TRUE(link0.sent().find("LED:ON") != std::string::npos);
+    TEST_ASSERT_TRUE(link1.sent().find("LED:ON") == std::string::npos);
+    TEST_ASSERT_EQUAL_UINT32(0, router.sendCommand("devC", "LED:ON"));
+}
+
+void test_two_radios_scale_throughput() {
+    std::string frames0 = burst(0);
+    std::string frames1 = burst(1);
+
+    // Một radio, một luồng: 2 * FRAMES_PER_RADIO khung tin
+    double singleSeconds;
+    uint32_t singleMetrics;
+    {
+        Pipeline pipeline;
+        FakeSerialLink link;
+        ZigbeeServer radio(link);
+        pipeline.attach(radio);
+        receive(radio, link, frames0, FRAMES_PER_FEED, 0); // Làm nóng: thêm thiết bị, intern tên
+        pipeline.metrics = 0;
+
+        uint32_t allocations = HeapTracker::totalAllocations();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        receive(radio, link, frames0, 2 * FRAMES_PER_RADIO, 0);
+        singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        suite.record("single_radio.frame", "allocs/op",
+                     static_cast<double>(HeapTracker::totalAllocations() - allocations) / (2 * FRAMES_PER_RADIO));
+        singleMetrics = pipeline.metrics;
+        TEST_ASSERT_EQUAL_UINT32(0, pipeline.decoder.errors());
+    }
+
+    // Hai radio, mỗi radio một luồng (core 0 và core 1), cùng số khung tin
+    double dualSeconds;
+    uint32_t dualMetrics;
+    {
+        Pipeline pipeline;
+        FakeSerialLink link0;
+        FakeSerialLink link1;
+        ZigbeeServer radio0(link0);
+        ZigbeeServer radio1(link1);
+        pipeline.attach(radio0);
+        pipeline.attach(radio1);
+        receive(radio0, link0, frames0, FRAMES_PER_FEED, 0);
+        receive(radio1, link1, frames1, FRAMES_PER_FEED, 1);
+        pipeline.metrics = 0;
+
+        // Tạo luồng cũng cấp phát: các luồng chờ go để chỉ đếm phần nhận khung tin
+        std::atomic<bool> go(false);
+        std::thread rx0([&]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            receive(radio0, link0, frames0, FRAMES_PER_RADIO, 0);
+        });
+        std::thread rx1([&]() {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            receive(radio1, link1, frames1, FRAMES_PER_RADIO, 1);
+        });
+        uint32_t allocations = HeapTracker::totalAllocations();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        go = true;
+        rx0.join();
+        rx1.join();
+        dualSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        suite.record("two_radios.frame", "allocs/op",
+                     static_cast<double>(HeapTracker::totalAllocations() - allocations) / (2 * FRAMES_PER_RADIO));
+        dualMetrics = pipeline.metrics;
+        fake::setCore(0);
+
+        TEST_ASSERT_EQUAL_UINT32(0, pipeline.decoder.errors());
+        TEST_ASSERT_EQUAL_UINT32(DEVICE_COUNT, radio0.devices().size());
+        TEST_ASSERT_EQUAL_UINT32(DEVICE_COUNT, radio1.devices().size());
+        TEST_ASSERT_EQUAL_UINT32(0, radio0.truncatedLines() + radio1.truncatedLines());
+    }
+
+    // Không khung tin nào bị mất khi hai radio cùng ghi
+    TEST_ASSERT_EQUAL_UINT32(2 * FRAMES_PER_RADIO * 4, singleMetrics);
+    TEST_ASSERT_EQUAL_UINT32(2 * FRAMES_PER_RADIO * 4, dualMetrics);
+
+    double ratio = singleSeconds / dualSeconds;
+    unsigned cores = std::thread::hardware_concurrency();
+    // Thông lượng và tỉ lệ tăng tốc phụ thuộc số core của máy chạy: không vào baseline
+    suite.report("single_radio.frames_per_second", "frames/s", 2 * FRAMES_PER_RADIO / singleSeconds);
+    suite.report("two_radios.frames_per_second", "frames/s", 2 * FRAMES_PER_RADIO / dualSeconds);
+    suite.report("two_radios.scaling", "x", ratio);
+    suite.report("host_cores", "cores", cores);
+
+    // Chỉ giải mã nằm trong producerLock: với hai core, hai radio phải nhanh hơn rõ rệt
+    if (cores >= 2) {
+        TEST_ASSERT_TRUE_MESSAGE(ratio > 1.1, "two radios do not scale, see [bench] lines");
+    }
+}
+
+void test_compare_baseline() { TEST_ASSERT_TRUE_MESSAGE(suite.finish(), "no baseline or allocs/op regressed, see [bench] lines"); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_router_picks_radio_that_heard_device_last);
+    RUN_TEST(test_two_radios_scale_throughput);
+    RUN_TEST(test_compare_baseline);
+    return UNITY_END();
+}
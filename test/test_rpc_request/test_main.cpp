@@ -0,0 +1,118 @@
+/**
+ * Yêu cầu đọc dữ liệu từ server qua FakeBroker: thuộc tính ("keys") và RPC với
+ * "params" là chuỗi hoặc object. Object lồng nhau được giữ nguyên trong bộ đệm
+ * để phân tích lại.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <FakeBroker.h>
+#include <WiFi.h>
+#include <string>
+#include "PEClient.h"
+
+static FakeBroker *broker;
+static PEClient *client;
+
+// Bản sao của yêu cầu cuối cùng (con trỏ trong Request chỉ hợp lệ trong callback)
+struct Received {
+    uint32_t count;
+    bool rpc;
+    std::string id;
+    std::string method;
+    std::string keys;
+    bool hasKeys;
+};
+static Received received;
+
+static void request(const char *topic, const char *payload) {
+    broker->publishToClient(topic, payload);
+    client->loop();
+}
+
+void setUp() {
+    received = Received();
+    broker = new FakeBroker();
+    fake::network() = broker;
+    client = new PEClient("ssid", "pass", "broker.local", 1883, "gw", "user", "token");
+    client->onRequest([](const PEClient::Request &r) {
+        received.count++;
+        received.rpc = r.rpc;
+        received.id = r.id;
+        received.method = r.method != nullptr ? r.method : "";
+        received.hasKeys = r.keys != nullptr;
+        received.keys = r.keys != nullptr ? r.keys : "";
+    });
+    client->begin();
+    client->loop();
+    client->loop();
+    TEST_ASSERT_TRUE(client->connected());
+}
+
+void tearDown() {
+    delete client;
+    fake::network() = nullptr;
+    delete broker;
+}
+
+void test_attribute_request_keys() {
+    request("v1/devices/gw/attributes/request/3", "{\"clientKeys\":\"temp_dev1,dev2\"}");
+    TEST_ASSERT_EQUAL_UINT32(1, received.count);
+    TEST_ASSERT_FALSE(received.rpc);
+    TEST_ASSERT_EQUAL_STRING("3", received.id.c_str());
+    TEST_ASSERT_EQUAL_STRING("temp_dev1,dev2", received.keys.c_str());
+}
+
+void test_rpc_string_params() {
+    request("v1/devices/gw/rpc/request/11", "{\"method\":\"getShadow\",\"params\":\"temp_dev1\"}");
+    TEST_ASSERT_EQUAL_UINT32(1, received.count);
+    TEST_ASSERT_TRUE(received.rpc);
+    TEST_ASSERT_EQUAL_STRING("11", received.id.c_str());
+    TEST_ASSERT_EQUAL_STRING("getShadow", received.method.c_str());
+    TEST_ASSERT_EQUAL_STRING("temp_dev1", received.keys.c_str());
+}
+
+void test_rpc_object_params() {
+    request("v1/devices/gw/rpc/request/12", "{\"method\":\"getShadow\",\"params\":{\"keys\":\"temp_dev1\"}}");
+    TEST_ASSERT_EQUAL_UINT32(1, received.count);
+    TEST_ASSERT_TRUE(received.rpc);
+    TEST_ASSERT_EQUAL_STRING("getShadow", received.method.c_str());
+    TEST_ASSERT_TRUE(received.hasKeys);
+    TEST_ASSERT_EQUAL_STRING("temp_dev1", received.keys.c_str());
+
+    // Escape và object lồng sâu hơn trong params không làm hỏng phần còn lại
+    request("v1/devices/gw/rpc/request/13",
+            "{\"method\":\"getShadow\",\"params\":{\"note\":\"a \\\"b\\\" }\",\"opts\":{\"x\":[1,2]},\"keys\":\"dev2\"}}");
+    TEST_ASSERT_EQUAL_UINT32(2, received.count);
+    TEST_ASSERT_EQUAL_STRING("13", received.id.c_str());
+    TEST_ASSERT_EQUAL_STRING("dev2", received.keys.c_str());
+}
+
+void test_rpc_without_params() {
+    request("v1/devices/gw/rpc/request/14", "{\"method\":\"getDevices\"}");
+    TEST_ASSERT_EQUAL_UINT32(1, received.count);
+    TEST_ASSERT_EQUAL_STRING("getDevices", received.method.c_str());
+    TEST_ASSERT_FALSE(received.hasKeys);
+}
+
+void test_raw_value_left_intact() {
+    RpcDispatcher dispatcher;
+    std::string raw;
+    dispatcher.on("params", [&](const RpcValue &value) {
+        TEST_ASSERT_EQUAL_UINT8(RpcValue::RPC_RAW, value.type);
+        raw.assign(value.str, value.length);
+    });
+    char payload[] = "{\"params\":{\"keys\":\"a\\\\b\",\"list\":[\"x\",\"y\"]}}";
+    TEST_ASSERT_TRUE(dispatcher.dispatch(payload, strlen(payload)));
+    TEST_ASSERT_EQUAL_STRING("{\"keys\":\"a\\\\b\",\"list\":[\"x\",\"y\"]}", raw.c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_attribute_request_keys);
+    RUN_TEST(test_rpc_string_params);
+    RUN_TEST(test_rpc_object_params);
+    RUN_TEST(test_rpc_without_params);
+    RUN_TEST(test_raw_value_left_intact);
+    return UNITY_END();
+}
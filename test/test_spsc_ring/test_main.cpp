@@ -0,0 +1,141 @@
+/**
+ * SpscRing: thứ tự, không rách dữ liệu và đếm pushed/dropped khi producer và
+ * consumer chạy trên hai luồng thật.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <HeapCounting.h>
+#include <Benchmark.h>
+#include <atomic>
+#include <thread>
+#include "SpscRing.h"
+
+#define STRESS_ITEMS 2000000
+
+struct Item {
+    uint32_t sequence;
+    uint32_t check; // ~sequence: phát hiện phần tử bị đọc khi mới ghi một nửa
+    uint64_t pad[3];
+};
+
+static bench::Suite suite("spsc_ring");
+
+void setUp() {}
+void tearDown() {}
+
+void test_fifo_and_drop_when_full() {
+    SpscRing<uint32_t, 4> ring;
+    for (uint32_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(i < 4, ring.push(i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, ring.pushed());
+    TEST_ASSERT_EQUAL_UINT32(2, ring.dropped());
+    uint32_t value;
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_FALSE(ring.pop(value));
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+struct StressResult {
+    uint32_t popped;
+    uint32_t outOfOrder;
+    uint32_t torn;
+    double seconds;
+};
+
+// waitWhenFull: producer chờ khi ring đầy (không bỏ phần tử nào), nếu không thì
+// consumer chậm hơn producer, ring đầy và phần tử mới bị bỏ
+template <size_t Capacity>
+static StressResult stress(SpscRing<Item, Capacity> &ring, bool waitWhenFull) {
+    bool slowConsumer = !waitWhenFull;
+    StressResult result = {0, 0, 0, 0};
+    std::atomic<bool> done(false);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+        Item item;
+        int64_t last = -1;
+        for (;;) {
+            if (!ring.pop(item)) {
+                if (done.load(std::memory_order_acquire) && ring.empty()) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            result.popped++;
+            result.outOfOrder += static_cast<int64_t>(item.sequence) <= last;
+            result.torn += item.check != ~item.sequence || item.pad[2] != item.sequence;
+            last = item.sequence;
+            if (slowConsumer && (item.sequence & 0xff) == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    });
+    std::thread producer([&]() {
+        Item item;
+        memset(&item, 0, sizeof(item));
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            item.sequence = i;
+            item.check = ~i;
+            item.pad[2] = i;
+            while (waitWhenFull && ring.size() >= Capacity) {
+                std::this_thread::yield();
+            }
+            ring.push(item);
+        }
+        done.store(true, std::memory_order_release);
+    });
+    producer.join();
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void test_stress_no_loss_when_producer_waits() {
+    static SpscRing<Item, 512> ring;
+    StressResult result = stress(ring, true);
+    TEST_ASSERT_EQUAL_UINT32(0, result.outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, result.torn);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, ring.pushed());
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, result.popped);
+    suite.record("stress.two_threads", "items/s", result.popped / result.seconds);
+}
+
+void test_stress_slow_consumer_counts_drops() {
+    static SpscRing<Item, 128> ring;
+    StressResult result = stress(ring, false);
+    TEST_ASSERT_EQUAL_UINT32(0, result.outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, result.torn);
+    TEST_ASSERT_TRUE(ring.dropped() > 0);
+    // Không mất âm thầm: mọi phần tử hoặc được đọc hoặc được đếm là bị bỏ
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, result.popped + ring.dropped());
+    TEST_ASSERT_EQUAL_UINT32(ring.pushed(), result.popped);
+}
+
+void test_bench_push_pop() {
+    static SpscRing<Item, 512> ring;
+    Item item;
+    memset(&item, 0, sizeof(item));
+    suite.run("push_pop", 1000000, [&]() {
+        ring.push(item);
+        ring.pop(item);
+    });
+}
+
+void test_compare_baseline() { TEST_ASSERT_TRUE_MESSAGE(suite.finish(), "no baseline or allocs/op regressed, see [bench] lines"); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_and_drop_when_full);
+    RUN_TEST(test_stress_no_loss_when_producer_waits);
+    RUN_TEST(test_stress_slow_consumer_counts_drops);
+    RUN_TEST(test_bench_push_pop);
+    RUN_TEST(test_compare_baseline);
+    return UNITY_END();
+}